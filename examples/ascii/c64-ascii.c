@@ -2,6 +2,9 @@
     c64.c
 
     Stripped down C64 emulator running in a (xterm-256color) terminal.
+
+    The emulation runs on wall clock time, the screen is only refreshed
+    when the terminal accepts more output (see termout.h).
 */
 #include <stdint.h>
 #include <stdbool.h>
@@ -9,6 +12,8 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <signal.h>
+#include <stdio.h>
+#include "termout.h"
 #define CHIPS_IMPL
 #include "chips/chips_common.h"
 #include "chips/m6502.h"
@@ -96,10 +101,13 @@ int main(int argc, char* argv[]) {
     keypad(stdscr, TRUE);
     attron(A_BOLD);
 
+    // curses does the output, only check if the terminal keeps up
+    termout_init(&(termout_desc_t){ .measure_only = true });
+
     // run the emulation/input/render loop
     while (!quit_requested) {
-        // tick the emulator for 1 frame
-        c64_exec(&c64, FRAME_USEC);
+        // tick the emulator for the time since the previous frame
+        c64_exec(&c64, termout_frame_time());
 
         // keyboard input
         int ch = getch();
@@ -126,6 +134,12 @@ int main(int argc, char* argv[]) {
                 c64_key_up(&c64, ch);
             }
         }
+        // skip rendering while the terminal is lagging (this must skip
+        // all curses drawing, getch() refreshes a modified screen)
+        if (!termout_begin_frame()) {
+            termout_wait(FRAME_USEC);
+            continue;
+        }
         // render the PETSCII buffer
         int cur_color_pair = -1;
         int bg = c64.vic.gunit.bg[0] & 0xF;
@@ -177,10 +191,14 @@ int main(int argc, char* argv[]) {
             }
         }
         refresh();
+        termout_end_frame();
 
         // pause until next frame
-        usleep(FRAME_USEC);
+        termout_wait(FRAME_USEC);
     }
+    const termout_stats_t stats = termout_stats();
+    termout_shutdown();
     endwin();
+    termout_print_stats(&stats);
     return 0;
 }
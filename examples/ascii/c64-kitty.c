@@ -4,16 +4,29 @@
 //  A C64 emulator for the terminal, using the Kitty graphics protocol:
 //
 //  https://sw.kovidgoyal.net/kitty/graphics-protocol/
+//
+//  In a local kitty terminal, frames are passed through POSIX shared memory
+//  objects (the terminal reads and then removes the object), only the object
+//  name goes through the escape stream. Two objects are used alternately,
+//  if the terminal hasn't picked up either of them yet, the frame is
+//  skipped. Remote sessions (over SSH) and other terminals get base64
+//  encoded pixels in the escape stream.
+//
+//  The emulation runs on wall clock time, the output is non-blocking (see
+//  termout.h), and frames are skipped while the terminal is lagging.
 //------------------------------------------------------------------------------
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <ctype.h>
 #include <curses.h>     // curses is only used for non-blocking keyboard input
 #include <unistd.h>
 #include <signal.h>
-#define SOKOL_IMPL
-#include "sokol_time.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "termout.h"
 #define CHIPS_IMPL
 #include "chips/chips_common.h"
 #include "chips/m6502.h"
@@ -34,12 +47,20 @@
 #define MAX_WIDTH (512)
 #define MAX_HEIGHT (512)
 #define BYTES_PER_PIXEL (3)
+#define SHM_MAX_LAGGING_FRAMES (120)
 
 static struct {
     c64_t c64;
     int width;
     int height;
     chips_range_t prg;
+    struct {
+        bool enabled;
+        int index;
+        char names[2][64];
+        size_t frames_skipped;
+        size_t frames_lagging;
+    } shm;
     struct {
         char buf[16];
         size_t index;
@@ -60,7 +81,7 @@ static void catch_sigint(int signo) {
 }
 
 // convert the C64 frame buffer to 24-bit RGB
-static void convert_framebuffer(void) {
+static void convert_framebuffer(uint8_t* dst) {
     const chips_display_info_t info = c64_display_info(&state.c64);
     assert((info.screen.width < MAX_WIDTH) && (info.screen.height < MAX_HEIGHT));
     assert(info.palette.ptr && (info.palette.size == 256 * 4));
@@ -75,27 +96,102 @@ static void convert_framebuffer(void) {
             int src_idx = y * src_width + x;
             int dst_idx = (y * state.width + x) * BYTES_PER_PIXEL;
             uint32_t rgba = pal[src_pixels[src_idx]];
-            state.rgb[dst_idx++] = rgba & 255;
-            state.rgb[dst_idx++] = (rgba >> 8) & 255;
-            state.rgb[dst_idx++] = (rgba >> 16) & 255;
+            dst[dst_idx++] = rgba & 255;
+            dst[dst_idx++] = (rgba >> 8) & 255;
+            dst[dst_idx++] = (rgba >> 16) & 255;
         }
     }
 }
 
 // move cursor back to topleft
 static void term_home(void) {
-    printf("\033[0;0H");
+    termout_printf("\033[0;0H");
+}
+
+// only use shared memory if the terminal is a local kitty
+static bool kitty_is_local(void) {
+    return getenv("KITTY_WINDOW_ID") && !getenv("SSH_CONNECTION") && !getenv("SSH_TTY");
+}
+
+static void shm_init(void) {
+    state.shm.enabled = kitty_is_local();
+    for (int i = 0; i < 2; i++) {
+        snprintf(state.shm.names[i], sizeof(state.shm.names[i]), "/c64-kitty-%d-%d", (int)getpid(), i);
+    }
+}
+
+// remove objects the terminal hasn't picked up
+static void shm_shutdown(void) {
+    for (int i = 0; i < 2; i++) {
+        shm_unlink(state.shm.names[i]);
+    }
+}
+
+// convert the frame into a new shared memory object, and pass its name to the terminal
+static void term_kitty_shm(void) {
+    const chips_display_info_t info = c64_display_info(&state.c64);
+    const size_t num_bytes = (size_t)(info.screen.width * info.screen.height * BYTES_PER_PIXEL);
+    // the terminal removes an object once it has read it, if both
+    // objects still exist, the terminal is lagging behind
+    int fd = -1;
+    for (int i = 0; (i < 2) && (fd < 0); i++) {
+        state.shm.index = (state.shm.index + 1) & 1;
+        fd = shm_open(state.shm.names[state.shm.index], O_CREAT | O_EXCL | O_RDWR, 0600);
+        if ((fd < 0) && (errno != EEXIST)) {
+            // no shared memory support, fall back to the escape stream
+            state.shm.enabled = false;
+            return;
+        }
+    }
+    if (fd < 0) {
+        state.shm.frames_skipped++;
+        // a terminal which never picks up the objects doesn't support them
+        if (++state.shm.frames_lagging > SHM_MAX_LAGGING_FRAMES) {
+            shm_shutdown();
+            state.shm.enabled = false;
+        }
+        return;
+    }
+    state.shm.frames_lagging = 0;
+    const char* name = state.shm.names[state.shm.index];
+    void* ptr = MAP_FAILED;
+    if (ftruncate(fd, (off_t)num_bytes) == 0) {
+        ptr = mmap(0, num_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        shm_unlink(name);
+        state.shm.enabled = false;
+        return;
+    }
+    convert_framebuffer((uint8_t*)ptr);
+    munmap(ptr, num_bytes);
+    size_t b64_num_bytes = 0;
+    chips_range_t out_buf = { .ptr = state.b64_buf, .size = sizeof(state.b64_buf) };
+    const unsigned char* b64 = base64_encode((const uint8_t*)name, strlen(name), out_buf, &b64_num_bytes);
+    termout_printf("\033_Ga=T,f=24,t=s,s=%d,v=%d,S=%d,c=80,r=30;", state.width, state.height, (int)num_bytes);
+    // skip the base64 line feed
+    termout_write(b64, b64_num_bytes - 1);
+    termout_printf("\033\\");
 }
 
 // dump converted framebuffer pixels
 static void term_kitty_pixels(void) {
-    printf("\033_Ga=T,f=24,s=%d,v=%d,c=80,r=30;", state.width, state.height);
+    convert_framebuffer(state.rgb);
+    termout_printf("\033_Ga=T,f=24,s=%d,v=%d,c=80,r=30;", state.width, state.height);
     const int num_bytes = state.width * state.height * BYTES_PER_PIXEL;
     size_t b64_num_bytes = 0;
     chips_range_t out_buf = { .ptr = state.b64_buf, .size = sizeof(state.b64_buf) };
     const unsigned char* b64 = base64_encode(state.rgb, num_bytes, out_buf, &b64_num_bytes);
-    fwrite(b64, 1, b64_num_bytes, stdout);
-    printf("\033\\");
+    termout_write(b64, b64_num_bytes);
+    termout_printf("\033\\");
+}
+
+static void print_stats(const termout_stats_t* stats) {
+    termout_print_stats(stats);
+    if (state.shm.frames_skipped > 0) {
+        printf("%zu frames skipped by the shared memory transport\n", state.shm.frames_skipped);
+    }
 }
 
 int main(int argc, char* argv[]) {
@@ -127,8 +223,9 @@ int main(int argc, char* argv[]) {
     nodelay(stdscr, TRUE);
     keypad(stdscr, TRUE);
 
-    // sokol time for rendering frames at correct speed
-    stm_setup();
+    // non-blocking output, the emulation runs on wall clock time
+    termout_init(&(termout_desc_t){0});
+    shm_init();
 
     // setup the C64 emulator
     c64_init(&state.c64, &(c64_desc_t){
@@ -141,10 +238,9 @@ int main(int argc, char* argv[]) {
     size_t frame_count = 0;
     while (!quit_requested) {
         frame_count += 1;
-        uint64_t start = stm_now();
 
-        // run emulation for one frame
-        c64_exec(&state.c64, FRAME_USEC);
+        // run emulation for the time since the previous frame
+        c64_exec(&state.c64, termout_frame_time());
 
         if ((frame_count == 150) && state.prg.ptr) {
             c64_quickload(&state.c64, state.prg);
@@ -187,19 +283,26 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        // render the frame in the terminal
-        convert_framebuffer();
-        term_home();
-        term_kitty_pixels();
-        fflush(stdout);
-
-        // sleep until next frame
-        double dur_usec = stm_us(stm_since(start));
-        if (dur_usec < FRAME_USEC) {
-            usleep(FRAME_USEC - dur_usec);
+        // render the frame in the terminal, unless the terminal is lagging
+        if (termout_begin_frame()) {
+            term_home();
+            if (state.shm.enabled) {
+                term_kitty_shm();
+            }
+            else {
+                term_kitty_pixels();
+            }
+            termout_end_frame();
         }
+
+        // sleep until next frame, while pushing out pending output
+        termout_wait(FRAME_USEC);
     }
+    const termout_stats_t stats = termout_stats();
+    termout_shutdown();
     endwin();
+    shm_shutdown();
+    print_stats(&stats);
     return 0;
 }
 
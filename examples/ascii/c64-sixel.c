@@ -7,6 +7,9 @@
 //  https://en.wikipedia.org/wiki/Sixel
 //
 //  Tested with iTerm2 3.x+ on macOS.
+//
+//  The emulation runs on wall clock time, the output is non-blocking (see
+//  termout.h), and frames are skipped while the terminal is lagging.
 //------------------------------------------------------------------------------
 #include <stdio.h>
 #include <stdint.h>
@@ -14,8 +17,7 @@
 #include <curses.h>     // curses is only used for non-blocking keyboard input
 #include <unistd.h>
 #include <signal.h>
-#define SOKOL_IMPL
-#include "sokol_time.h"
+#include "termout.h"
 #define CHIPS_IMPL
 #include "chips/chips_common.h"
 #include "chips/m6502.h"
@@ -48,7 +50,7 @@ static void catch_sigint(int signo) {
 
 // move cursor back to topleft
 static void term_home(void) {
-    printf("\033[0;0H");
+    termout_printf("\033[0;0H");
 }
 
 // Esc sequence to switch terminal into Sixel mode
@@ -56,18 +58,18 @@ static void term_sixel_begin(void) {
     const chips_display_info_t info = c64_display_info(&state.c64);
     const int w = 2 * info.screen.width;
     const int h = 2 * info.screen.height;
-    printf("\033Pq\"1;1;%d;%d", w, h);
+    termout_printf("\033Pq\"1;1;%d;%d", w, h);
 }
 
 // TODO: define the Sixel color palette
 static void term_sixel_colors(void) {
-    printf("#0;2;0;0;0"         // black
-           "#1;2;100;100;100");   // white
+    termout_printf("#0;2;0;0;0"         // black
+                   "#1;2;100;100;100");   // white
 }
 
 // flush terminal output for current frame
 static void term_flush(void) {
-    printf("\e\\\n");
+    termout_printf("\e\\\n");
 }
 
 // decode the pixel buffer into a sixel character sequence and send to terminal
@@ -93,8 +95,7 @@ static void term_sixel_pixels(void) {
         state.chrs[chr_pos++] = '$';
         state.chrs[chr_pos++] = '-';
     }
-    state.chrs[chr_pos++] = 0;
-    printf("%s", state.chrs);
+    termout_write(state.chrs, (size_t)chr_pos);
 }
 
 int main() {
@@ -110,8 +111,8 @@ int main() {
     nodelay(stdscr, TRUE);
     keypad(stdscr, TRUE);
 
-    // sokol time for rendering frames at correct speed
-    stm_setup();
+    // non-blocking output, the emulation runs on wall clock time
+    termout_init(&(termout_desc_t){0});
 
     // setup the C64 emulator
     c64_init(&state.c64, &(c64_desc_t){
@@ -123,10 +124,8 @@ int main() {
     });
 
     while (!quit_requested) {
-        uint64_t start = stm_now();
-
-        // run emulation for one frame
-        c64_exec(&state.c64, FRAME_USEC);
+        // run emulation for the time since the previous frame
+        c64_exec(&state.c64, termout_frame_time());
 
         // keyboard input
         int ch = getch();
@@ -154,19 +153,22 @@ int main() {
             }
         }
 
-        // render the frame in the terminal
-        term_home();
-        term_sixel_begin();
-        term_sixel_colors();
-        term_sixel_pixels();
-        term_flush();
-
-        // sleep until next frame
-        double dur_usec = stm_us(stm_since(start));
-        if (dur_usec < FRAME_USEC) {
-            usleep(FRAME_USEC - dur_usec);
+        // render the frame in the terminal, unless the terminal is lagging
+        if (termout_begin_frame()) {
+            term_home();
+            term_sixel_begin();
+            term_sixel_colors();
+            term_sixel_pixels();
+            term_flush();
+            termout_end_frame();
         }
+
+        // sleep until next frame, while pushing out pending output
+        termout_wait(FRAME_USEC);
     }
+    const termout_stats_t stats = termout_stats();
+    termout_shutdown();
     endwin();
+    termout_print_stats(&stats);
     return 0;
 }
@@ -4,6 +4,9 @@
     Stripped down KC85/4 emulator running in a (xterm-256color) terminal,
     rendering the ASCII buffer of the KC85 through curses. Requires a UNIX
     environment to build and run (tested on OSX and Linux).
+
+    The emulation runs on wall clock time, the screen is only refreshed
+    when the terminal accepts more output (see termout.h).
 */
 #include <stdint.h>
 #include <stdbool.h>
@@ -12,6 +15,7 @@
 #include <ctype.h>
 #include <signal.h>
 #include "keybuf.h"
+#include "termout.h"
 #define SOKOL_ARGS_IMPL
 #include "sokol_args.h"
 #define CHIPS_IMPL
@@ -114,12 +118,16 @@ int main(int argc, char* argv[]) {
     keypad(stdscr, TRUE);
     attron(A_BOLD);
 
+    // curses does the output, only check if the terminal keeps up
+    termout_init(&(termout_desc_t){ .measure_only = true });
+
     // run the emulation/input/render loop
     while (!quit_requested) {
         frame_count++;
 
-        // tick the emulator for 1 frame
-        kc85_exec(&kc85, FRAME_USEC);
+        // tick the emulator for the time since the previous frame
+        const uint32_t frame_time_us = termout_frame_time();
+        kc85_exec(&kc85, frame_time_us);
 
         // keyboard input
         int ch = getch();
@@ -148,11 +156,18 @@ int main(int argc, char* argv[]) {
             }
         }
         uint8_t key_code;
-        if (0 != (key_code = keybuf_get(FRAME_USEC))) {
+        if (0 != (key_code = keybuf_get(frame_time_us))) {
             kc85_key_down(&kc85, key_code);
             kc85_key_up(&kc85, key_code);
         }
 
+        // skip rendering while the terminal is lagging (this must skip
+        // all curses drawing, getch() refreshes a modified screen)
+        if (!termout_begin_frame()) {
+            termout_wait(FRAME_USEC);
+            continue;
+        }
+
         // render the display, most of this is an alternative video-memory
         // decoding, instead of the standard decoding to RGBA8 pixels, we'll decode
         // to curses color pairs and ASCII codes
@@ -196,10 +211,14 @@ int main(int argc, char* argv[]) {
             }
         }
         refresh();
+        termout_end_frame();
 
         // pause until next frame
-        usleep(FRAME_USEC);
+        termout_wait(FRAME_USEC);
     }
+    const termout_stats_t stats = termout_stats();
+    termout_shutdown();
     endwin();
+    termout_print_stats(&stats);
     return 0;
 }
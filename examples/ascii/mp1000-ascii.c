@@ -2,6 +2,9 @@
     mp1000.c
 
     Stripped down MP1000 emulator running in a (xterm-256color) terminal.
+
+    The emulation runs on wall clock time, the screen is only refreshed
+    when the terminal accepts more output (see termout.h).
 */
 #include <stdint.h>
 #include <stdbool.h>
@@ -9,6 +12,7 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <signal.h>
+#include "termout.h"
 #define CHIPS_IMPL
 #include "chips/chips_common.h"
 #include "chips/beeper.h"
@@ -150,10 +154,13 @@ int main(int argc, char* argv[]) {
     keypad(stdscr, TRUE);
     attron(A_BOLD);
 
+    // curses does the output, only check if the terminal keeps up
+    termout_init(&(termout_desc_t){ .measure_only = true });
+
     // run the emulation/input/render loop
     while (!quit_requested) {
-        // tick the emulator for 1 frame
-        mp1000_exec(&mp1000, FRAME_USEC);
+        // tick the emulator for the time since the previous frame
+        mp1000_exec(&mp1000, termout_frame_time());
 
         // keyboard input
         int ch = getch();
@@ -180,6 +187,12 @@ int main(int argc, char* argv[]) {
                 mp1000_key_up(&mp1000, ch);
             }
         }
+        // skip rendering while the terminal is lagging (this must skip
+        // all curses drawing, getch() refreshes a modified screen)
+        if (!termout_begin_frame()) {
+            termout_wait(FRAME_USEC);
+            continue;
+        }
         // render the PETSCII buffer
         int cur_color_pair = -1;
         //int bg = c64.vic.gunit.bg[0] & 0xF;
@@ -229,11 +242,15 @@ int main(int argc, char* argv[]) {
             }
         }
         refresh();
+        termout_end_frame();
         //fprintf(stderr, "c->PC: %x\n", mp1000.cpu.PC);
 
         // pause until next frame
-        usleep(FRAME_USEC);
+        termout_wait(FRAME_USEC);
     }
+    const termout_stats_t stats = termout_stats();
+    termout_shutdown();
     endwin();
+    termout_print_stats(&stats);
     return 0;
 }
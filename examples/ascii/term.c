@@ -0,0 +1,470 @@
+//------------------------------------------------------------------------------
+//  term.c
+//
+//  Generic terminal frontend for all home computer emulators. Renders the
+//  emulator framebuffer with 24-bit color Unicode half-block characters
+//  (see termgfx.h), so it works for graphics-mode software too, and only
+//  sends changed cells, which keeps the bandwidth low enough for SSH.
+//
+//  The emulation runs on wall clock time, the output is non-blocking (see
+//  termout.h), and frames are skipped while the terminal is lagging.
+//
+//  Compiled once per system, the system is selected with one of the
+//  CHIPS_TERM_* defines (see CMakeLists.txt).
+//
+//  Requires a terminal with UTF-8 and truecolor support.
+//
+//  Command line args:
+//
+//  file=[path]     load a file (quickload, or .txt/.bas as keyboard input)
+//  input=[text]    keyboard input
+//  stats           print the terminal output statistics at exit
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <curses.h>     // curses is only used for keyboard input and the terminal size
+#include <unistd.h>
+#include <signal.h>
+#include "keybuf.h"
+#include "termgfx.h"
+#include "termout.h"
+#define SOKOL_ARGS_IMPL
+#include "sokol_args.h"
+#define CHIPS_IMPL
+#if defined(CHIPS_TERM_KC85)
+#define CHIPS_KC85_TYPE_4
+#endif
+#include "chips/chips_common.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/clk.h"
+#if defined(CHIPS_TERM_C64)
+    #include "chips/m6502.h"
+    #include "chips/m6526.h"
+    #include "chips/m6569.h"
+    #include "chips/m6581.h"
+    #include "chips/beeper.h"
+    #include "systems/c1530.h"
+    #include "chips/m6522.h"
+    #include "systems/c1541.h"
+    #include "systems/c64.h"
+    #include "c64-roms.h"
+#elif defined(CHIPS_TERM_VIC20)
+    #include "chips/m6502.h"
+    #include "chips/m6522.h"
+    #include "chips/m6561.h"
+    #include "systems/c1530.h"
+    #include "systems/vic20.h"
+    #include "vic20-roms.h"
+#elif defined(CHIPS_TERM_ATOM)
+    #include "chips/m6502.h"
+    #include "chips/mc6847.h"
+    #include "chips/i8255.h"
+    #include "chips/m6522.h"
+    #include "chips/beeper.h"
+    #include "systems/atom.h"
+    #include "atom-roms.h"
+#elif defined(CHIPS_TERM_ZX)
+    #include "chips/z80.h"
+    #include "chips/beeper.h"
+    #include "chips/ay38910.h"
+    #include "systems/zx.h"
+    #include "zx-roms.h"
+#elif defined(CHIPS_TERM_CPC)
+    #include "chips/z80.h"
+    #include "chips/ay38910.h"
+    #include "chips/i8255.h"
+    #include "chips/mc6845.h"
+    #include "chips/am40010.h"
+    #include "chips/upd765.h"
+    #include "chips/fdd.h"
+    #include "chips/fdd_cpc.h"
+    #include "systems/cpc.h"
+    #include "cpc-roms.h"
+#elif defined(CHIPS_TERM_KC85)
+    #include "chips/z80.h"
+    #include "chips/z80ctc.h"
+    #include "chips/z80pio.h"
+    #include "chips/beeper.h"
+    #include "systems/kc85.h"
+    #include "kc85-roms.h"
+#elif defined(CHIPS_TERM_Z1013)
+    #include "chips/z80.h"
+    #include "chips/z80pio.h"
+    #include "systems/z1013.h"
+    #include "z1013-roms.h"
+#elif defined(CHIPS_TERM_Z9001)
+    #include "chips/z80.h"
+    #include "chips/z80pio.h"
+    #include "chips/z80ctc.h"
+    #include "chips/beeper.h"
+    #include "systems/z9001.h"
+    #include "z9001-roms.h"
+#else
+    #error "no CHIPS_TERM_* system selected"
+#endif
+
+// run the render-loop at 30fps
+#define FRAME_USEC (33333)
+// delay before loading a file, in frames
+#define LOAD_DELAY_FRAMES (90)
+
+static struct {
+    #if defined(CHIPS_TERM_C64)
+    c64_t sys;
+    #elif defined(CHIPS_TERM_VIC20)
+    vic20_t sys;
+    #elif defined(CHIPS_TERM_ATOM)
+    atom_t sys;
+    #elif defined(CHIPS_TERM_ZX)
+    zx_t sys;
+    #elif defined(CHIPS_TERM_CPC)
+    cpc_t sys;
+    #elif defined(CHIPS_TERM_KC85)
+    kc85_t sys;
+    #elif defined(CHIPS_TERM_Z1013)
+    z1013_t sys;
+    #elif defined(CHIPS_TERM_Z9001)
+    z9001_t sys;
+    #endif
+    uint32_t frame_count;
+    chips_range_t file;
+    uint8_t file_buf[1<<20];
+} state;
+
+// system specific wrappers
+#if defined(CHIPS_TERM_C64)
+#define SYS_KEY_DELAY_FRAMES (5)
+#define SYS_KEY_BACKSPACE (0x01)
+#define SYS_KEY_ESCAPE (0x03)
+#define SYS_INVERT_CASE (true)
+static const chips_dim_t pixel_aspect = { 1, 1 };
+static void sys_init(void) {
+    c64_init(&state.sys, &(c64_desc_t){
+        .roms = {
+            .chars = { .ptr=dump_c64_char_bin, .size=sizeof(dump_c64_char_bin) },
+            .basic = { .ptr=dump_c64_basic_bin, .size=sizeof(dump_c64_basic_bin) },
+            .kernal = { .ptr=dump_c64_kernalv3_bin, .size=sizeof(dump_c64_kernalv3_bin) },
+        },
+    });
+}
+static void sys_exec(uint32_t micro_seconds) { c64_exec(&state.sys, micro_seconds); }
+static void sys_key(int c) { c64_key_down(&state.sys, c); c64_key_up(&state.sys, c); }
+static chips_display_info_t sys_display_info(void) { return c64_display_info(&state.sys); }
+static bool sys_quickload(chips_range_t data) {
+    if (c64_quickload(&state.sys, data)) {
+        keybuf_put("RUN\n");
+        return true;
+    }
+    return false;
+}
+#elif defined(CHIPS_TERM_VIC20)
+#define SYS_KEY_DELAY_FRAMES (5)
+#define SYS_KEY_BACKSPACE (0x01)
+#define SYS_KEY_ESCAPE (0x03)
+#define SYS_INVERT_CASE (true)
+static const chips_dim_t pixel_aspect = { 3, 2 };
+static void sys_init(void) {
+    vic20_init(&state.sys, &(vic20_desc_t){
+        .roms = {
+            .chars = { .ptr=dump_vic20_characters_901460_03_bin, .size=sizeof(dump_vic20_characters_901460_03_bin) },
+            .basic = { .ptr=dump_vic20_basic_901486_01_bin, .size=sizeof(dump_vic20_basic_901486_01_bin) },
+            .kernal = { .ptr=dump_vic20_kernal_901486_07_bin, .size=sizeof(dump_vic20_kernal_901486_07_bin) },
+        },
+    });
+}
+static void sys_exec(uint32_t micro_seconds) { vic20_exec(&state.sys, micro_seconds); }
+static void sys_key(int c) { vic20_key_down(&state.sys, c); vic20_key_up(&state.sys, c); }
+static chips_display_info_t sys_display_info(void) { return vic20_display_info(&state.sys); }
+static bool sys_quickload(chips_range_t data) {
+    if (vic20_quickload(&state.sys, data)) {
+        keybuf_put("RUN\n");
+        return true;
+    }
+    return false;
+}
+#elif defined(CHIPS_TERM_ATOM)
+#define SYS_KEY_DELAY_FRAMES (10)
+#define SYS_KEY_BACKSPACE (0x01)
+#define SYS_KEY_ESCAPE (0x1B)
+#define SYS_INVERT_CASE (true)
+static const chips_dim_t pixel_aspect = { 1, 1 };
+static void sys_init(void) {
+    atom_init(&state.sys, &(atom_desc_t){
+        .roms = {
+            .abasic = { .ptr=dump_abasic_ic20, .size = sizeof(dump_abasic_ic20) },
+            .afloat = { .ptr=dump_afloat_ic21, .size = sizeof(dump_afloat_ic21) },
+            .dosrom = { .ptr=dump_dosrom_u15, .size = sizeof(dump_dosrom_u15) }
+        },
+    });
+}
+static void sys_exec(uint32_t micro_seconds) { atom_exec(&state.sys, micro_seconds); }
+static void sys_key(int c) { atom_key_down(&state.sys, c); atom_key_up(&state.sys, c); }
+static chips_display_info_t sys_display_info(void) { return atom_display_info(&state.sys); }
+static bool sys_quickload(chips_range_t data) {
+    // the Atom has no quickload, only tape files
+    return atom_insert_tape(&state.sys, data);
+}
+#elif defined(CHIPS_TERM_ZX)
+#define SYS_KEY_DELAY_FRAMES (6)
+#define SYS_KEY_BACKSPACE (0x0C)
+#define SYS_KEY_ESCAPE (0x07)
+#define SYS_INVERT_CASE (false)
+static const chips_dim_t pixel_aspect = { 1, 1 };
+static void sys_init(void) {
+    zx_init(&state.sys, &(zx_desc_t){
+        .type = ZX_TYPE_48K,
+        .joystick_type = ZX_JOYSTICKTYPE_NONE,
+        .roms = {
+            .zx48k = { .ptr=dump_amstrad_zx48k_bin, .size=sizeof(dump_amstrad_zx48k_bin) },
+            .zx128_0 = { .ptr=dump_amstrad_zx128k_0_bin, .size=sizeof(dump_amstrad_zx128k_0_bin) },
+            .zx128_1 = { .ptr=dump_amstrad_zx128k_1_bin, .size=sizeof(dump_amstrad_zx128k_1_bin) },
+        },
+    });
+}
+static void sys_exec(uint32_t micro_seconds) { zx_exec(&state.sys, micro_seconds); }
+static void sys_key(int c) { zx_key_down(&state.sys, c); zx_key_up(&state.sys, c); }
+static chips_display_info_t sys_display_info(void) { return zx_display_info(&state.sys); }
+static bool sys_quickload(chips_range_t data) { return zx_quickload(&state.sys, data); }
+#elif defined(CHIPS_TERM_CPC)
+#define SYS_KEY_DELAY_FRAMES (7)
+#define SYS_KEY_BACKSPACE (0x01)
+#define SYS_KEY_ESCAPE (0x03)
+#define SYS_INVERT_CASE (false)
+static const chips_dim_t pixel_aspect = { 1, 2 };
+static void sys_init(void) {
+    cpc_init(&state.sys, &(cpc_desc_t){
+        .type = CPC_TYPE_6128,
+        .joystick_type = CPC_JOYSTICK_NONE,
+        .roms = {
+            .cpc464 = {
+                .os = { .ptr=dump_cpc464_os_bin, .size=sizeof(dump_cpc464_os_bin) },
+                .basic = { .ptr=dump_cpc464_basic_bin, .size=sizeof(dump_cpc464_basic_bin) },
+            },
+            .cpc6128 = {
+                .os = { .ptr=dump_cpc6128_os_bin, .size=sizeof(dump_cpc6128_os_bin) },
+                .basic = { .ptr=dump_cpc6128_basic_bin, .size= sizeof(dump_cpc6128_basic_bin) },
+                .amsdos = { .ptr=dump_cpc6128_amsdos_bin, .size=sizeof(dump_cpc6128_amsdos_bin) }
+            },
+            .kcc = {
+                .os = { .ptr=dump_kcc_os_bin, .size=sizeof(dump_kcc_os_bin) },
+                .basic = { .ptr=dump_kcc_bas_bin, .size=sizeof(dump_kcc_bas_bin) }
+            },
+        },
+    });
+}
+static void sys_exec(uint32_t micro_seconds) { cpc_exec(&state.sys, micro_seconds); }
+static void sys_key(int c) { cpc_key_down(&state.sys, c); cpc_key_up(&state.sys, c); }
+static chips_display_info_t sys_display_info(void) { return cpc_display_info(&state.sys); }
+static bool sys_quickload(chips_range_t data) { return cpc_quickload(&state.sys, data); }
+#elif defined(CHIPS_TERM_KC85)
+#define SYS_KEY_DELAY_FRAMES (10)
+#define SYS_KEY_BACKSPACE (0x01)
+#define SYS_KEY_ESCAPE (0x03)
+#define SYS_INVERT_CASE (true)
+static const chips_dim_t pixel_aspect = { 1, 1 };
+static void sys_init(void) {
+    kc85_init(&state.sys, &(kc85_desc_t){
+        .roms = {
+            .caos42c = { .ptr=dump_caos42c_854, .size=sizeof(dump_caos42c_854) },
+            .caos42e = { .ptr=dump_caos42e_854, .size=sizeof(dump_caos42e_854) },
+            .kcbasic = { .ptr=dump_basic_c0_853, .size=sizeof(dump_basic_c0_853) }
+        },
+    });
+}
+static void sys_exec(uint32_t micro_seconds) { kc85_exec(&state.sys, micro_seconds); }
+static void sys_key(int c) { kc85_key_down(&state.sys, c); kc85_key_up(&state.sys, c); }
+static chips_display_info_t sys_display_info(void) { return kc85_display_info(&state.sys); }
+static bool sys_quickload(chips_range_t data) { return kc85_quickload(&state.sys, data); }
+#elif defined(CHIPS_TERM_Z1013)
+#define SYS_KEY_DELAY_FRAMES (6)
+#define SYS_KEY_BACKSPACE (0x08)
+#define SYS_KEY_ESCAPE (0x03)
+#define SYS_INVERT_CASE (true)
+static const chips_dim_t pixel_aspect = { 1, 1 };
+static void sys_init(void) {
+    z1013_init(&state.sys, &(z1013_desc_t){
+        .type = Z1013_TYPE_64,
+        .roms = {
+            .mon_a2 = { .ptr=dump_z1013_mon_a2_bin, .size=sizeof(dump_z1013_mon_a2_bin) },
+            .mon202 = { .ptr=dump_z1013_mon202_bin, .size=sizeof(dump_z1013_mon202_bin) },
+            .font = { .ptr=dump_z1013_font_bin, .size=sizeof(dump_z1013_font_bin) }
+        },
+    });
+}
+static void sys_exec(uint32_t micro_seconds) { z1013_exec(&state.sys, micro_seconds); }
+static void sys_key(int c) { z1013_key_down(&state.sys, c); z1013_key_up(&state.sys, c); }
+static chips_display_info_t sys_display_info(void) { return z1013_display_info(&state.sys); }
+static bool sys_quickload(chips_range_t data) { return z1013_quickload(&state.sys, data); }
+#elif defined(CHIPS_TERM_Z9001)
+#define SYS_KEY_DELAY_FRAMES (12)
+#define SYS_KEY_BACKSPACE (0x08)
+#define SYS_KEY_ESCAPE (0x03)
+#define SYS_INVERT_CASE (true)
+static const chips_dim_t pixel_aspect = { 1, 1 };
+static void sys_init(void) {
+    z9001_init(&state.sys, &(z9001_desc_t){
+        .type = Z9001_TYPE_Z9001,
+        .roms = {
+            .z9001 = {
+                .os_1  = { .ptr=dump_z9001_os12_1_bin, .size=sizeof(dump_z9001_os12_1_bin) },
+                .os_2  = { .ptr=dump_z9001_os12_2_bin, .size=sizeof(dump_z9001_os12_2_bin) },
+                .basic = { .ptr=dump_z9001_basic_507_511_bin, .size=sizeof(dump_z9001_basic_507_511_bin) },
+                .font  = { .ptr=dump_z9001_font_bin, .size=sizeof(dump_z9001_font_bin) },
+            },
+        },
+    });
+}
+static void sys_exec(uint32_t micro_seconds) { z9001_exec(&state.sys, micro_seconds); }
+static void sys_key(int c) { z9001_key_down(&state.sys, c); z9001_key_up(&state.sys, c); }
+static chips_display_info_t sys_display_info(void) { return z9001_display_info(&state.sys); }
+static bool sys_quickload(chips_range_t data) { return z9001_quickload(&state.sys, data); }
+#endif
+
+// a signal handler for Ctrl-C, for proper cleanup
+static int quit_requested = 0;
+static void catch_sigint(int signo) {
+    (void)signo;
+    quit_requested = 1;
+}
+
+static bool has_ext(const char* path, const char* ext) {
+    const char* dot = strrchr(path, '.');
+    return dot && (0 == strcmp(dot + 1, ext));
+}
+
+static bool load_file(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return false;
+    }
+    // keep room for a terminating zero, text files are fed into the keybuf
+    size_t bytes_read = fread(state.file_buf, 1, sizeof(state.file_buf) - 1, fp);
+    fclose(fp);
+    state.file_buf[bytes_read] = 0;
+    state.file = (chips_range_t){ .ptr = state.file_buf, .size = bytes_read };
+    return bytes_read > 0;
+}
+
+static void handle_file_loading(void) {
+    if (state.file.ptr && (state.frame_count > LOAD_DELAY_FRAMES)) {
+        const char* path = sargs_value("file");
+        if (has_ext(path, "txt") || has_ext(path, "bas")) {
+            keybuf_put((const char*)state.file.ptr);
+        }
+        else {
+            sys_quickload(state.file);
+        }
+        if (sargs_exists("input")) {
+            keybuf_put(sargs_value("input"));
+        }
+        state.file = (chips_range_t){0};
+    }
+}
+
+static void handle_input(uint32_t frame_time_us) {
+    int ch = getch();
+    if (ch == KEY_RESIZE) {
+        termgfx_resize(COLS, LINES);
+    }
+    else if (ch != ERR) {
+        switch (ch) {
+            case 10:  ch = 0x0D; break;             // ENTER
+            case 127: ch = SYS_KEY_BACKSPACE; break;    // BACKSPACE
+            case 27:  ch = SYS_KEY_ESCAPE; break;       // ESCAPE
+            case 260: ch = 0x08; break;             // LEFT
+            case 261: ch = 0x09; break;             // RIGHT
+            case 259: ch = 0x0B; break;             // UP
+            case 258: ch = 0x0A; break;             // DOWN
+            default: break;
+        }
+        // need to invert case (unshifted is upper caps, shifted is lower caps)
+        if (SYS_INVERT_CASE && (ch > 32)) {
+            if (islower(ch)) {
+                ch = toupper(ch);
+            }
+            else if (isupper(ch)) {
+                ch = tolower(ch);
+            }
+        }
+        if (ch < 256) {
+            sys_key(ch);
+        }
+    }
+    uint8_t key_code;
+    if (0 != (key_code = keybuf_get(frame_time_us))) {
+        sys_key(key_code);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    sargs_setup(&(sargs_desc){ .argc=argc, .argv=argv });
+    keybuf_init(&(keybuf_desc_t){ .key_delay_frames = SYS_KEY_DELAY_FRAMES });
+    if (sargs_exists("file")) {
+        if (!load_file(sargs_value("file"))) {
+            printf("Failed to load '%s'\n", sargs_value("file"));
+            return 10;
+        }
+    }
+    else if (sargs_exists("input")) {
+        keybuf_put(sargs_value("input"));
+    }
+
+    // install a Ctrl-C signal handler
+    signal(SIGINT, catch_sigint);
+
+    // setup curses for non-blocking keyboard input, rendering goes
+    // directly to stdout
+    initscr();
+    noecho();
+    curs_set(FALSE);
+    cbreak();
+    nodelay(stdscr, TRUE);
+    keypad(stdscr, TRUE);
+
+    // non-blocking output, the emulation runs on wall clock time
+    termout_init(&(termout_desc_t){0});
+
+    sys_init();
+    termgfx_init(&(termgfx_desc_t){
+        .cols = COLS,
+        .rows = LINES,
+        .pixel_aspect = pixel_aspect,
+        .write_cb = termout_write,
+    });
+
+    while (!quit_requested) {
+        state.frame_count++;
+
+        // run emulation for the time since the previous frame
+        const uint32_t frame_time_us = termout_frame_time();
+        sys_exec(frame_time_us);
+        handle_file_loading();
+        handle_input(frame_time_us);
+
+        // render the frame in the terminal, only changed cells are sent,
+        // skip the frame if the terminal hasn't caught up yet
+        if (termout_begin_frame()) {
+            termgfx_draw(sys_display_info());
+            termout_end_frame();
+        }
+
+        // sleep until next frame, while pushing out pending output
+        termout_wait(FRAME_USEC);
+    }
+    const termgfx_stats_t stats = termgfx_stats();
+    termgfx_shutdown();
+    const termout_stats_t out_stats = termout_stats();
+    termout_shutdown();
+    endwin();
+    if (sargs_exists("stats") && (stats.frame_count > 0)) {
+        printf("%d x %d cells, %u frames, %.1f bytes per frame\n",
+            stats.cols, stats.rows, stats.frame_count,
+            (double)stats.total_bytes / (double)stats.frame_count);
+        termout_print_stats(&out_stats);
+    }
+    return 0;
+}
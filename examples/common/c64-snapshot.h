@@ -0,0 +1,23 @@
+#pragma once
+/*
+    The parts of a c64_t which are left out of compact snapshots (see
+    snapshot.h), shared by the C64 emulator and the c64-bench tool.
+
+    The ROMs (including the ROM of the optional C1541 floppy drive) are
+    identical in all instances with the same configuration and are taken
+    from the running instance, the framebuffer and audio samples are
+    regenerated. Since the C1541 ROM is only present in an instance with
+    the drive enabled, snapshots must be rejected when the drive config
+    differs (the C64 emulator records it in its snapshot header).
+
+    Include after systems/c64.h and snapshot.h.
+*/
+static const snapshot_range_t c64_snapshot_exclude[] = {
+    SNAPSHOT_RANGE(c64_t, rom_char),
+    SNAPSHOT_RANGE(c64_t, rom_basic),
+    SNAPSHOT_RANGE(c64_t, rom_kernal),
+    SNAPSHOT_RANGE(c64_t, c1541.rom),
+    SNAPSHOT_RANGE(c64_t, fb),
+    SNAPSHOT_RANGE(c64_t, audio.sample_buffer),
+};
+#define C64_SNAPSHOT_NUM_EXCLUDE ((int)(sizeof(c64_snapshot_exclude) / sizeof(snapshot_range_t)))
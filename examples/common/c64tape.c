@@ -0,0 +1,133 @@
+#include "c64tape.h"
+#include <string.h>
+#include <assert.h>
+
+typedef struct {
+    bool valid;
+    int version;
+    uint32_t num_pulses;
+    int num_blocks;
+    uint64_t num_cycles;
+    c64tape_block_t blocks[C64TAPE_MAX_BLOCKS];
+} c64tape_state_t;
+static c64tape_state_t state;
+
+static const uint8_t _c64tape_sig[12] = { 'C', '6', '4', '-', 'T', 'A', 'P', 'E', '-', 'R', 'A', 'W' };
+
+static uint32_t _c64tape_u24(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+}
+
+static uint32_t _c64tape_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void c64tape_init(void) {
+    memset(&state, 0, sizeof(state));
+    state.valid = true;
+}
+
+bool c64tape_insert(chips_range_t data) {
+    assert(state.valid);
+    assert(data.ptr);
+    c64tape_eject();
+    const uint8_t* p = (const uint8_t*)data.ptr;
+    if ((data.size < C64TAPE_HEADER_SIZE) || (0 != memcmp(p, _c64tape_sig, sizeof(_c64tape_sig)))) {
+        return false;
+    }
+    state.version = p[12];
+    if (state.version > 1) {
+        return false;
+    }
+    // some tools write a wrong data size, don't read past the end of the file
+    uint32_t end = C64TAPE_HEADER_SIZE + _c64tape_u32(&p[16]);
+    if ((end < C64TAPE_HEADER_SIZE) || (end > data.size)) {
+        end = (uint32_t)data.size;
+    }
+    bool in_pause = true;
+    uint32_t pos = C64TAPE_HEADER_SIZE;
+    while (pos < end) {
+        const uint32_t offset = pos;
+        uint32_t cycles = p[pos++] * 8;
+        if (cycles == 0) {
+            // overflow: an unspecified long pause in version 0, a 24-bit cycle count in version 1
+            if (state.version == 0) {
+                cycles = C64TAPE_PAUSE_CYCLES;
+            }
+            else if ((pos + 3) <= end) {
+                cycles = _c64tape_u24(&p[pos]);
+                pos += 3;
+                if (cycles == 0) {
+                    continue;
+                }
+            }
+            else {
+                break;
+            }
+        }
+        const bool is_pause = cycles >= C64TAPE_PAUSE_CYCLES;
+        if (in_pause && !is_pause && (state.num_blocks < C64TAPE_MAX_BLOCKS)) {
+            state.blocks[state.num_blocks++] = (c64tape_block_t){
+                .pulse = state.num_pulses,
+                .tap_offset = offset,
+                .cycle = state.num_cycles,
+            };
+        }
+        in_pause = is_pause;
+        state.num_pulses++;
+        state.num_cycles += cycles;
+    }
+    if (state.num_blocks == 0) {
+        c64tape_eject();
+        return false;
+    }
+    return true;
+}
+
+void c64tape_eject(void) {
+    assert(state.valid);
+    state.version = 0;
+    state.num_pulses = 0;
+    state.num_blocks = 0;
+    state.num_cycles = 0;
+}
+
+bool c64tape_inserted(void) {
+    assert(state.valid);
+    return state.num_blocks > 0;
+}
+
+c64tape_status_t c64tape_status(void) {
+    assert(state.valid);
+    return (c64tape_status_t){
+        .version = state.version,
+        .num_pulses = state.num_pulses,
+        .num_blocks = state.num_blocks,
+        .num_cycles = state.num_cycles,
+    };
+}
+
+c64tape_block_t c64tape_block(int index) {
+    assert(state.valid);
+    assert((index >= 0) && (index < state.num_blocks));
+    return state.blocks[index];
+}
+
+int c64tape_block_at_offset(uint32_t tap_offset) {
+    assert(state.valid);
+    // binary search for the last block starting at or before the offset
+    int lo = 0;
+    int hi = state.num_blocks - 1;
+    int res = 0;
+    while (lo <= hi) {
+        const int mid = (lo + hi) / 2;
+        if (state.blocks[mid].tap_offset <= tap_offset) {
+            res = mid;
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+    return res;
+}
@@ -0,0 +1,58 @@
+#pragma once
+/*
+    C64 tape images (.tap) block index.
+
+    The TAP image is parsed once on insert. Pulses longer than any data
+    pulse (TAP overflow values) are pauses, each block starts at the first
+    data pulse after a pause. The block index stores the pulse index, TAP
+    file offset and tape time of each block start, c64tape_block_at_offset()
+    maps the datasette's read position in the TAP image to a block.
+
+    The emulated datasette plays the TAP image itself, this module only
+    looks at it.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chips/chips_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define C64TAPE_MAX_BLOCKS (1024)
+#define C64TAPE_HEADER_SIZE (20)
+// pulses of this length and longer are pauses between blocks
+#define C64TAPE_PAUSE_CYCLES (256 * 8)
+
+typedef struct {
+    uint32_t pulse;         // index of the first pulse of the block
+    uint32_t tap_offset;    // offset of the first pulse in the TAP image
+    uint64_t cycle;         // tape time at the start of the block in CPU cycles
+} c64tape_block_t;
+
+typedef struct {
+    int version;            // TAP version (0 or 1)
+    uint32_t num_pulses;
+    int num_blocks;
+    uint64_t num_cycles;    // tape length in CPU cycles
+} c64tape_status_t;
+
+// initialize the tape module (no tape inserted)
+void c64tape_init(void);
+// parse a .tap image (version 0 or 1) into the block index
+bool c64tape_insert(chips_range_t data);
+// remove the tape
+void c64tape_eject(void);
+// return true if a tape is inserted
+bool c64tape_inserted(void);
+// get the number of pulses and blocks
+c64tape_status_t c64tape_status(void);
+// get a block index entry
+c64tape_block_t c64tape_block(int index);
+// find the block containing a TAP file offset (e.g. the datasette's read position)
+int c64tape_block_at_offset(uint32_t tap_offset);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
@@ -5,8 +5,12 @@
 typedef struct {
     bool valid;
     uint64_t cur_time;
+    bool held;
 } clock_state_t;
 static clock_state_t state;
+// not part of clock_state_t because it must survive clock_init() on reboot
+static uint32_t fixed_frame_time_us;
+static bool (*hold_cb)(void);
 
 void clock_init(void) {
     state = (clock_state_t) {
@@ -17,6 +21,15 @@ void clock_init(void) {
 
 uint32_t clock_frame_time(void) {
     assert(state.valid);
+    state.held = false;
+    if (fixed_frame_time_us > 0) {
+        if (hold_cb && hold_cb()) {
+            state.held = true;
+            return 0;
+        }
+        state.cur_time += fixed_frame_time_us;
+        return fixed_frame_time_us;
+    }
     uint32_t frame_time_us = (uint32_t) (sapp_frame_duration() * 1000000.0);
     // prevent death-spiral on host systems that are too slow to emulate
     // in real time, or during long frames (e.g. debugging)
@@ -31,3 +44,16 @@ uint32_t clock_frame_count_60hz(void) {
     assert(state.valid);
     return (uint32_t) (state.cur_time / 16667);
 }
+
+void clock_set_fixed_frame_time(uint32_t frame_time_us) {
+    fixed_frame_time_us = frame_time_us;
+}
+
+void clock_set_hold_callback(bool (*cb)(void)) {
+    hold_cb = cb;
+}
+
+bool clock_frame_held(void) {
+    assert(state.valid);
+    return state.held;
+}
@@ -1,6 +1,13 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
 
 void clock_init(void);
 uint32_t clock_frame_time(void);
 uint32_t clock_frame_count_60hz(void);
+// force a fixed frame time for deterministic runs (0 to disable), survives clock_init()
+void clock_set_fixed_frame_time(uint32_t frame_time_us);
+// in fixed frame time mode, return a frame time of 0 while the callback returns true, survives clock_init()
+void clock_set_hold_callback(bool (*hold_cb)(void));
+// true if the last clock_frame_time() call held the emulation
+bool clock_frame_held(void);
@@ -8,8 +8,10 @@
 #include "sokol_log.h"
 #include "clock.h"
 #include "prof.h"
+#include "slice.h"
 #include "fs.h"
 #include "gfx.h"
 #include "keybuf.h"
 #include "webapi.h"
 #include <ctype.h> // isupper, islower, toupper, tolower
+#include <stdlib.h> // atoi
@@ -0,0 +1,526 @@
+#include "d64.h"
+#include <string.h>
+#include <assert.h>
+
+#define D64_SIZE_35 (683 * D64_SECTOR_SIZE)
+#define D64_SIZE_35_ERRORS (D64_SIZE_35 + 683)
+#define D64_SIZE_40 (768 * D64_SECTOR_SIZE)
+#define D64_SIZE_40_ERRORS (D64_SIZE_40 + 768)
+#define D64_G64_HEADER_SIZE (12)
+#define D64_SYNC_BYTES (5)
+#define D64_HEADER_GAP_BYTES (9)
+#define D64_GCR_HEADER_BYTES (10)       // 8 header bytes GCR-encoded
+#define D64_GCR_DATA_BYTES (325)        // 260 data block bytes GCR-encoded
+#define D64_GCR_SECTOR_BYTES (D64_SYNC_BYTES + D64_GCR_HEADER_BYTES + D64_HEADER_GAP_BYTES + D64_SYNC_BYTES + D64_GCR_DATA_BYTES)
+
+typedef struct {
+    bool valid;
+    d64_format_t format;
+    int num_tracks;
+    int track_sector_index[D64_MAX_TRACKS + 1];     // index of the first sector of each track
+    uint8_t sectors[D64_MAX_SECTORS][D64_SECTOR_SIZE];
+    uint8_t load_buf[D64_MAX_FILE_SIZE];
+} d64_state_t;
+static d64_state_t state;
+
+// 4-bit nybble to 5-bit GCR code, and the reverse (0xFF for invalid codes)
+static const uint8_t _d64_gcr_table[16] = {
+    0x0A, 0x0B, 0x12, 0x13, 0x0E, 0x0F, 0x16, 0x17,
+    0x09, 0x19, 0x1A, 0x1B, 0x0D, 0x1D, 0x1E, 0x15,
+};
+static uint8_t _d64_gcr_decode_table[32];
+
+static int _d64_sectors_per_track(int track) {
+    if (track <= 17) return 21;
+    else if (track <= 24) return 19;
+    else if (track <= 30) return 18;
+    else return 17;
+}
+
+void d64_init(void) {
+    memset(&state, 0, sizeof(state));
+    state.valid = true;
+    int index = 0;
+    for (int track = 1; track <= D64_MAX_TRACKS; track++) {
+        state.track_sector_index[track] = index;
+        index += _d64_sectors_per_track(track);
+    }
+    assert(index == D64_MAX_SECTORS);
+    memset(_d64_gcr_decode_table, 0xFF, sizeof(_d64_gcr_decode_table));
+    for (int i = 0; i < 16; i++) {
+        _d64_gcr_decode_table[_d64_gcr_table[i]] = (uint8_t)i;
+    }
+}
+
+static bool _d64_valid_sector(int track, int sector) {
+    return (track >= 1) && (track <= state.num_tracks) && (sector >= 0) && (sector < _d64_sectors_per_track(track));
+}
+
+static uint8_t* _d64_sector(int track, int sector) {
+    return state.sectors[state.track_sector_index[track] + sector];
+}
+
+// read a bit from a circular GCR track
+static inline int _d64_bit(const uint8_t* data, int num_bits, int pos) {
+    pos %= num_bits;
+    return (data[pos >> 3] >> (7 - (pos & 7))) & 1;
+}
+
+// find the end of the next sync mark (10 or more 1-bits), returns bit position or -1
+static int _d64_find_sync(const uint8_t* data, int num_bits, int pos, int end_pos) {
+    int ones = 0;
+    for (; pos < end_pos; pos++) {
+        if (_d64_bit(data, num_bits, pos)) {
+            ones++;
+        }
+        else {
+            if (ones >= 10) {
+                return pos;
+            }
+            ones = 0;
+        }
+    }
+    return -1;
+}
+
+// decode GCR bits into bytes, returns false on invalid GCR codes
+static bool _d64_gcr_decode(const uint8_t* data, int num_bits, int pos, uint8_t* dst, int num_bytes) {
+    for (int i = 0; i < num_bytes * 2; i++) {
+        uint8_t code = 0;
+        for (int b = 0; b < 5; b++) {
+            code = (uint8_t)((code << 1) | _d64_bit(data, num_bits, pos++));
+        }
+        const uint8_t nybble = _d64_gcr_decode_table[code];
+        if (nybble == 0xFF) {
+            return false;
+        }
+        if (i & 1) {
+            dst[i >> 1] |= nybble;
+        }
+        else {
+            dst[i >> 1] = (uint8_t)(nybble << 4);
+        }
+    }
+    return true;
+}
+
+// decode all sectors of a GCR track into the sector image
+static void _d64_gcr_decode_track(int track, const uint8_t* data, int size) {
+    const int num_bits = size * 8;
+    int pos = 0;
+    // scan a bit more than one revolution to catch a sector wrapping around the index
+    const int end_pos = num_bits + (D64_GCR_SECTOR_BYTES * 8);
+    while ((pos = _d64_find_sync(data, num_bits, pos, end_pos)) >= 0) {
+        uint8_t hdr[8];
+        if (!_d64_gcr_decode(data, num_bits, pos, hdr, 8) || (hdr[0] != 0x08)) {
+            continue;
+        }
+        const int sector = hdr[2];
+        if ((hdr[3] != track) || !_d64_valid_sector(track, sector)) {
+            continue;
+        }
+        pos = _d64_find_sync(data, num_bits, pos + D64_GCR_HEADER_BYTES * 8, end_pos);
+        if (pos < 0) {
+            break;
+        }
+        uint8_t blk[260];
+        if (!_d64_gcr_decode(data, num_bits, pos, blk, 260) || (blk[0] != 0x07)) {
+            continue;
+        }
+        memcpy(_d64_sector(track, sector), &blk[1], D64_SECTOR_SIZE);
+        pos += D64_GCR_DATA_BYTES * 8;
+    }
+}
+
+static uint32_t _d64_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool _d64_insert_g64(const uint8_t* ptr, size_t size) {
+    if ((size < D64_G64_HEADER_SIZE) || (0 != memcmp(ptr, "GCR-1541", 8))) {
+        return false;
+    }
+    const int num_half_tracks = ptr[9];
+    if (size < (D64_G64_HEADER_SIZE + (size_t)num_half_tracks * 8)) {
+        return false;
+    }
+    // first pass: find the number of tracks, and validate track offsets
+    state.num_tracks = 35;
+    for (int i = 0; i < num_half_tracks; i += 2) {
+        const int track = (i / 2) + 1;
+        const uint32_t offset = _d64_u32(&ptr[D64_G64_HEADER_SIZE + i * 4]);
+        if (offset == 0) {
+            continue;
+        }
+        if ((offset + 2) > size) {
+            return false;
+        }
+        const uint32_t track_size = ptr[offset] | (ptr[offset + 1] << 8);
+        if ((track_size > D64_MAX_GCR_TRACK_SIZE) || ((offset + 2 + track_size) > size)) {
+            return false;
+        }
+        if ((track > state.num_tracks) && (track <= D64_MAX_TRACKS)) {
+            state.num_tracks = D64_MAX_TRACKS;
+        }
+    }
+    // second pass: decode the sectors, half tracks are ignored
+    for (int i = 0; i < num_half_tracks; i += 2) {
+        const int track = (i / 2) + 1;
+        const uint32_t offset = _d64_u32(&ptr[D64_G64_HEADER_SIZE + i * 4]);
+        if ((offset == 0) || (track > state.num_tracks)) {
+            continue;
+        }
+        // a track shorter than one sector can't hold any (and an empty track
+        // would break the bit position wrap-around in _d64_bit())
+        const int track_size = ptr[offset] | (ptr[offset + 1] << 8);
+        if (track_size < D64_GCR_SECTOR_BYTES) {
+            continue;
+        }
+        _d64_gcr_decode_track(track, &ptr[offset + 2], track_size);
+    }
+    return true;
+}
+
+bool d64_insert(chips_range_t data) {
+    assert(state.valid);
+    assert(data.ptr);
+    d64_eject();
+    const uint8_t* ptr = (const uint8_t*)data.ptr;
+    if ((data.size >= 8) && (0 == memcmp(ptr, "GCR-1541", 8))) {
+        if (!_d64_insert_g64(ptr, data.size)) {
+            d64_eject();
+            return false;
+        }
+        state.format = D64_FORMAT_G64;
+        return true;
+    }
+    // D64 images are identified by size, the optional error bytes are ignored
+    switch (data.size) {
+        case D64_SIZE_35:
+        case D64_SIZE_35_ERRORS:
+            state.num_tracks = 35;
+            memcpy(state.sectors, ptr, D64_SIZE_35);
+            break;
+        case D64_SIZE_40:
+        case D64_SIZE_40_ERRORS:
+            state.num_tracks = 40;
+            memcpy(state.sectors, ptr, D64_SIZE_40);
+            break;
+        default:
+            return false;
+    }
+    state.format = D64_FORMAT_D64;
+    return true;
+}
+
+void d64_eject(void) {
+    assert(state.valid);
+    state.format = D64_FORMAT_NONE;
+    state.num_tracks = 0;
+    memset(state.sectors, 0, sizeof(state.sectors));
+}
+
+bool d64_inserted(void) {
+    assert(state.valid);
+    return state.format != D64_FORMAT_NONE;
+}
+
+int d64_num_tracks(void) {
+    assert(state.valid);
+    return state.num_tracks;
+}
+
+int d64_num_sectors(int track) {
+    assert(state.valid);
+    return ((track >= 1) && (track <= state.num_tracks)) ? _d64_sectors_per_track(track) : 0;
+}
+
+const uint8_t* d64_read_sector(int track, int sector) {
+    assert(state.valid);
+    return _d64_valid_sector(track, sector) ? _d64_sector(track, sector) : 0;
+}
+
+bool d64_write_sector(int track, int sector, const uint8_t* data) {
+    assert(state.valid && data);
+    if (!_d64_valid_sector(track, sector)) {
+        return false;
+    }
+    memcpy(_d64_sector(track, sector), data, D64_SECTOR_SIZE);
+    return true;
+}
+
+// copy a 0xA0-padded PETSCII name into a zero-terminated string
+static void _d64_copy_name(const uint8_t* src, char* dst, int max_len) {
+    int i = 0;
+    for (; (i < max_len) && (src[i] != 0xA0); i++) {
+        dst[i] = (char)src[i];
+    }
+    dst[i] = 0;
+}
+
+void d64_disk_name(char out_name[17]) {
+    assert(state.valid);
+    if (!d64_inserted()) {
+        out_name[0] = 0;
+        return;
+    }
+    _d64_copy_name(&_d64_sector(D64_DIR_TRACK, 0)[0x90], out_name, 16);
+}
+
+int d64_directory(d64_dir_entry_t* out_entries, int max_entries) {
+    assert(state.valid && out_entries);
+    if (!d64_inserted()) {
+        return 0;
+    }
+    int num_entries = 0;
+    const uint8_t* bam = _d64_sector(D64_DIR_TRACK, 0);
+    int track = bam[0];
+    int sector = bam[1];
+    // a broken directory chain might loop, stop after all sectors of the directory track
+    for (int i = 0; (i < _d64_sectors_per_track(D64_DIR_TRACK)) && _d64_valid_sector(track, sector); i++) {
+        const uint8_t* dir = _d64_sector(track, sector);
+        for (int e = 0; e < 8; e++) {
+            const uint8_t* ent = &dir[e * 32];
+            if (ent[2] == 0) {
+                // scratched or empty entry
+                continue;
+            }
+            if (num_entries >= max_entries) {
+                return num_entries;
+            }
+            d64_dir_entry_t* out = &out_entries[num_entries++];
+            memset(out, 0, sizeof(d64_dir_entry_t));
+            _d64_copy_name(&ent[5], out->name, 16);
+            memcpy(out->raw_name, &ent[5], 16);
+            out->type = (d64_filetype_t)(ent[2] & 0x07);
+            out->closed = 0 != (ent[2] & 0x80);
+            out->locked = 0 != (ent[2] & 0x40);
+            out->track = ent[3];
+            out->sector = ent[4];
+            out->num_blocks = (uint16_t)(ent[30] | (ent[31] << 8));
+        }
+        track = dir[0];
+        sector = dir[1];
+    }
+    return num_entries;
+}
+
+// match a LOAD filename against a directory entry name, '*' matches the rest, '?' any character
+static bool _d64_match_name(const uint8_t* pattern, int pattern_len, const uint8_t* raw_name) {
+    int i = 0;
+    for (; i < pattern_len; i++) {
+        if (pattern[i] == '*') {
+            return true;
+        }
+        if (i >= 16) {
+            return false;
+        }
+        if ((pattern[i] != '?') && (pattern[i] != raw_name[i])) {
+            return false;
+        }
+    }
+    return (i == 16) || (raw_name[i] == 0xA0);
+}
+
+bool d64_find_file(const uint8_t* name, int name_len, d64_dir_entry_t* out_entry) {
+    assert(state.valid && out_entry);
+    d64_dir_entry_t entries[144];
+    const int num_entries = d64_directory(entries, 144);
+    for (int i = 0; i < num_entries; i++) {
+        const d64_dir_entry_t* ent = &entries[i];
+        if (!ent->closed || (ent->type == D64_FILETYPE_DEL) || (ent->type == D64_FILETYPE_REL)) {
+            continue;
+        }
+        const bool match = (name_len == 0) ? (ent->type == D64_FILETYPE_PRG) : _d64_match_name(name, name_len, ent->raw_name);
+        if (match) {
+            *out_entry = *ent;
+            return true;
+        }
+    }
+    return false;
+}
+
+int d64_read_file(const d64_dir_entry_t* entry, uint8_t* buf, int buf_size) {
+    assert(state.valid && entry && buf);
+    int track = entry->track;
+    int sector = entry->sector;
+    int pos = 0;
+    for (int i = 0; i < D64_MAX_SECTORS; i++) {
+        if (!_d64_valid_sector(track, sector)) {
+            return -1;
+        }
+        const uint8_t* data = _d64_sector(track, sector);
+        // the last sector stores the index of the last used byte instead of the next sector
+        const int num_bytes = (data[0] == 0) ? (data[1] - 1) : 254;
+        if ((num_bytes < 0) || ((pos + num_bytes) > buf_size)) {
+            return -1;
+        }
+        memcpy(&buf[pos], &data[2], (size_t)num_bytes);
+        pos += num_bytes;
+        if (data[0] == 0) {
+            return pos;
+        }
+        track = data[0];
+        sector = data[1];
+    }
+    // looping track/sector chain
+    return -1;
+}
+
+// append a BASIC line to a directory listing, returns the new size or -1 if the buffer is full
+static int _d64_listing_line(uint8_t* buf, int buf_size, int pos, uint16_t line_nr, const uint8_t* text, int text_len) {
+    const int line_size = 2 + 2 + text_len + 1;
+    if ((pos + line_size) > buf_size) {
+        return -1;
+    }
+    // the listing is loaded to 0x0401, and buf starts with the 2-byte load address
+    const uint16_t next_line = (uint16_t)(0x0401 + (pos - 2) + line_size);
+    buf[pos++] = (uint8_t)next_line;
+    buf[pos++] = (uint8_t)(next_line >> 8);
+    buf[pos++] = (uint8_t)line_nr;
+    buf[pos++] = (uint8_t)(line_nr >> 8);
+    memcpy(&buf[pos], text, (size_t)text_len);
+    pos += text_len;
+    buf[pos++] = 0;
+    return pos;
+}
+
+static uint8_t _d64_listing_char(uint8_t c) {
+    return (c == 0xA0) ? ' ' : c;
+}
+
+int d64_directory_listing(uint8_t* buf, int buf_size) {
+    assert(state.valid && buf);
+    if (!d64_inserted() || (buf_size < 4)) {
+        return -1;
+    }
+    static const char* type_names[8] = { "DEL", "SEQ", "PRG", "USR", "REL", "???", "???", "???" };
+    const uint8_t* bam = _d64_sector(D64_DIR_TRACK, 0);
+    uint8_t text[32];
+    int pos = 0;
+    buf[pos++] = 0x01;
+    buf[pos++] = 0x04;
+
+    // reverse header line with disk name, disk ID and DOS type
+    int len = 0;
+    text[len++] = 0x12;
+    text[len++] = '"';
+    for (int i = 0; i < 16; i++) {
+        text[len++] = _d64_listing_char(bam[0x90 + i]);
+    }
+    text[len++] = '"';
+    text[len++] = ' ';
+    text[len++] = _d64_listing_char(bam[0xA2]);
+    text[len++] = _d64_listing_char(bam[0xA3]);
+    text[len++] = ' ';
+    text[len++] = _d64_listing_char(bam[0xA5]);
+    text[len++] = _d64_listing_char(bam[0xA6]);
+    pos = _d64_listing_line(buf, buf_size, pos, 0, text, len);
+
+    // one line per file, with the number of blocks as line number
+    d64_dir_entry_t entries[144];
+    const int num_entries = d64_directory(entries, 144);
+    for (int e = 0; (e < num_entries) && (pos >= 0); e++) {
+        const d64_dir_entry_t* ent = &entries[e];
+        len = 0;
+        const int num_spaces = (ent->num_blocks < 10) ? 3 : ((ent->num_blocks < 100) ? 2 : 1);
+        for (int i = 0; i < num_spaces; i++) {
+            text[len++] = ' ';
+        }
+        text[len++] = '"';
+        int name_len = (int)strlen(ent->name);
+        memcpy(&text[len], ent->name, (size_t)name_len);
+        len += name_len;
+        text[len++] = '"';
+        for (; name_len < 16; name_len++) {
+            text[len++] = ' ';
+        }
+        text[len++] = ent->closed ? ' ' : '*';
+        memcpy(&text[len], type_names[ent->type & 7], 3);
+        len += 3;
+        if (ent->locked) {
+            text[len++] = '<';
+        }
+        pos = _d64_listing_line(buf, buf_size, pos, ent->num_blocks, text, len);
+    }
+
+    // free blocks from the BAM, not counting the directory track
+    int num_free = 0;
+    for (int track = 1; track <= 35; track++) {
+        if (track != D64_DIR_TRACK) {
+            num_free += bam[track * 4];
+        }
+    }
+    static const char blocks_free[] = "BLOCKS FREE.";
+    if (pos >= 0) {
+        pos = _d64_listing_line(buf, buf_size, pos, (uint16_t)num_free, (const uint8_t*)blocks_free, (int)sizeof(blocks_free) - 1);
+    }
+    if ((pos < 0) || ((pos + 2) > buf_size)) {
+        return -1;
+    }
+    // end of BASIC program
+    buf[pos++] = 0;
+    buf[pos++] = 0;
+    return pos;
+}
+
+d64_load_result_t d64_load(const d64_load_t* req) {
+    assert(state.valid);
+    assert(req && req->read_cb && req->write_cb);
+    d64_load_result_t res = {
+        .error = D64_LOAD_OK,
+        .start_addr = req->addr,
+        .end_addr = req->addr,
+    };
+    if (!d64_inserted()) {
+        res.error = D64_LOAD_DEVICE_NOT_PRESENT;
+        return res;
+    }
+    if ((req->name == 0) || (req->name_len <= 0)) {
+        res.error = D64_LOAD_MISSING_FILE_NAME;
+        return res;
+    }
+    // skip the drive number prefix ("0:NAME" or ":NAME")
+    const uint8_t* name = req->name;
+    int name_len = req->name_len;
+    if ((name_len >= 2) && (name[1] == ':') && (name[0] >= '0') && (name[0] <= '9')) {
+        name += 2;
+        name_len -= 2;
+    }
+    else if (name[0] == ':') {
+        name += 1;
+        name_len -= 1;
+    }
+    int size = -1;
+    if ((name_len == 1) && (name[0] == '$')) {
+        size = d64_directory_listing(state.load_buf, sizeof(state.load_buf));
+    }
+    else {
+        d64_dir_entry_t entry;
+        if ((name_len > 0) && d64_find_file(name, name_len, &entry)) {
+            size = d64_read_file(&entry, state.load_buf, sizeof(state.load_buf));
+        }
+    }
+    // the first two bytes are the load address
+    if (size < 2) {
+        res.error = D64_LOAD_FILE_NOT_FOUND;
+        return res;
+    }
+    uint16_t addr = req->use_file_addr ? (uint16_t)(state.load_buf[0] | (state.load_buf[1] << 8)) : req->addr;
+    res.start_addr = addr;
+    for (int i = 2; i < size; i++) {
+        const uint8_t val = state.load_buf[i];
+        if (req->verify) {
+            // like the KERNAL, a mismatch only sets a status bit and the load continues
+            if (req->read_cb(addr, req->user_data) != val) {
+                res.verify_error = true;
+            }
+        }
+        else {
+            req->write_cb(addr, val, req->user_data);
+        }
+        addr++;
+    }
+    res.end_addr = addr;
+    return res;
+}
@@ -0,0 +1,114 @@
+#pragma once
+/*
+    C64 1541 disk images (.d64 and .g64).
+
+    The disk content is kept as a sector image in D64 layout (G64 images
+    are GCR-decoded on insert), this is used for the directory listing and
+    for reading files.
+
+    d64_load() implements a virtual drive for the KERNAL LOAD routine, it
+    copies a file (or the directory listing for "$") straight into memory
+    through callbacks and returns the same results as a serial bus LOAD
+    from a real 1541.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chips/chips_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define D64_MAX_TRACKS (40)
+#define D64_SECTOR_SIZE (256)
+#define D64_MAX_SECTORS (768)                       // for 40 tracks
+#define D64_MAX_GCR_TRACK_SIZE (7928)               // max G64 track size
+#define D64_MAX_FILE_SIZE (D64_MAX_SECTORS * 254)
+#define D64_DIR_TRACK (18)
+
+typedef enum {
+    D64_FORMAT_NONE,
+    D64_FORMAT_D64,
+    D64_FORMAT_G64,
+} d64_format_t;
+
+// CBM DOS file types
+typedef enum {
+    D64_FILETYPE_DEL = 0,
+    D64_FILETYPE_SEQ = 1,
+    D64_FILETYPE_PRG = 2,
+    D64_FILETYPE_USR = 3,
+    D64_FILETYPE_REL = 4,
+} d64_filetype_t;
+
+typedef struct {
+    char name[17];          // PETSCII name without 0xA0 padding, zero-terminated
+    uint8_t raw_name[16];   // name with 0xA0 padding, for comparison with LOAD filenames
+    d64_filetype_t type;
+    bool closed;
+    bool locked;
+    uint8_t track;          // first track/sector of the file
+    uint8_t sector;
+    uint16_t num_blocks;
+} d64_dir_entry_t;
+
+// KERNAL error codes returned by d64_load()
+typedef enum {
+    D64_LOAD_OK = 0,
+    D64_LOAD_FILE_NOT_FOUND = 4,
+    D64_LOAD_DEVICE_NOT_PRESENT = 5,
+    D64_LOAD_MISSING_FILE_NAME = 8,
+} d64_load_error_t;
+
+// a KERNAL LOAD request
+typedef struct {
+    const uint8_t* name;        // PETSCII filename, optional "0:" prefix, "$" for the directory
+    int name_len;
+    bool use_file_addr;         // load to the address in the file (secondary address != 0)
+    uint16_t addr;              // otherwise load to this address
+    bool verify;                // compare with memory instead of writing
+    uint8_t (*read_cb)(uint16_t addr, void* user_data);
+    void (*write_cb)(uint16_t addr, uint8_t data, void* user_data);
+    void* user_data;
+} d64_load_t;
+
+typedef struct {
+    d64_load_error_t error;
+    bool verify_error;          // a VERIFY found a mismatch
+    uint16_t start_addr;
+    uint16_t end_addr;          // address after the last loaded byte
+} d64_load_result_t;
+
+// initialize the d64 module (no disk inserted)
+void d64_init(void);
+// insert a .d64 (35 or 40 tracks, optional error bytes) or .g64 image
+bool d64_insert(chips_range_t data);
+// remove the disk
+void d64_eject(void);
+// return true if a disk is inserted
+bool d64_inserted(void);
+// get the number of tracks (1-based track numbers go from 1 to num_tracks)
+int d64_num_tracks(void);
+// get the number of sectors of a track
+int d64_num_sectors(int track);
+// get a pointer to a 256 byte sector, or 0 for invalid track/sector numbers
+const uint8_t* d64_read_sector(int track, int sector);
+// overwrite a sector
+bool d64_write_sector(int track, int sector, const uint8_t* data);
+// get the disk name from the BAM, zero-terminated
+void d64_disk_name(char out_name[17]);
+// read the directory, returns number of entries
+int d64_directory(d64_dir_entry_t* out_entries, int max_entries);
+// find a file by name ('*' and '?' wildcards like the 1541 DOS), or the first file for an empty name
+bool d64_find_file(const uint8_t* name, int name_len, d64_dir_entry_t* out_entry);
+// read a file by following its track/sector chain, returns file size or -1 on error
+int d64_read_file(const d64_dir_entry_t* entry, uint8_t* buf, int buf_size);
+// write the directory as BASIC program into buf (with load address), returns size
+int d64_directory_listing(uint8_t* buf, int buf_size);
+// load a file like the KERNAL LOAD routine from device 8
+d64_load_result_t d64_load(const d64_load_t* req);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
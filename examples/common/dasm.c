@@ -0,0 +1,261 @@
+#define CHIPS_UTIL_IMPL
+#include "util/z80dasm.h"
+#include "util/m6502dasm.h"
+#include "dasm.h"
+#include <string.h>
+#include <assert.h>
+
+#define DASM_CACHE_SIZE (4096)      // must be 2^N
+#define DASM_MAX_OP_BYTES (4)
+
+// opcode table entry flags
+#define DASM_OPFLAG_FIXED   (1<<0)  // text doesn't depend on operand bytes or pc
+#define DASM_OPFLAG_PCREL   (1<<1)  // text depends on the instruction address (relative branches)
+
+typedef struct {
+    uint8_t len;        // 0 if the length can't be predicted from the opcode
+    uint8_t flags;
+    uint8_t num_chars;
+    char chars[DASM_LINE_MAX_CHARS];
+} dasm_op_t;
+
+typedef struct {
+    bool valid;
+    dasm_cputype_t cpu_type;
+    uint8_t len;
+    uint8_t bytes[DASM_MAX_OP_BYTES];
+    uint16_t addr;
+    uint8_t num_chars;
+    char chars[DASM_LINE_MAX_CHARS];
+} dasm_cache_entry_t;
+
+// disassembler callback context
+typedef struct {
+    // input either from a byte buffer or from a read callback
+    const uint8_t* buf;
+    dasm_read_t read_cb;
+    void* user_data;
+    uint16_t addr;
+    dasm_line_t* line;
+} dasm_ctx_t;
+
+typedef struct {
+    bool valid;
+    struct {
+        dasm_op_t main[256];
+        dasm_op_t cb[256];
+        dasm_op_t ed[256];
+        dasm_op_t ddfd[2][256];
+        dasm_op_t ddfdcb[2][256];
+    } z80;
+    struct {
+        dasm_op_t main[256];
+    } m6502;
+    dasm_stats_t stats;
+    dasm_cache_entry_t cache[DASM_CACHE_SIZE];
+} dasm_state_t;
+static dasm_state_t state;
+
+static uint8_t _dasm_in_cb(void* user_data) {
+    dasm_ctx_t* ctx = (dasm_ctx_t*) user_data;
+    uint8_t val;
+    if (ctx->buf) {
+        val = *ctx->buf++;
+    }
+    else {
+        val = ctx->read_cb(ctx->addr, ctx->user_data);
+    }
+    ctx->addr++;
+    dasm_line_t* line = ctx->line;
+    if (line->num_bytes < DASM_LINE_MAX_BYTES) {
+        line->bytes[line->num_bytes++] = val;
+    }
+    return val;
+}
+
+static void _dasm_out_cb(char c, void* user_data) {
+    dasm_line_t* line = ((dasm_ctx_t*)user_data)->line;
+    if ((line->num_chars + 1) < DASM_LINE_MAX_CHARS) {
+        line->chars[line->num_chars++] = c;
+        line->chars[line->num_chars] = 0;
+    }
+}
+
+// disassemble a single instruction through the per-character callbacks
+static void _dasm_op(dasm_cputype_t cpu_type, dasm_ctx_t* ctx) {
+    dasm_line_t* line = ctx->line;
+    line->addr = ctx->addr;
+    line->num_bytes = 0;
+    line->num_chars = 0;
+    line->chars[0] = 0;
+    if (cpu_type == DASM_CPUTYPE_Z80) {
+        z80dasm_op(ctx->addr, _dasm_in_cb, _dasm_out_cb, ctx);
+    }
+    else {
+        m6502dasm_op(ctx->addr, _dasm_in_cb, _dasm_out_cb, ctx);
+    }
+}
+
+static void _dasm_op_from_buf(dasm_cputype_t cpu_type, uint16_t addr, const uint8_t* buf, dasm_line_t* line) {
+    dasm_ctx_t ctx = { .buf = buf, .addr = addr, .line = line };
+    _dasm_op(cpu_type, &ctx);
+}
+
+/* build an opcode table entry by disassembling the opcode bytes followed by
+   different operand bytes at different addresses: if the instruction length
+   differs the entry can't be predicted, if the text never changes the entry is
+   fixed, and if only the address changes the text the instruction is pc-relative
+*/
+static void _dasm_build_op(dasm_cputype_t cpu_type, const uint8_t* opcode, int opcode_len, int disp_pos, dasm_op_t* op) {
+    uint8_t buf[2][DASM_LINE_MAX_BYTES];
+    const uint8_t filler[2] = { 0x00, 0xA5 };
+    for (int i = 0; i < 2; i++) {
+        memset(buf[i], filler[i], sizeof(buf[i]));
+        memcpy(buf[i], opcode, (size_t)opcode_len);
+        // for DD/FD CB d op, the displacement comes before the opcode
+        if (disp_pos >= 0) {
+            buf[i][disp_pos] = filler[i];
+        }
+    }
+    dasm_line_t l0, l1, l2;
+    _dasm_op_from_buf(cpu_type, 0x0000, buf[0], &l0);
+    _dasm_op_from_buf(cpu_type, 0x0000, buf[1], &l1);
+    _dasm_op_from_buf(cpu_type, 0x8000, buf[0], &l2);
+    memset(op, 0, sizeof(dasm_op_t));
+    if ((l0.num_bytes != l1.num_bytes) || (l0.num_bytes != l2.num_bytes) || (l0.num_bytes > DASM_MAX_OP_BYTES)) {
+        return;
+    }
+    op->len = l0.num_bytes;
+    if (0 != strcmp(l0.chars, l2.chars)) {
+        op->flags |= DASM_OPFLAG_PCREL;
+    }
+    else if (0 == strcmp(l0.chars, l1.chars)) {
+        op->flags |= DASM_OPFLAG_FIXED;
+        op->num_chars = l0.num_chars;
+        memcpy(op->chars, l0.chars, sizeof(op->chars));
+    }
+}
+
+void dasm_init(void) {
+    memset(&state, 0, sizeof(state));
+    state.valid = true;
+    for (int i = 0; i < 256; i++) {
+        const uint8_t op = (uint8_t) i;
+        _dasm_build_op(DASM_CPUTYPE_Z80, (uint8_t[]){ op }, 1, -1, &state.z80.main[i]);
+        _dasm_build_op(DASM_CPUTYPE_Z80, (uint8_t[]){ 0xCB, op }, 2, -1, &state.z80.cb[i]);
+        _dasm_build_op(DASM_CPUTYPE_Z80, (uint8_t[]){ 0xED, op }, 2, -1, &state.z80.ed[i]);
+        for (int ix = 0; ix < 2; ix++) {
+            const uint8_t prefix = ix ? 0xFD : 0xDD;
+            // chained prefixes are disassembled through the callbacks
+            if ((op != 0xDD) && (op != 0xED) && (op != 0xFD)) {
+                _dasm_build_op(DASM_CPUTYPE_Z80, (uint8_t[]){ prefix, op }, 2, -1, &state.z80.ddfd[ix][i]);
+            }
+            _dasm_build_op(DASM_CPUTYPE_Z80, (uint8_t[]){ prefix, 0xCB, 0x00, op }, 4, 2, &state.z80.ddfdcb[ix][i]);
+        }
+        _dasm_build_op(DASM_CPUTYPE_M6502, (uint8_t[]){ op }, 1, -1, &state.m6502.main[i]);
+    }
+}
+
+void dasm_flush_cache(void) {
+    assert(state.valid);
+    memset(state.cache, 0, sizeof(state.cache));
+}
+
+dasm_stats_t dasm_stats(void) {
+    assert(state.valid);
+    return state.stats;
+}
+
+// lookup the opcode table entry from the first instruction bytes
+static const dasm_op_t* _dasm_lookup_op(dasm_cputype_t cpu_type, const uint8_t* b) {
+    if (cpu_type == DASM_CPUTYPE_M6502) {
+        return &state.m6502.main[b[0]];
+    }
+    switch (b[0]) {
+        case 0xCB: return &state.z80.cb[b[1]];
+        case 0xED: return &state.z80.ed[b[1]];
+        case 0xDD:
+        case 0xFD: {
+            const int ix = (b[0] == 0xFD) ? 1 : 0;
+            if (b[1] == 0xCB) {
+                return &state.z80.ddfdcb[ix][b[3]];
+            }
+            else {
+                return &state.z80.ddfd[ix][b[1]];
+            }
+        }
+        default: return &state.z80.main[b[0]];
+    }
+}
+
+static uint32_t _dasm_hash(dasm_cputype_t cpu_type, const uint8_t* bytes, int len, uint16_t addr) {
+    uint32_t h = 2166136261u ^ (uint32_t)cpu_type;
+    for (int i = 0; i < len; i++) {
+        h = (h ^ bytes[i]) * 16777619u;
+    }
+    h = (h ^ (addr & 0xFF)) * 16777619u;
+    h = (h ^ (addr >> 8)) * 16777619u;
+    return h ^ (h >> 16);
+}
+
+uint16_t dasm_disassemble(const dasm_request_t* req) {
+    assert(state.valid);
+    assert(req && req->read_cb && req->out_lines && (req->num_lines >= 0));
+    const dasm_cputype_t cpu_type = req->cpu_type;
+    const int max_op_bytes = (cpu_type == DASM_CPUTYPE_Z80) ? 4 : 3;
+    uint16_t addr = req->addr;
+    for (int line_index = 0; line_index < req->num_lines; line_index++) {
+        dasm_line_t* line = &req->out_lines[line_index];
+        uint8_t b[DASM_MAX_OP_BYTES] = { 0 };
+        for (int i = 0; i < max_op_bytes; i++) {
+            b[i] = req->read_cb((uint16_t)(addr + i), req->user_data);
+        }
+        const dasm_op_t* op = _dasm_lookup_op(cpu_type, b);
+        if (op->flags & DASM_OPFLAG_FIXED) {
+            // operand-less instruction, text comes straight from the opcode table
+            state.stats.table_hits++;
+            line->addr = addr;
+            line->num_bytes = op->len;
+            memcpy(line->bytes, b, op->len);
+            line->num_chars = op->num_chars;
+            memcpy(line->chars, op->chars, sizeof(line->chars));
+            addr += op->len;
+            continue;
+        }
+        dasm_cache_entry_t* entry = 0;
+        if (op->len > 0) {
+            const uint16_t key_addr = (op->flags & DASM_OPFLAG_PCREL) ? addr : 0;
+            entry = &state.cache[_dasm_hash(cpu_type, b, op->len, key_addr) & (DASM_CACHE_SIZE - 1)];
+            if (entry->valid &&
+                (entry->cpu_type == cpu_type) &&
+                (entry->len == op->len) &&
+                (entry->addr == key_addr) &&
+                (0 == memcmp(entry->bytes, b, op->len)))
+            {
+                state.stats.cache_hits++;
+                line->addr = addr;
+                line->num_bytes = op->len;
+                memcpy(line->bytes, b, op->len);
+                line->num_chars = entry->num_chars;
+                memcpy(line->chars, entry->chars, sizeof(line->chars));
+                addr += op->len;
+                continue;
+            }
+        }
+        // cache miss or unpredictable length, disassemble through the callbacks
+        state.stats.misses++;
+        dasm_ctx_t ctx = { .read_cb = req->read_cb, .user_data = req->user_data, .addr = addr, .line = line };
+        _dasm_op(cpu_type, &ctx);
+        if (entry && (line->num_bytes == op->len)) {
+            entry->valid = true;
+            entry->cpu_type = cpu_type;
+            entry->len = op->len;
+            memcpy(entry->bytes, line->bytes, op->len);
+            entry->addr = (op->flags & DASM_OPFLAG_PCREL) ? addr : 0;
+            entry->num_chars = line->num_chars;
+            memcpy(entry->chars, line->chars, sizeof(entry->chars));
+        }
+        addr = ctx.addr;
+    }
+    return addr;
+}
@@ -0,0 +1,70 @@
+#pragma once
+/*
+    Batched disassembler on top of the chips z80dasm_op() and m6502dasm_op()
+    single-instruction disassemblers.
+
+    dasm_disassemble() disassembles a number of consecutive instructions
+    into a preallocated line array in one call. Instruction lengths come
+    from opcode-indexed tables (built once in dasm_init()). Disassembled
+    lines are memoized in a line cache keyed by the instruction bytes, so
+    re-disassembling the same code (for instance when a debugger view is
+    refreshed every frame) mostly skips the per-character callbacks.
+
+    NOTE: dasm.c contains the z80dasm.h and m6502dasm.h implementations,
+    so don't define CHIPS_UTIL_IMPL for those headers in code linking
+    with the dasm library.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DASM_LINE_MAX_BYTES (8)
+#define DASM_LINE_MAX_CHARS (32)
+
+typedef enum {
+    DASM_CPUTYPE_Z80,
+    DASM_CPUTYPE_M6502,
+} dasm_cputype_t;
+
+typedef struct {
+    uint16_t addr;
+    uint8_t num_bytes;
+    uint8_t num_chars;
+    uint8_t bytes[DASM_LINE_MAX_BYTES];
+    char chars[DASM_LINE_MAX_CHARS];
+} dasm_line_t;
+
+// callback to read a byte from emulator memory
+typedef uint8_t (*dasm_read_t)(uint16_t addr, void* user_data);
+
+typedef struct {
+    dasm_cputype_t cpu_type;
+    uint16_t addr;              // address of the first instruction
+    int num_lines;              // number of instructions to disassemble
+    dasm_line_t* out_lines;     // preallocated array of at least num_lines items
+    dasm_read_t read_cb;
+    void* user_data;
+} dasm_request_t;
+
+typedef struct {
+    uint64_t table_hits;    // operand-less instructions resolved from the opcode tables
+    uint64_t cache_hits;    // instructions resolved from the line cache
+    uint64_t misses;        // instructions disassembled through the callbacks
+} dasm_stats_t;
+
+// build the opcode tables
+void dasm_init(void);
+// disassemble a range of instructions, returns the address after the last instruction
+uint16_t dasm_disassemble(const dasm_request_t* req);
+// discard all cached lines (e.g. after loading new code, not required for correctness)
+void dasm_flush_cache(void);
+// get cache statistics
+dasm_stats_t dasm_stats(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
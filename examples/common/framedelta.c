@@ -0,0 +1,114 @@
+#include "framedelta.h"
+#include <string.h>
+#include <assert.h>
+
+static void _framedelta_put_u16(uint8_t* dst, size_t val) {
+    dst[0] = (uint8_t)(val & 0xFF);
+    dst[1] = (uint8_t)((val >> 8) & 0xFF);
+}
+
+static size_t _framedelta_get_u16(const uint8_t* src) {
+    return (size_t)src[0] | ((size_t)src[1] << 8);
+}
+
+// run-length encode a row, dst must have room for the worst case
+static size_t _framedelta_encode_row(const uint8_t* src, int width, uint8_t* dst) {
+    uint8_t* start = dst;
+    int i = 0;
+    while (i < width) {
+        // a run of at least 3 equal bytes (a run of 2 costs as much as literals)
+        int run = 1;
+        while (((i + run) < width) && (run < 129) && (src[i + run] == src[i])) {
+            run++;
+        }
+        if (run >= 3) {
+            *dst++ = (uint8_t)(126 + run);
+            *dst++ = src[i];
+            i += run;
+            continue;
+        }
+        // literals up to the next run
+        int num = 1;
+        while (((i + num) < width) && (num < 128)) {
+            if (((i + num + 2) < width) && (src[i + num] == src[i + num + 1]) && (src[i + num] == src[i + num + 2])) {
+                break;
+            }
+            num++;
+        }
+        *dst++ = (uint8_t)(num - 1);
+        memcpy(dst, &src[i], (size_t)num);
+        dst += num;
+        i += num;
+    }
+    return (size_t)(dst - start);
+}
+
+size_t framedelta_encode(const uint8_t* prev, const uint8_t* cur, int width, int height, uint8_t* dst, size_t dst_size) {
+    assert(cur && dst && (width > 0) && (height > 0));
+    assert((width <= 0xFFFF) && (height <= 0xFFFF));
+    if (dst_size < FRAMEDELTA_MAX_SIZE(width, height)) {
+        return 0;
+    }
+    size_t pos = 2;
+    size_t num_rows = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = cur + (size_t)y * (size_t)width;
+        if (prev && (0 == memcmp(row, prev + (size_t)y * (size_t)width, (size_t)width))) {
+            continue;
+        }
+        const size_t size = _framedelta_encode_row(row, width, &dst[pos + 4]);
+        _framedelta_put_u16(&dst[pos], (size_t)y);
+        _framedelta_put_u16(&dst[pos + 2], size);
+        pos += 4 + size;
+        num_rows++;
+    }
+    _framedelta_put_u16(dst, num_rows);
+    return pos;
+}
+
+bool framedelta_decode(const uint8_t* src, size_t src_size, uint8_t* frame, int width, int height) {
+    assert(src && frame && (width > 0) && (height > 0));
+    if (src_size < 2) {
+        return false;
+    }
+    const size_t num_rows = _framedelta_get_u16(src);
+    size_t pos = 2;
+    for (size_t r = 0; r < num_rows; r++) {
+        if ((pos + 4) > src_size) {
+            return false;
+        }
+        const size_t y = _framedelta_get_u16(&src[pos]);
+        const size_t size = _framedelta_get_u16(&src[pos + 2]);
+        pos += 4;
+        if ((y >= (size_t)height) || ((pos + size) > src_size)) {
+            return false;
+        }
+        uint8_t* dst = frame + y * (size_t)width;
+        const size_t end = pos + size;
+        size_t x = 0;
+        while (pos < end) {
+            const uint8_t ctrl = src[pos++];
+            if (ctrl < 128) {
+                const size_t num = (size_t)ctrl + 1;
+                if (((pos + num) > end) || ((x + num) > (size_t)width)) {
+                    return false;
+                }
+                memcpy(&dst[x], &src[pos], num);
+                pos += num;
+                x += num;
+            }
+            else {
+                const size_t num = (size_t)ctrl - 126;
+                if ((pos >= end) || ((x + num) > (size_t)width)) {
+                    return false;
+                }
+                memset(&dst[x], src[pos++], num);
+                x += num;
+            }
+        }
+        if (x != (size_t)width) {
+            return false;
+        }
+    }
+    return pos == src_size;
+}
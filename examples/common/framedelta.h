@@ -0,0 +1,37 @@
+#pragma once
+/*
+    Palette-indexed frame deltas with run-length encoded rows.
+
+    framedelta_encode() compares a frame with the receiver's previous frame
+    row by row and only encodes the changed rows, each row is compressed
+    with PackBits-style run-length encoding (a control byte 0..127 is
+    followed by 1..128 literal bytes, a control byte 128..255 repeats the
+    next byte 2..129 times, the encoder only uses runs of 3 and more).
+    Without a previous frame all rows are encoded (a keyframe).
+
+    The encoded delta is:
+
+    - u16 number of changed rows
+    - per changed row: u16 row index, u16 encoded size, encoded row
+
+    All values are little endian. An unchanged frame encodes to 2 bytes.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// worst case encoded size of a frame
+#define FRAMEDELTA_MAX_SIZE(width, height) (2 + (size_t)(height) * (5 + (size_t)(width) + ((size_t)(width) + 127) / 128))
+
+// encode the changed rows of a frame (prev may be null), returns the encoded size, or 0 if dst is too small
+size_t framedelta_encode(const uint8_t* prev, const uint8_t* cur, int width, int height, uint8_t* dst, size_t dst_size);
+// apply an encoded delta to the previous frame, returns false if the data is malformed
+bool framedelta_decode(const uint8_t* src, size_t src_size, uint8_t* frame, int width, int height);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
@@ -0,0 +1,378 @@
+#include "sokol_app.h"
+#include "chips/chips_common.h"
+#include "framehash.h"
+#include "clock.h"
+#include "fs.h"
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#define FRAMEHASH_GOLDEN_MAX_ENTRIES (256)
+#define FRAMEHASH_GOLDEN_INTERVAL (60)
+#define FRAMEHASH_GOLDEN_FRAME_TIME_US (16667)
+
+// the row hash has SSE2, NEON and WASM SIMD implementations, which all
+// produce the same result as the scalar version (so that golden manifests
+// can be shared between native and WASM builds)
+#if !defined(FRAMEHASH_NO_SIMD)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+        #include <emmintrin.h>
+        #define FRAMEHASH_SSE2
+    #elif defined(__aarch64__) || defined(_M_ARM64)
+        #include <arm_neon.h>
+        #define FRAMEHASH_NEON
+    #elif defined(__wasm_simd128__)
+        #include <wasm_simd128.h>
+        #define FRAMEHASH_WASM_SIMD
+    #endif
+#endif
+
+#define FRAMEHASH_STRIPE_SIZE (64)
+#define FRAMEHASH_PRIME64_1 (0x9E3779B185EBCA87ULL)
+#define FRAMEHASH_PRIME64_2 (0xC2B2AE3D27D4EB4FULL)
+#define FRAMEHASH_PRIME64_3 (0x165667B19E3779F9ULL)
+#define FRAMEHASH_PRIME64_4 (0x85EBCA77C2B2AE63ULL)
+#define FRAMEHASH_PRIME64_5 (0x27D4EB2F165667C5ULL)
+
+typedef struct {
+    uint32_t frame;
+    uint64_t hash;
+} framehash_golden_entry_t;
+
+typedef struct {
+    bool valid;
+    framehash_t hash;
+    struct {
+        bool active;
+        bool record;
+        framehash_golden_result_t result;
+        uint32_t frame;
+        char path[1024];
+        int num_frames;
+        int num_entries;
+        int num_checked;
+        int num_failed;
+        framehash_golden_entry_t entries[FRAMEHASH_GOLDEN_MAX_ENTRIES];
+    } golden;
+} framehash_state_t;
+static framehash_state_t state;
+
+static inline uint64_t framehash_rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t framehash_read64(const uint8_t* ptr) {
+    uint64_t val;
+    memcpy(&val, ptr, sizeof(val));
+    return val;
+}
+
+static inline uint32_t framehash_read32(const uint8_t* ptr) {
+    uint32_t val;
+    memcpy(&val, ptr, sizeof(val));
+    return val;
+}
+
+static inline uint64_t framehash_round(uint64_t acc, uint64_t input) {
+    acc += input * FRAMEHASH_PRIME64_2;
+    acc = framehash_rotl(acc, 31);
+    return acc * FRAMEHASH_PRIME64_1;
+}
+
+static inline uint64_t framehash_merge_round(uint64_t acc, uint64_t val) {
+    acc ^= framehash_round(0, val);
+    return acc * FRAMEHASH_PRIME64_1 + FRAMEHASH_PRIME64_4;
+}
+
+uint64_t framehash_data(const void* ptr, size_t num_bytes, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*) ptr;
+    const uint8_t* end = p + num_bytes;
+    uint64_t h;
+    if (num_bytes >= 32) {
+        // 4 independent accumulator lanes, no dependencies between lanes
+        uint64_t v0 = seed + FRAMEHASH_PRIME64_1 + FRAMEHASH_PRIME64_2;
+        uint64_t v1 = seed + FRAMEHASH_PRIME64_2;
+        uint64_t v2 = seed;
+        uint64_t v3 = seed - FRAMEHASH_PRIME64_1;
+        const uint8_t* limit = end - 32;
+        do {
+            v0 = framehash_round(v0, framehash_read64(p));
+            v1 = framehash_round(v1, framehash_read64(p + 8));
+            v2 = framehash_round(v2, framehash_read64(p + 16));
+            v3 = framehash_round(v3, framehash_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = framehash_rotl(v0, 1) + framehash_rotl(v1, 7) + framehash_rotl(v2, 12) + framehash_rotl(v3, 18);
+        h = framehash_merge_round(h, v0);
+        h = framehash_merge_round(h, v1);
+        h = framehash_merge_round(h, v2);
+        h = framehash_merge_round(h, v3);
+    } else {
+        h = seed + FRAMEHASH_PRIME64_5;
+    }
+    h += (uint64_t) num_bytes;
+    while ((p + 8) <= end) {
+        h ^= framehash_round(0, framehash_read64(p));
+        h = framehash_rotl(h, 27) * FRAMEHASH_PRIME64_1 + FRAMEHASH_PRIME64_4;
+        p += 8;
+    }
+    if ((p + 4) <= end) {
+        h ^= (uint64_t)framehash_read32(p) * FRAMEHASH_PRIME64_1;
+        h = framehash_rotl(h, 23) * FRAMEHASH_PRIME64_2 + FRAMEHASH_PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * FRAMEHASH_PRIME64_5;
+        h = framehash_rotl(h, 11) * FRAMEHASH_PRIME64_1;
+        p++;
+    }
+    h ^= h >> 33;
+    h *= FRAMEHASH_PRIME64_2;
+    h ^= h >> 29;
+    h *= FRAMEHASH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+// per-lane key for the row hash
+static const uint64_t framehash_key[FRAMEHASH_STRIPE_SIZE / 8] = {
+    0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+    0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL,
+};
+
+/*
+    Hash a framebuffer row in stripes of 64 bytes, as 8 independent 64-bit
+    lanes (the XXH3 accumulate step): each lane adds the product of the low
+    and high 32 bits of the keyed input, plus the unkeyed input of the
+    neighbouring lane. A 32x32->64 bit multiply exists in all SIMD
+    instruction sets (unlike the 64-bit multiply of xxHash64), so the SIMD
+    versions process 2 lanes per instruction.
+*/
+#if defined(FRAMEHASH_SSE2)
+static void framehash_accumulate(uint64_t* acc, const uint8_t* p) {
+    for (int i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i*2));
+        const __m128i d = _mm_loadu_si128((const __m128i*)(p + i*16));
+        const __m128i dk = _mm_xor_si128(d, _mm_loadu_si128((const __m128i*)(framehash_key + i*2)));
+        const __m128i prod = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+        const __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+        a = _mm_add_epi64(a, _mm_add_epi64(prod, swapped));
+        _mm_storeu_si128((__m128i*)(acc + i*2), a);
+    }
+}
+#elif defined(FRAMEHASH_NEON)
+static void framehash_accumulate(uint64_t* acc, const uint8_t* p) {
+    for (int i = 0; i < 4; i++) {
+        uint64x2_t a = vld1q_u64(acc + i*2);
+        const uint64x2_t d = vreinterpretq_u64_u8(vld1q_u8(p + i*16));
+        const uint64x2_t dk = veorq_u64(d, vld1q_u64(framehash_key + i*2));
+        const uint64x2_t prod = vmull_u32(vmovn_u64(dk), vshrn_n_u64(dk, 32));
+        const uint64x2_t swapped = vextq_u64(d, d, 1);
+        a = vaddq_u64(a, vaddq_u64(prod, swapped));
+        vst1q_u64(acc + i*2, a);
+    }
+}
+#elif defined(FRAMEHASH_WASM_SIMD)
+static void framehash_accumulate(uint64_t* acc, const uint8_t* p) {
+    for (int i = 0; i < 4; i++) {
+        v128_t a = wasm_v128_load(acc + i*2);
+        const v128_t d = wasm_v128_load(p + i*16);
+        const v128_t dk = wasm_v128_xor(d, wasm_v128_load(framehash_key + i*2));
+        const v128_t lo = wasm_i32x4_shuffle(dk, dk, 0, 2, 0, 2);
+        const v128_t hi = wasm_i32x4_shuffle(dk, dk, 1, 3, 1, 3);
+        const v128_t prod = wasm_u64x2_extmul_low_u32x4(lo, hi);
+        const v128_t swapped = wasm_i64x2_shuffle(d, d, 1, 0);
+        a = wasm_i64x2_add(a, wasm_i64x2_add(prod, swapped));
+        wasm_v128_store(acc + i*2, a);
+    }
+}
+#else
+static void framehash_accumulate(uint64_t* acc, const uint8_t* p) {
+    for (int i = 0; i < 8; i++) {
+        const uint64_t d = framehash_read64(p + i*8);
+        const uint64_t dk = d ^ framehash_key[i];
+        acc[i ^ 1] += d;
+        acc[i] += (dk & 0xFFFFFFFF) * (dk >> 32);
+    }
+}
+#endif
+
+uint64_t framehash_row(const void* ptr, size_t num_bytes) {
+    const uint8_t* p = (const uint8_t*) ptr;
+    uint64_t acc[8] = {
+        FRAMEHASH_PRIME64_3, FRAMEHASH_PRIME64_1, FRAMEHASH_PRIME64_2, FRAMEHASH_PRIME64_3,
+        FRAMEHASH_PRIME64_4, FRAMEHASH_PRIME64_2, FRAMEHASH_PRIME64_5, FRAMEHASH_PRIME64_1,
+    };
+    size_t pos = 0;
+    for (; (pos + FRAMEHASH_STRIPE_SIZE) <= num_bytes; pos += FRAMEHASH_STRIPE_SIZE) {
+        framehash_accumulate(acc, p + pos);
+    }
+    if (pos < num_bytes) {
+        // the last partial stripe is zero-padded, the length is mixed in below
+        uint8_t tail[FRAMEHASH_STRIPE_SIZE] = {0};
+        memcpy(tail, p + pos, num_bytes - pos);
+        framehash_accumulate(acc, tail);
+    }
+    uint64_t h = (uint64_t)num_bytes * FRAMEHASH_PRIME64_1;
+    for (int i = 0; i < 8; i++) {
+        h ^= framehash_round(0, acc[i]);
+        h = framehash_rotl(h, 27) * FRAMEHASH_PRIME64_1 + FRAMEHASH_PRIME64_4;
+    }
+    h ^= h >> 33;
+    h *= FRAMEHASH_PRIME64_2;
+    h ^= h >> 29;
+    h *= FRAMEHASH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static bool framehash_golden_load(void) {
+    FILE* fp = fopen(state.golden.path, "r");
+    if (!fp) {
+        printf("framehash: failed to open golden manifest '%s'\n", state.golden.path);
+        return false;
+    }
+    uint32_t frame;
+    uint64_t hash;
+    while ((state.golden.num_entries < FRAMEHASH_GOLDEN_MAX_ENTRIES) && (2 == fscanf(fp, "%" SCNu32 " %" SCNx64, &frame, &hash))) {
+        state.golden.entries[state.golden.num_entries++] = (framehash_golden_entry_t){ .frame = frame, .hash = hash };
+    }
+    fclose(fp);
+    return state.golden.num_entries > 0;
+}
+
+static void framehash_golden_save(void) {
+    FILE* fp = fopen(state.golden.path, "w");
+    if (!fp) {
+        printf("framehash: failed to write golden manifest '%s'\n", state.golden.path);
+        state.golden.result = FRAMEHASH_GOLDEN_FAILED;
+        return;
+    }
+    for (int i = 0; i < state.golden.num_entries; i++) {
+        fprintf(fp, "%" PRIu32 " %016" PRIx64 "\n", state.golden.entries[i].frame, state.golden.entries[i].hash);
+    }
+    fclose(fp);
+    printf("framehash: recorded %d frames to '%s'\n", state.golden.num_entries, state.golden.path);
+    state.golden.result = FRAMEHASH_GOLDEN_PASSED;
+}
+
+// hold the emulation while an image file from the command line is loading,
+// so that it is always loaded at the same emulated frame
+static bool framehash_golden_hold(void) {
+    return fs_pending(FS_CHANNEL_IMAGES);
+}
+
+void framehash_init(const framehash_desc_t* desc) {
+    assert(desc);
+    memset(&state, 0, sizeof(state));
+    state.valid = true;
+    if (desc->golden_path && desc->golden_path[0]) {
+        snprintf(state.golden.path, sizeof(state.golden.path), "%s", desc->golden_path);
+        state.golden.record = desc->golden_record;
+        state.golden.num_frames = desc->golden_frames > 0 ? desc->golden_frames : 600;
+        state.golden.active = true;
+        if (state.golden.record || framehash_golden_load()) {
+            state.golden.result = FRAMEHASH_GOLDEN_RUNNING;
+            clock_set_fixed_frame_time(FRAMEHASH_GOLDEN_FRAME_TIME_US);
+            clock_set_hold_callback(framehash_golden_hold);
+        } else {
+            // a missing or empty manifest fails the test on the first frame
+            state.golden.result = FRAMEHASH_GOLDEN_FAILED;
+        }
+    }
+}
+
+static void framehash_golden_update(void) {
+    if (state.golden.result != FRAMEHASH_GOLDEN_RUNNING) {
+        state.golden.active = false;
+        sapp_request_quit();
+        return;
+    }
+    // frames in which the emulation was held don't count
+    if (clock_frame_held()) {
+        return;
+    }
+    // frame numbers start at 0 with the first emulated frame
+    const uint32_t frame = state.golden.frame++;
+    if (state.golden.record) {
+        if (((frame % FRAMEHASH_GOLDEN_INTERVAL) == 0) && (state.golden.num_entries < FRAMEHASH_GOLDEN_MAX_ENTRIES)) {
+            state.golden.entries[state.golden.num_entries++] = (framehash_golden_entry_t){ .frame = frame, .hash = state.hash.frame };
+        }
+        if (frame >= (uint32_t)state.golden.num_frames) {
+            framehash_golden_save();
+            state.golden.active = false;
+            sapp_request_quit();
+        }
+    } else {
+        for (int i = 0; i < state.golden.num_entries; i++) {
+            const framehash_golden_entry_t* entry = &state.golden.entries[i];
+            if (entry->frame == frame) {
+                state.golden.num_checked++;
+                if (entry->hash != state.hash.frame) {
+                    state.golden.num_failed++;
+                    printf("framehash: frame %" PRIu32 " mismatch (expected %016" PRIx64 ", got %016" PRIx64 ")\n", frame, entry->hash, state.hash.frame);
+                }
+            }
+        }
+        if (state.golden.num_checked == state.golden.num_entries) {
+            state.golden.active = false;
+            if (state.golden.num_failed > 0) {
+                printf("framehash: golden test FAILED (%d of %d frames)\n", state.golden.num_failed, state.golden.num_checked);
+                state.golden.result = FRAMEHASH_GOLDEN_FAILED;
+            } else {
+                printf("framehash: golden test passed (%d frames)\n", state.golden.num_checked);
+                state.golden.result = FRAMEHASH_GOLDEN_PASSED;
+            }
+            sapp_request_quit();
+        }
+    }
+}
+
+void framehash_update(chips_display_info_t display_info) {
+    assert(state.valid);
+    const chips_rect_t screen = display_info.screen;
+    const size_t bpp = display_info.frame.bytes_per_pixel;
+    const size_t pitch = (size_t)display_info.frame.dim.width * bpp;
+    const uint8_t* pixels = (const uint8_t*) display_info.frame.buffer.ptr;
+    int num_rows = screen.height;
+    if (num_rows > FRAMEHASH_MAX_ROWS) {
+        num_rows = FRAMEHASH_MAX_ROWS;
+    }
+    memcpy(state.hash.prev_rows, state.hash.rows, sizeof(state.hash.rows));
+    for (int y = 0; y < num_rows; y++) {
+        const uint8_t* row = pixels + (size_t)(screen.y + y) * pitch + (size_t)screen.x * bpp;
+        state.hash.rows[y] = framehash_row(row, (size_t)screen.width * bpp);
+    }
+    uint64_t seed = 0;
+    if (display_info.palette.ptr) {
+        seed = framehash_data(display_info.palette.ptr, display_info.palette.size, 0);
+    }
+    const uint64_t frame_hash = framehash_data(state.hash.rows, (size_t)num_rows * sizeof(uint64_t), seed);
+    state.hash.changed = (frame_hash != state.hash.frame) || (num_rows != state.hash.num_rows);
+    state.hash.frame = frame_hash;
+    state.hash.num_rows = num_rows;
+    state.hash.frame_count++;
+    if (state.golden.active) {
+        framehash_golden_update();
+    }
+}
+
+const framehash_t* framehash_get(void) {
+    assert(state.valid);
+    return &state.hash;
+}
+
+bool framehash_row_changed(int row) {
+    assert(state.valid);
+    if ((row < 0) || (row >= state.hash.num_rows)) {
+        return false;
+    }
+    return state.hash.rows[row] != state.hash.prev_rows[row];
+}
+
+framehash_golden_result_t framehash_golden_result(void) {
+    assert(state.valid);
+    return state.golden.result;
+}
@@ -0,0 +1,74 @@
+#pragma once
+/*
+    Framebuffer content hashing, computed once per frame in gfx_draw() so
+    that consumers can check whether the frame (or single rows of it)
+    changed without rescanning the framebuffer.
+
+    Rows are hashed in 64-byte stripes of 8 independent lanes (the XXH3
+    accumulate step), with SSE2, NEON or WASM SIMD where available, the
+    frame hash over the row hashes and the palette is xxHash64.
+
+    Also implements a golden-image test mode:
+
+    - with 'golden_record', the frame hash of every 60th frame is written
+      to the manifest file at 'golden_path'
+    - otherwise the hashes of the frames listed in the manifest file are
+      compared against the current run
+
+    Frame numbers start at 0 with the first emulated frame. The emulator
+    quits when done, the app checks framehash_golden_result() in its
+    cleanup function to set the exit code. The golden-image mode enforces
+    a fixed 60 Hz frame time, and holds the emulation while an image file
+    from the command line is loading, to make the emulation deterministic.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chips/chips_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAMEHASH_MAX_ROWS (1024)
+
+typedef enum {
+    FRAMEHASH_GOLDEN_NONE,      // golden-image mode not enabled
+    FRAMEHASH_GOLDEN_RUNNING,
+    FRAMEHASH_GOLDEN_PASSED,    // all frames matched, or the manifest was recorded
+    FRAMEHASH_GOLDEN_FAILED,
+} framehash_golden_result_t;
+
+typedef struct {
+    const char* golden_path;    // optional golden-image manifest file (null or empty string: disabled)
+    bool golden_record;         // record the manifest instead of verifying against it
+    int golden_frames;          // number of frames to run when recording (default: 600)
+} framehash_desc_t;
+
+typedef struct {
+    uint32_t frame_count;       // number of hashed frames
+    uint64_t frame;             // hash over all visible rows and the color palette
+    bool changed;               // true if the frame hash differs from the previous frame
+    int num_rows;               // number of valid row hashes
+    uint64_t rows[FRAMEHASH_MAX_ROWS];
+    uint64_t prev_rows[FRAMEHASH_MAX_ROWS];
+} framehash_t;
+
+// initialize the frame hashing (called from gfx_init())
+void framehash_init(const framehash_desc_t* desc);
+// hash the visible area of a frame (called from gfx_draw())
+void framehash_update(chips_display_info_t display_info);
+// get the hashes of the last frame
+const framehash_t* framehash_get(void);
+// return true if a row of the visible area changed since the previous frame
+bool framehash_row_changed(int row);
+// get the state of the golden-image test
+framehash_golden_result_t framehash_golden_result(void);
+// generic xxHash64 helper
+uint64_t framehash_data(const void* ptr, size_t num_bytes, uint64_t seed);
+// hash a framebuffer row (vectorized where possible)
+uint64_t framehash_row(const void* ptr, size_t num_bytes);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
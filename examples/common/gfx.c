@@ -8,10 +8,14 @@
 #include "sokol_glue.h"
 #include "chips/chips_common.h"
 #include "gfx.h"
+#include "framehash.h"
 #include "shaders.glsl.h"
 #include <assert.h>
 #include <stdlib.h> // malloc/free
 #include <string.h>
+#if defined(__EMSCRIPTEN__)
+#include <emscripten/emscripten.h>
+#endif
 
 #define GFX_DEF(v,def) (v?v:def)
 
@@ -50,6 +54,7 @@ typedef struct {
     } icon;
     int flash_success_count;
     int flash_error_count;
+    bool first_frame_drawn;
     gfx_draw_extra_t draw_extra_cb;
 } gfx_state_t;
 static gfx_state_t state;
@@ -286,6 +291,7 @@ void gfx_init(const gfx_desc_t* desc) {
     state.offscreen.pixel_aspect.width = GFX_DEF(desc->pixel_aspect.width, 1);
     state.offscreen.pixel_aspect.height = GFX_DEF(desc->pixel_aspect.height, 1);
     state.offscreen.view = desc->display_info.screen;
+    framehash_init(&desc->framehash);
 
     if (state.fb.paletted) {
         static uint32_t palette_buf[256];
@@ -382,6 +388,15 @@ void gfx_init(const gfx_desc_t* desc) {
     gfx_init_images_and_pass();
 }
 
+#if defined(__EMSCRIPTEN__)
+// notify the web page that the first frame has been rendered (for the boot time breakdown)
+EM_JS(void, gfx_js_first_frame, (void), {
+    if (Module["onFirstFrame"]) {
+        Module["onFirstFrame"]();
+    }
+});
+#endif
+
 /* apply a viewport rectangle to preserve the emulator's aspect ratio,
    and for 'portrait' orientations, keep the emulator display at the
    top, to make room at the bottom for mobile virtual keyboard
@@ -421,6 +436,9 @@ void gfx_draw(chips_display_info_t display_info) {
     assert((display_info.screen.width > 0) && (display_info.screen.height > 0));
     const chips_dim_t display = { .width = sapp_width(), .height = sapp_height() };
 
+    // hash the emulator framebuffer once per frame
+    framehash_update(display_info);
+
     state.offscreen.view = display_info.screen;
 
     // check if emulator framebuffer size has changed, need to create new backing texture
@@ -522,11 +540,17 @@ void gfx_draw(chips_display_info_t display_info) {
             .display_image = state.offscreen.img,
             .display_sampler = state.offscreen.smp,
             .display_info = display_info,
+            .framehash = framehash_get(),
         });
     }
     sg_end_pass();
     sg_commit();
-
+    if (!state.first_frame_drawn) {
+        state.first_frame_drawn = true;
+        #if defined(__EMSCRIPTEN__)
+        gfx_js_first_frame();
+        #endif
+    }
 }
 
 void gfx_shutdown() {
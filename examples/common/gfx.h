@@ -11,6 +11,7 @@
 #include <stddef.h>
 #include "sokol_gfx.h"
 #include "chips/chips_common.h"
+#include "framehash.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,6 +25,7 @@ typedef struct {
     sg_image display_image;
     sg_sampler display_sampler;
     chips_display_info_t display_info;
+    const framehash_t* framehash;
 } gfx_draw_info_t;
 
 typedef void(*gfx_draw_extra_t)(const gfx_draw_info_t* draw_info);
@@ -34,6 +36,7 @@ typedef struct {
     chips_display_info_t display_info;
     chips_dim_t pixel_aspect;   // optional pixel aspect ratio, default is 1:1
     gfx_draw_extra_t draw_extra_cb;
+    framehash_desc_t framehash;     // optional golden-image test params
 } gfx_desc_t;
 
 void gfx_init(const gfx_desc_t* desc);
@@ -2,15 +2,36 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <stdbool.h>
 #include <assert.h>
 
 #define KEYBUF_MAX_KEYS (64 * 1024)
+#define KEYBUF_MAX_CMD_KEY (16)
+#define KEYBUF_MAX_CMD_VALUE (64)
+#define KEYBUF_DEFAULT_WAIT_TIMEOUT_FRAMES (60 * 60)
+
+typedef enum {
+    KEYBUF_WAIT_NONE,
+    KEYBUF_WAIT_PC,
+    KEYBUF_WAIT_MEM,
+    KEYBUF_WAIT_SCREEN,
+} keybuf_wait_t;
+
 typedef struct {
     bool valid;
     int cur_pos;
     int cur_delay_time;
     int key_delay_time;
+    int wait_timeout;
+    keybuf_sys_t sys;
+    struct {
+        keybuf_wait_t type;
+        int time_left;
+        uint16_t addr;
+        uint8_t val;
+        char text[KEYBUF_MAX_CMD_VALUE];
+    } wait;
     uint8_t buf[KEYBUF_MAX_KEYS];
 } keybuf_state_t;
 static keybuf_state_t state;
@@ -19,6 +40,8 @@ void keybuf_init(const keybuf_desc_t* desc) {
     state = (keybuf_state_t) {
         .valid = true,
         .key_delay_time = desc->key_delay_frames * 16667,
+        .wait_timeout = ((desc->wait_timeout_frames > 0) ? desc->wait_timeout_frames : KEYBUF_DEFAULT_WAIT_TIMEOUT_FRAMES) * 16667,
+        .sys = desc->sys,
     };
 }
 
@@ -28,6 +51,7 @@ void keybuf_put(const char* text) {
         return;
     }
     state.cur_delay_time = 0;
+    state.wait.type = KEYBUF_WAIT_NONE;
     int len = (int) strlen(text);
     if ((len+1) < KEYBUF_MAX_KEYS) {
         strcpy((char*)state.buf, text);
@@ -67,14 +91,81 @@ static bool _keybuf_extract(uint8_t delim, uint8_t* buf, int buf_size) {
     return false;
 }
 
+// parse a ${waitpc:ADDR} argument
+static bool _keybuf_parse_pc(const char* str) {
+    char* end;
+    const long addr = strtol(str, &end, 16);
+    if ((end == str) || (*end != 0) || (addr < 0) || (addr > 0xFFFF)) {
+        return false;
+    }
+    state.wait.addr = (uint16_t)addr;
+    return true;
+}
+
+// parse a ${waitmem:ADDR=VAL} argument
+static bool _keybuf_parse_mem(const char* str) {
+    char* end;
+    const long addr = strtol(str, &end, 16);
+    if ((end == str) || (*end != '=') || (addr < 0) || (addr > 0xFFFF)) {
+        return false;
+    }
+    const char* val_str = end + 1;
+    const long val = strtol(val_str, &end, 16);
+    if ((end == val_str) || (*end != 0) || (val < 0) || (val > 0xFF)) {
+        return false;
+    }
+    state.wait.addr = (uint16_t)addr;
+    state.wait.val = (uint8_t)val;
+    return true;
+}
+
+static void _keybuf_start_wait(keybuf_wait_t type) {
+    state.wait.type = type;
+    state.wait.time_left = state.wait_timeout;
+}
+
 static uint8_t _keybuf_parse_cmd(void) {
     /* skip initial '{' */
     _keybuf_next();
-    uint8_t key[8];
-    uint8_t val[8];
+    uint8_t key[KEYBUF_MAX_CMD_KEY];
+    uint8_t val[KEYBUF_MAX_CMD_VALUE];
     if (_keybuf_extract(':', key, sizeof(key))) {
         if (_keybuf_extract('}', val, sizeof(val))) {
-            if (strcmp((const char*)key, "wait") == 0) {
+            if (strcmp((const char*)key, "waitpc") == 0) {
+                if (!state.sys.pc_reached) {
+                    printf("keybuf: ${waitpc:%s} not supported by this system, skipped\n", (const char*)val);
+                }
+                else if (!_keybuf_parse_pc((const char*)val)) {
+                    printf("keybuf: malformed ${waitpc:%s}, skipped\n", (const char*)val);
+                }
+                else {
+                    _keybuf_start_wait(KEYBUF_WAIT_PC);
+                }
+                return 0;
+            }
+            else if (strcmp((const char*)key, "waitmem") == 0) {
+                if (!state.sys.mem_rd) {
+                    printf("keybuf: ${waitmem:%s} not supported by this system, skipped\n", (const char*)val);
+                }
+                else if (!_keybuf_parse_mem((const char*)val)) {
+                    printf("keybuf: malformed ${waitmem:%s}, skipped\n", (const char*)val);
+                }
+                else {
+                    _keybuf_start_wait(KEYBUF_WAIT_MEM);
+                }
+                return 0;
+            }
+            else if (strcmp((const char*)key, "waitscreen") == 0) {
+                if (!state.sys.screen_contains) {
+                    printf("keybuf: ${waitscreen:%s} not supported by this system, skipped\n", (const char*)val);
+                }
+                else {
+                    strcpy(state.wait.text, (const char*)val);
+                    _keybuf_start_wait(KEYBUF_WAIT_SCREEN);
+                }
+                return 0;
+            }
+            else if (strcmp((const char*)key, "wait") == 0) {
                 state.cur_delay_time = atoi((const char*)val) * 16667;
                 return 0;
             }
@@ -91,10 +182,40 @@ static uint8_t _keybuf_parse_cmd(void) {
     return 0;
 }
 
-uint8_t keybuf_get(uint32_t frame_time_us) {
+// check the condition of a conditional wait command (only started if the callback exists)
+static bool _keybuf_wait_done(void) {
+    const keybuf_sys_t* sys = &state.sys;
+    switch (state.wait.type) {
+        case KEYBUF_WAIT_PC:
+            return sys->pc_reached(state.wait.addr, sys->user_data);
+        case KEYBUF_WAIT_MEM:
+            return sys->mem_rd(state.wait.addr, sys->user_data) == state.wait.val;
+        case KEYBUF_WAIT_SCREEN:
+            return sys->screen_contains(state.wait.text, sys->user_data);
+        default:
+            return true;
+    }
+}
+
+uint8_t keybuf_get(uint32_t micro_seconds) {
     assert(state.valid);
     uint8_t c = 0;
-    if (state.cur_delay_time <= 0) {
+    if (state.wait.type != KEYBUF_WAIT_NONE) {
+        // the next key follows one key delay after the condition is met
+        bool done = _keybuf_wait_done();
+        if (!done) {
+            state.wait.time_left -= (int) micro_seconds;
+            if (state.wait.time_left <= 0) {
+                printf("keybuf: conditional wait timed out, continuing\n");
+                done = true;
+            }
+        }
+        if (done) {
+            state.wait.type = KEYBUF_WAIT_NONE;
+            state.cur_delay_time = state.key_delay_time;
+        }
+    }
+    else if (state.cur_delay_time <= 0) {
         state.cur_delay_time = state.key_delay_time;
         c = _keybuf_next();
         if (c != 0) {
@@ -109,7 +230,16 @@ uint8_t keybuf_get(uint32_t frame_time_us) {
         }
     }
     else {
-        state.cur_delay_time -= (int) frame_time_us;
+        state.cur_delay_time -= (int) micro_seconds;
     }
     return c;
 }
+
+bool keybuf_wait_pc(uint16_t* out_addr) {
+    assert(state.valid && out_addr);
+    if (state.wait.type == KEYBUF_WAIT_PC) {
+        *out_addr = state.wait.addr;
+        return true;
+    }
+    return false;
+}
@@ -5,16 +5,48 @@
     Special embedded commands:
 
     ${wait:20} - wait 20 frames before continuing
+    ${delay:10} - set the delay between keys to 10 frames
+    ${key:13} - feed a key code
+    ${waitpc:E5CD} - wait until the CPU reaches address E5CD (hex)
+    ${waitmem:00C6=0} - wait until memory location 00C6 contains 0 (both hex)
+    ${waitscreen:READY.} - wait until the screen shows the text 'READY.' (up to 63 characters)
+
+    The conditional wait commands are checked once per keybuf_get() call
+    with the system callbacks provided in keybuf_desc_t. If the system
+    doesn't provide the callback for a command, or the command's argument
+    is malformed, a warning is printed and the command is skipped. A wait
+    whose condition isn't met within wait_timeout_frames is abandoned with
+    a warning, and playback continues.
+
+    All delays and timeouts are counted in emulated time (the sum of the
+    micro_seconds passed to keybuf_get()), not in calls, so it doesn't
+    matter whether keybuf_get() is called once per frame or between the
+    exec slices of a frame.
 */
 #include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    // true if the CPU has reached the address since the ${waitpc:} started (see keybuf_wait_pc())
+    bool (*pc_reached)(uint16_t addr, void* user_data);
+    // read a byte from the CPU's address space
+    uint8_t (*mem_rd)(uint16_t addr, void* user_data);
+    // true if the screen shows the text
+    bool (*screen_contains)(const char* text, void* user_data);
+    void* user_data;
+} keybuf_sys_t;
 
 typedef struct {
     int key_delay_frames;
+    int wait_timeout_frames;    // give up a conditional wait after this many 60 Hz frames (default: 3600)
+    keybuf_sys_t sys;           // optional callbacks for the conditional wait commands
 } keybuf_desc_t;
 
 // initialize the keybuf with a base-delay between keys in 60 Hz frames
 void keybuf_init(const keybuf_desc_t* desc);
 // put a text for playback into keybuf
 void keybuf_put(const char* text);
-// get next key to feed into emulator, call once per frame, returns 0 if no key to feed
-uint8_t keybuf_get(uint32_t frame_time_us);
+// get next key to feed into emulator, call between exec slices with the emulated time since the previous call, returns 0 if no key to feed
+uint8_t keybuf_get(uint32_t micro_seconds);
+// return true and the address while a ${waitpc:} command is waiting (to install a program counter trap)
+bool keybuf_wait_pc(uint16_t* out_addr);
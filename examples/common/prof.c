@@ -79,7 +79,8 @@ prof_stats_t prof_stats(prof_bucket_type_t type) {
     prof_ring_t* ring = &state.buckets[type].ring;
     stats.count = prof_ring_count(ring);
     if (stats.count > 0) {
-        stats.min_val = 1000.0f;
+        stats.min_val = prof_ring_get(ring, 0);
+        stats.max_val = stats.min_val;
         for (int i = 0; i < stats.count; i++) {
             float val = prof_ring_get(ring, i);
             stats.avg_val += val;
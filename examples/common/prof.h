@@ -4,6 +4,8 @@
 typedef enum {
     PROF_FRAME,     // frame time
     PROF_EMU,       // emulator time
+    PROF_SLICE,     // emulator time per exec slice (see slice.h)
+    PROF_SLICE_TICKS,   // emulator ticks per exec slice
     PROF_NUM_BUCKET_TYPES,
 } prof_bucket_type_t;
 
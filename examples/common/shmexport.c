@@ -0,0 +1,273 @@
+#include "shmexport.h"
+#include <string.h>
+#include <assert.h>
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#define SHMEXPORT_POSIX
+#endif
+
+#define SHMEXPORT_NAME_SIZE (256)
+
+typedef struct {
+    bool valid;
+    char name[SHMEXPORT_NAME_SIZE];
+    shmexport_header_t* hdr;
+    size_t max_pixels_size;
+} shmexport_state_t;
+static shmexport_state_t state;
+
+#if defined(SHMEXPORT_POSIX)
+
+// the seqlock value of a slot: odd while writing, 2*seq when published
+#define _SHMEXPORT_WRITING(seq) ((seq) * 2 - 1)
+#define _SHMEXPORT_DONE(seq) ((seq) * 2)
+
+static uint64_t _shmexport_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static shmexport_frame_t* _shmexport_frame_slot(const shmexport_header_t* hdr, uint64_t seq) {
+    const size_t slot_index = (size_t)(seq % SHMEXPORT_NUM_FRAME_SLOTS);
+    return (shmexport_frame_t*)((uint8_t*)hdr + hdr->frame_slots_offset + slot_index * hdr->frame_slot_size);
+}
+
+static shmexport_audio_t* _shmexport_audio_slot(const shmexport_header_t* hdr, uint64_t seq) {
+    const size_t slot_index = (size_t)(seq % SHMEXPORT_NUM_AUDIO_SLOTS);
+    return (shmexport_audio_t*)((uint8_t*)hdr + hdr->audio_slots_offset) + slot_index;
+}
+
+static void _shmexport_write_begin(uint64_t* slot_seq, uint64_t seq) {
+    __atomic_store_n(slot_seq, _SHMEXPORT_WRITING(seq), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void _shmexport_write_end(uint64_t* slot_seq, uint64_t* hdr_seq, uint64_t seq) {
+    __atomic_store_n(slot_seq, _SHMEXPORT_DONE(seq), __ATOMIC_RELEASE);
+    __atomic_store_n(hdr_seq, seq, __ATOMIC_RELEASE);
+}
+
+bool shmexport_init(const shmexport_desc_t* desc) {
+    assert(!state.valid);
+    assert(desc && desc->name);
+    const chips_display_info_t* info = &desc->display_info;
+    assert((info->frame.bytes_per_pixel == 1) || (info->frame.bytes_per_pixel == 4));
+    if (strlen(desc->name) >= SHMEXPORT_NAME_SIZE) {
+        return false;
+    }
+    memset(&state, 0, sizeof(state));
+    // the screen area may change, but never exceeds the framebuffer
+    state.max_pixels_size = (size_t)info->frame.dim.width * (size_t)info->frame.dim.height * info->frame.bytes_per_pixel;
+    const size_t frame_slot_size = (sizeof(shmexport_frame_t) + state.max_pixels_size + 63) & ~(size_t)63;
+    const size_t frame_slots_offset = (sizeof(shmexport_header_t) + 63) & ~(size_t)63;
+    const size_t audio_slots_offset = frame_slots_offset + frame_slot_size * SHMEXPORT_NUM_FRAME_SLOTS;
+    const size_t size = audio_slots_offset + sizeof(shmexport_audio_t) * SHMEXPORT_NUM_AUDIO_SLOTS;
+
+    const int fd = shm_open(desc->name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) < 0) {
+        close(fd);
+        shm_unlink(desc->name);
+        return false;
+    }
+    void* ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        shm_unlink(desc->name);
+        return false;
+    }
+    // the object may be left over from a previous run
+    memset(ptr, 0, size);
+    state.hdr = (shmexport_header_t*)ptr;
+    state.hdr->version = SHMEXPORT_VERSION;
+    state.hdr->size = (uint32_t)size;
+    state.hdr->frame_slot_size = (uint32_t)frame_slot_size;
+    state.hdr->frame_slots_offset = (uint32_t)frame_slots_offset;
+    state.hdr->audio_slots_offset = (uint32_t)audio_slots_offset;
+    state.hdr->sample_rate = (uint32_t)desc->sample_rate;
+    // publish the magic last, consumers check it when attaching
+    __atomic_store_n(&state.hdr->magic, SHMEXPORT_MAGIC, __ATOMIC_RELEASE);
+    strcpy(state.name, desc->name);
+    state.valid = true;
+    return true;
+}
+
+void shmexport_shutdown(void) {
+    if (!state.valid) {
+        return;
+    }
+    __atomic_store_n(&state.hdr->magic, 0, __ATOMIC_RELEASE);
+    munmap(state.hdr, state.hdr->size);
+    shm_unlink(state.name);
+    memset(&state, 0, sizeof(state));
+}
+
+void shmexport_frame(chips_display_info_t info) {
+    if (!state.valid) {
+        return;
+    }
+    shmexport_header_t* hdr = state.hdr;
+    const size_t bpp = info.frame.bytes_per_pixel;
+    const size_t row_size = (size_t)info.screen.width * bpp;
+    if ((row_size * (size_t)info.screen.height) > state.max_pixels_size) {
+        return;
+    }
+    const uint64_t seq = hdr->frame_seq + 1;
+    shmexport_frame_t* frame = _shmexport_frame_slot(hdr, seq);
+    _shmexport_write_begin(&frame->seq, seq);
+    frame->time_ns = _shmexport_time_ns();
+    frame->width = (uint32_t)info.screen.width;
+    frame->height = (uint32_t)info.screen.height;
+    frame->bytes_per_pixel = (uint32_t)bpp;
+    frame->num_colors = 0;
+    if ((bpp == 1) && info.palette.ptr) {
+        size_t num_colors = info.palette.size / sizeof(uint32_t);
+        if (num_colors > SHMEXPORT_MAX_COLORS) {
+            num_colors = SHMEXPORT_MAX_COLORS;
+        }
+        memcpy(frame->palette, info.palette.ptr, num_colors * sizeof(uint32_t));
+        frame->num_colors = (uint32_t)num_colors;
+    }
+    const size_t pitch = (size_t)info.frame.dim.width * bpp;
+    const uint8_t* src = (const uint8_t*)info.frame.buffer.ptr + (size_t)info.screen.y * pitch + (size_t)info.screen.x * bpp;
+    uint8_t* dst = (uint8_t*)(frame + 1);
+    for (int y = 0; y < info.screen.height; y++, src += pitch, dst += row_size) {
+        memcpy(dst, src, row_size);
+    }
+    _shmexport_write_end(&frame->seq, &hdr->frame_seq, seq);
+}
+
+void shmexport_audio(const float* samples, int num_samples) {
+    if (!state.valid) {
+        return;
+    }
+    assert(samples && (num_samples >= 0));
+    shmexport_header_t* hdr = state.hdr;
+    while (num_samples > 0) {
+        const int n = (num_samples > SHMEXPORT_MAX_AUDIO_SAMPLES) ? SHMEXPORT_MAX_AUDIO_SAMPLES : num_samples;
+        const uint64_t seq = hdr->audio_seq + 1;
+        shmexport_audio_t* audio = _shmexport_audio_slot(hdr, seq);
+        _shmexport_write_begin(&audio->seq, seq);
+        audio->time_ns = _shmexport_time_ns();
+        audio->frame_seq = hdr->frame_seq;
+        audio->num_samples = (uint32_t)n;
+        memcpy(audio->samples, samples, (size_t)n * sizeof(float));
+        _shmexport_write_end(&audio->seq, &hdr->audio_seq, seq);
+        samples += n;
+        num_samples -= n;
+    }
+}
+
+const shmexport_header_t* shmexport_attach(const char* name) {
+    assert(name);
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if ((fstat(fd, &st) < 0) || ((size_t)st.st_size < sizeof(shmexport_header_t))) {
+        close(fd);
+        return 0;
+    }
+    void* ptr = mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        return 0;
+    }
+    const shmexport_header_t* hdr = (const shmexport_header_t*)ptr;
+    if ((__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != SHMEXPORT_MAGIC) ||
+        (hdr->version != SHMEXPORT_VERSION) ||
+        (hdr->size != (uint32_t)st.st_size))
+    {
+        munmap(ptr, (size_t)st.st_size);
+        return 0;
+    }
+    return hdr;
+}
+
+void shmexport_detach(const shmexport_header_t* hdr) {
+    if (hdr) {
+        munmap((void*)hdr, hdr->size);
+    }
+}
+
+uint64_t shmexport_frame_seq(const shmexport_header_t* hdr) {
+    assert(hdr);
+    return __atomic_load_n(&hdr->frame_seq, __ATOMIC_ACQUIRE);
+}
+
+uint64_t shmexport_audio_seq(const shmexport_header_t* hdr) {
+    assert(hdr);
+    return __atomic_load_n(&hdr->audio_seq, __ATOMIC_ACQUIRE);
+}
+
+const shmexport_frame_t* shmexport_frame_begin(const shmexport_header_t* hdr, uint64_t seq) {
+    assert(hdr);
+    if ((seq == 0) || (seq > shmexport_frame_seq(hdr))) {
+        return 0;
+    }
+    const shmexport_frame_t* frame = _shmexport_frame_slot(hdr, seq);
+    if (__atomic_load_n(&frame->seq, __ATOMIC_ACQUIRE) != _SHMEXPORT_DONE(seq)) {
+        return 0;
+    }
+    return frame;
+}
+
+const uint8_t* shmexport_frame_pixels(const shmexport_frame_t* frame) {
+    assert(frame);
+    return (const uint8_t*)(frame + 1);
+}
+
+bool shmexport_frame_end(const shmexport_frame_t* frame, uint64_t seq) {
+    assert(frame);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&frame->seq, __ATOMIC_RELAXED) == _SHMEXPORT_DONE(seq);
+}
+
+const shmexport_audio_t* shmexport_audio_begin(const shmexport_header_t* hdr, uint64_t seq) {
+    assert(hdr);
+    if ((seq == 0) || (seq > shmexport_audio_seq(hdr))) {
+        return 0;
+    }
+    const shmexport_audio_t* audio = _shmexport_audio_slot(hdr, seq);
+    if (__atomic_load_n(&audio->seq, __ATOMIC_ACQUIRE) != _SHMEXPORT_DONE(seq)) {
+        return 0;
+    }
+    return audio;
+}
+
+bool shmexport_audio_end(const shmexport_audio_t* audio, uint64_t seq) {
+    assert(audio);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&audio->seq, __ATOMIC_RELAXED) == _SHMEXPORT_DONE(seq);
+}
+
+#else
+
+// no shared memory on this platform
+bool shmexport_init(const shmexport_desc_t* desc) { (void)desc; return false; }
+void shmexport_shutdown(void) { }
+void shmexport_frame(chips_display_info_t info) { (void)info; }
+void shmexport_audio(const float* samples, int num_samples) { (void)samples; (void)num_samples; }
+const shmexport_header_t* shmexport_attach(const char* name) { (void)name; return 0; }
+void shmexport_detach(const shmexport_header_t* hdr) { (void)hdr; }
+uint64_t shmexport_frame_seq(const shmexport_header_t* hdr) { (void)hdr; return 0; }
+uint64_t shmexport_audio_seq(const shmexport_header_t* hdr) { (void)hdr; return 0; }
+const shmexport_frame_t* shmexport_frame_begin(const shmexport_header_t* hdr, uint64_t seq) { (void)hdr; (void)seq; return 0; }
+const uint8_t* shmexport_frame_pixels(const shmexport_frame_t* frame) { (void)frame; return 0; }
+bool shmexport_frame_end(const shmexport_frame_t* frame, uint64_t seq) { (void)frame; (void)seq; return false; }
+const shmexport_audio_t* shmexport_audio_begin(const shmexport_header_t* hdr, uint64_t seq) { (void)hdr; (void)seq; return 0; }
+bool shmexport_audio_end(const shmexport_audio_t* audio, uint64_t seq) { (void)audio; (void)seq; return false; }
+
+#endif
+
+bool shmexport_active(void) {
+    return state.valid;
+}
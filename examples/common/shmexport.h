@@ -0,0 +1,107 @@
+#pragma once
+/*
+    Frame and audio export into a shared-memory ring (POSIX only).
+
+    The emulator publishes each completed frame (the visible screen area,
+    as palette indices plus palette, or RGBA8) and each audio block into
+    a POSIX shared-memory object, so that recorders, encoders and analysis
+    tools can run in separate processes. The producer never waits for a
+    consumer: the rings have a fixed number of slots and old slots are
+    simply overwritten.
+
+    Each slot is guarded by a sequence number (a seqlock): it is odd
+    while the producer writes the slot, and twice the published sequence
+    number when done. Consumers read directly from the mapped memory
+    (zero-copy) between shmexport_frame_begin() and shmexport_frame_end(),
+    and drop the frame if end() returns false because the producer
+    lapped them.
+
+    Sequence numbers start at 1, the header's frame_seq/audio_seq are
+    the last published sequence numbers (0: nothing published yet).
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chips/chips_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHMEXPORT_MAGIC (0x58454843)     // 'CHEX'
+#define SHMEXPORT_VERSION (1)
+#define SHMEXPORT_NUM_FRAME_SLOTS (4)
+#define SHMEXPORT_NUM_AUDIO_SLOTS (32)
+#define SHMEXPORT_MAX_AUDIO_SAMPLES (1024)
+#define SHMEXPORT_MAX_COLORS (256)
+
+typedef struct {
+    uint64_t seq;           // odd while being written
+    uint64_t time_ns;       // host time when published (CLOCK_MONOTONIC)
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_pixel;   // 1: palette indices, 4: RGBA8
+    uint32_t num_colors;
+    uint32_t palette[SHMEXPORT_MAX_COLORS];
+    // followed by width * height * bytes_per_pixel pixels
+} shmexport_frame_t;
+
+typedef struct {
+    uint64_t seq;           // odd while being written
+    uint64_t time_ns;       // host time when published (CLOCK_MONOTONIC)
+    uint64_t frame_seq;     // last frame published before this block
+    uint32_t num_samples;   // mono float samples
+    uint32_t _pad;
+    float samples[SHMEXPORT_MAX_AUDIO_SAMPLES];
+} shmexport_audio_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;              // size of the whole shared-memory object
+    uint32_t frame_slot_size;   // including the shmexport_frame_t header
+    uint32_t frame_slots_offset;
+    uint32_t audio_slots_offset;
+    uint32_t sample_rate;
+    uint32_t _pad;
+    uint64_t frame_seq;         // last published frame
+    uint64_t audio_seq;         // last published audio block
+} shmexport_header_t;
+
+typedef struct {
+    const char* name;           // shared-memory object name, e.g. "/chips-c64"
+    chips_display_info_t display_info;  // for the maximum frame size
+    int sample_rate;
+} shmexport_desc_t;
+
+// producer: create the shared-memory object, returns false if not supported or failed
+bool shmexport_init(const shmexport_desc_t* desc);
+// producer: remove the shared-memory object
+void shmexport_shutdown(void);
+// producer: return true if initialized
+bool shmexport_active(void);
+// producer: publish a frame
+void shmexport_frame(chips_display_info_t display_info);
+// producer: publish audio samples (split into blocks of SHMEXPORT_MAX_AUDIO_SAMPLES)
+void shmexport_audio(const float* samples, int num_samples);
+
+// consumer: map an existing shared-memory object read-only, returns null on failure
+const shmexport_header_t* shmexport_attach(const char* name);
+// consumer: unmap a shared-memory object
+void shmexport_detach(const shmexport_header_t* hdr);
+// consumer: get the last published frame or audio sequence number
+uint64_t shmexport_frame_seq(const shmexport_header_t* hdr);
+uint64_t shmexport_audio_seq(const shmexport_header_t* hdr);
+// consumer: start reading a frame, returns null if the frame is not (or no longer) available
+const shmexport_frame_t* shmexport_frame_begin(const shmexport_header_t* hdr, uint64_t seq);
+// consumer: get the pixels of a frame
+const uint8_t* shmexport_frame_pixels(const shmexport_frame_t* frame);
+// consumer: finish reading a frame, returns false if the frame was overwritten while reading
+bool shmexport_frame_end(const shmexport_frame_t* frame, uint64_t seq);
+// consumer: same for audio blocks
+const shmexport_audio_t* shmexport_audio_begin(const shmexport_header_t* hdr, uint64_t seq);
+bool shmexport_audio_end(const shmexport_audio_t* audio, uint64_t seq);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
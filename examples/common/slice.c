@@ -0,0 +1,132 @@
+#include "sokol_time.h"
+#include "sokol_debugtext.h"
+#include "prof.h"
+#include "slice.h"
+#include <assert.h>
+#include <stdbool.h>
+
+typedef struct {
+    bool valid;
+    uint32_t slice_us;
+    slice_exec_t exec_cb;
+    slice_between_t between_cb;
+    slice_warp_t warp_cb;
+    uint32_t warp_budget_us;
+    uint32_t freq_hz;
+    // sub-tick remainder in millionths of a tick
+    int64_t carry;
+    int count;
+    int warp_frames;
+    bool warping;
+} slice_state_t;
+static slice_state_t state;
+
+void slice_init(const slice_desc_t* desc) {
+    assert(desc && desc->exec_cb);
+    state = (slice_state_t) {
+        .valid = true,
+        .slice_us = desc->slice_us,
+        .exec_cb = desc->exec_cb,
+        .between_cb = desc->between_cb,
+        .warp_cb = desc->warp_cb,
+        .warp_budget_us = (desc->warp_budget_us > 0) ? desc->warp_budget_us : SLICE_DEFAULT_WARP_BUDGET_US,
+        .freq_hz = desc->freq_hz,
+    };
+}
+
+void slice_set_freq(uint32_t freq_hz) {
+    assert(state.valid);
+    if (freq_hz != state.freq_hz) {
+        state.freq_hz = freq_hz;
+        state.carry = 0;
+    }
+}
+
+// run one slice, with the sub-tick remainder of the previous slice
+static uint32_t _slice_exec_carry(uint32_t us) {
+    if ((0 == state.freq_hz) || (0 == us)) {
+        return state.exec_cb(us);
+    }
+    const int64_t budget = (int64_t)us * state.freq_hz + state.carry;
+    const uint32_t exec_us = (budget > 0) ? (uint32_t)(budget / state.freq_hz) : 0;
+    const uint32_t ticks = (exec_us > 0) ? state.exec_cb(exec_us) : 0;
+    const uint64_t expected_ticks = ((uint64_t)exec_us * state.freq_hz) / 1000000;
+    if ((ticks == 0) && (expected_ticks > 0)) {
+        // execution is stopped (e.g. in the debugger), don't pile up time
+        state.carry = 0;
+    }
+    else {
+        state.carry = budget - (int64_t)ticks * 1000000;
+    }
+    return ticks;
+}
+
+// run one frame worth of emulated time in slices
+static uint32_t _slice_exec_frame(uint32_t frame_time_us) {
+    uint32_t ticks = 0;
+    uint32_t remaining_us = frame_time_us;
+    do {
+        uint32_t us = remaining_us;
+        if ((state.slice_us > 0) && (us > state.slice_us)) {
+            us = state.slice_us;
+        }
+        const uint64_t start_time = stm_now();
+        const uint32_t slice_ticks = _slice_exec_carry(us);
+        prof_push(PROF_SLICE, (float)stm_ms(stm_since(start_time)));
+        prof_push(PROF_SLICE_TICKS, (float)slice_ticks);
+        if (state.between_cb) {
+            state.between_cb(us);
+        }
+        ticks += slice_ticks;
+        remaining_us -= us;
+        state.count++;
+    } while (remaining_us > 0);
+    return ticks;
+}
+
+uint32_t slice_exec(uint32_t frame_time_us) {
+    assert(state.valid);
+    const uint64_t start_time = stm_now();
+    state.count = 0;
+    state.warp_frames = 0;
+    uint32_t ticks = _slice_exec_frame(frame_time_us);
+    if (state.warp_cb && (ticks > 0) && (frame_time_us > 0)) {
+        // fast-forward while the system asks for it, stop when no ticks were
+        // executed (e.g. the debugger stopped execution)
+        state.warping = true;
+        while (state.warp_cb() && (stm_us(stm_since(start_time)) < state.warp_budget_us)) {
+            const uint32_t warp_ticks = _slice_exec_frame(frame_time_us);
+            if (warp_ticks == 0) {
+                break;
+            }
+            ticks += warp_ticks;
+            state.warp_frames++;
+        }
+        state.warping = false;
+    }
+    return ticks;
+}
+
+int slice_count(void) {
+    assert(state.valid);
+    return state.count;
+}
+
+int slice_warp_frames(void) {
+    assert(state.valid);
+    return state.warp_frames;
+}
+
+bool slice_warping(void) {
+    return state.warping;
+}
+
+void slice_draw_stats(float x, float y) {
+    assert(state.valid);
+    if (state.count > 1) {
+        const prof_stats_t slice_stats = prof_stats(PROF_SLICE);
+        const prof_stats_t slice_ticks = prof_stats(PROF_SLICE_TICKS);
+        sdtx_pos(x, y);
+        sdtx_printf("slices:%d slice:%.3fms (min:%.3fms max:%.3fms) ticks/slice:%.0f", state.count, slice_stats.avg_val, slice_stats.min_val, slice_stats.max_val, slice_ticks.avg_val);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+/*
+    Run an emulator's *_exec() function in configurable micro-slices (for
+    instance one scanline or 1 ms) instead of once per host frame.
+
+    Smaller slices reduce the latency for input that's fed into the emulator
+    between slices, larger slices reduce the per-call overhead. The host time
+    and number of ticks of each slice are recorded in the PROF_SLICE and
+    PROF_SLICE_TICKS profiler buckets.
+
+    The *_exec() functions truncate the microseconds to whole clock ticks,
+    with a freq_hz the sub-tick remainder is carried over into the next
+    slice, so that no emulated time is lost with short slices (a 1 ms
+    slice on the C64 would otherwise lose a quarter tick each time).
+
+    An optional warp callback lets a system fast-forward (e.g. while a disc
+    or tape is loading): as long as the callback returns true, additional
+    frames are emulated until the host time budget for the frame is used up.
+    Emulation is unchanged, only more emulated time passes per host frame.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// run the emulated system for a number of microseconds, return number of executed ticks
+typedef uint32_t (*slice_exec_t)(uint32_t micro_seconds);
+// called after each slice with the slice duration (e.g. to feed input)
+typedef void (*slice_between_t)(uint32_t micro_seconds);
+// return true to emulate additional frames in the current host frame
+typedef bool (*slice_warp_t)(void);
+
+#define SLICE_DEFAULT_WARP_BUDGET_US (12000)
+
+typedef struct {
+    uint32_t slice_us;              // slice duration in microseconds, 0 for one slice per frame
+    slice_exec_t exec_cb;           // wraps the system's *_exec() function
+    slice_between_t between_cb;     // optional callback between slices
+    slice_warp_t warp_cb;           // optional callback to enable warp mode
+    uint32_t warp_budget_us;        // host time budget per frame in warp mode (default: 12 ms)
+    uint32_t freq_hz;               // the system's clock frequency, to carry sub-tick remainders (0: no carry)
+} slice_desc_t;
+
+// initialize the slice driver, call after prof_init()
+void slice_init(const slice_desc_t* desc);
+// change the system clock frequency (e.g. after switching the system model), no-op if unchanged
+void slice_set_freq(uint32_t freq_hz);
+// run the emulator for one host frame in slices, return number of executed ticks
+uint32_t slice_exec(uint32_t frame_time_us);
+// get the number of slices executed in the last frame
+int slice_count(void);
+// get the number of additional warp frames executed in the last frame
+int slice_warp_frames(void);
+// return true while executing warp frames (e.g. to mute audio)
+bool slice_warping(void);
+// draw the slice statistics at a debug text position if more than one slice ran in the last frame
+void slice_draw_stats(float x, float y);
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
@@ -0,0 +1,80 @@
+#include "snapshot.h"
+#include <string.h>
+#include <assert.h>
+
+snapshot_layout_t snapshot_layout(size_t system_size, const snapshot_range_t* exclude, int num_exclude) {
+    assert(exclude || (num_exclude == 0));
+    assert((num_exclude >= 0) && (num_exclude <= SNAPSHOT_MAX_RANGES));
+    snapshot_layout_t layout;
+    memset(&layout, 0, sizeof(layout));
+    layout.system_size = system_size;
+    // insertion sort by offset
+    snapshot_range_t sorted[SNAPSHOT_MAX_RANGES];
+    for (int i = 0; i < num_exclude; i++) {
+        assert((exclude[i].offset + exclude[i].size) <= system_size);
+        int j = i;
+        for (; (j > 0) && (sorted[j - 1].offset > exclude[i].offset); j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = exclude[i];
+    }
+    // merge adjacent and overlapping ranges
+    for (int i = 0; i < num_exclude; i++) {
+        if (sorted[i].size == 0) {
+            continue;
+        }
+        snapshot_range_t* last = (layout.num_ranges > 0) ? &layout.ranges[layout.num_ranges - 1] : 0;
+        if (last && (sorted[i].offset <= (last->offset + last->size))) {
+            const size_t end = sorted[i].offset + sorted[i].size;
+            if (end > (last->offset + last->size)) {
+                last->size = end - last->offset;
+            }
+        }
+        else {
+            layout.ranges[layout.num_ranges++] = sorted[i];
+        }
+    }
+    layout.packed_size = system_size;
+    for (int i = 0; i < layout.num_ranges; i++) {
+        layout.packed_size -= layout.ranges[i].size;
+    }
+    return layout;
+}
+
+size_t snapshot_pack(const snapshot_layout_t* layout, const void* sys, void* dst, size_t dst_size) {
+    assert(layout && sys && dst);
+    if (dst_size < layout->packed_size) {
+        return 0;
+    }
+    const uint8_t* src_ptr = (const uint8_t*)sys;
+    uint8_t* dst_ptr = (uint8_t*)dst;
+    size_t pos = 0;
+    for (int i = 0; i <= layout->num_ranges; i++) {
+        const size_t end = (i < layout->num_ranges) ? layout->ranges[i].offset : layout->system_size;
+        memcpy(dst_ptr, src_ptr + pos, end - pos);
+        dst_ptr += end - pos;
+        if (i < layout->num_ranges) {
+            pos = layout->ranges[i].offset + layout->ranges[i].size;
+        }
+    }
+    return layout->packed_size;
+}
+
+bool snapshot_unpack(const snapshot_layout_t* layout, const void* src, size_t src_size, void* sys) {
+    assert(layout && src && sys);
+    if (src_size != layout->packed_size) {
+        return false;
+    }
+    const uint8_t* src_ptr = (const uint8_t*)src;
+    uint8_t* dst_ptr = (uint8_t*)sys;
+    size_t pos = 0;
+    for (int i = 0; i <= layout->num_ranges; i++) {
+        const size_t end = (i < layout->num_ranges) ? layout->ranges[i].offset : layout->system_size;
+        memcpy(dst_ptr + pos, src_ptr, end - pos);
+        src_ptr += end - pos;
+        if (i < layout->num_ranges) {
+            pos = layout->ranges[i].offset + layout->ranges[i].size;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+/*
+    Compact system snapshots without regenerable and immutable state.
+
+    The emulated systems are plain structs which are snapshotted as a
+    whole, this includes the framebuffer (which is regenerated during the
+    next frame), the audio sample buffer, and the ROM images, which are
+    identical in all instances of a system.
+
+    A snapshot layout describes the byte ranges of a system struct which
+    are left out. snapshot_pack() copies everything else into a compact
+    buffer, and snapshot_unpack() writes it back over a system struct
+    which already holds the excluded state, usually a copy of the running
+    instance, so that ROMs are taken from the running instance.
+
+    Example:
+
+        static const snapshot_range_t exclude[] = {
+            SNAPSHOT_RANGE(c64_t, fb),
+            SNAPSHOT_RANGE(c64_t, rom_kernal),
+        };
+        snapshot_layout_t layout = snapshot_layout(sizeof(c64_t), exclude, 2);
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SNAPSHOT_MAX_RANGES (16)
+// describe a struct member as byte range, usable in static initializers
+#define SNAPSHOT_RANGE(type, member) { offsetof(type, member), sizeof(((type*)0)->member) }
+
+typedef struct {
+    size_t offset;
+    size_t size;
+} snapshot_range_t;
+
+typedef struct {
+    size_t system_size;     // size of the system struct
+    size_t packed_size;     // size of the packed snapshot
+    int num_ranges;         // sorted and merged excluded ranges
+    snapshot_range_t ranges[SNAPSHOT_MAX_RANGES];
+} snapshot_layout_t;
+
+// build a layout from a system struct size and a list of excluded ranges
+snapshot_layout_t snapshot_layout(size_t system_size, const snapshot_range_t* exclude, int num_exclude);
+// copy the included state of a system into dst, returns the packed size, or 0 if dst is too small
+size_t snapshot_pack(const snapshot_layout_t* layout, const void* sys, void* dst, size_t dst_size);
+// write a packed snapshot over a system struct, the excluded ranges are not touched
+bool snapshot_unpack(const snapshot_layout_t* layout, const void* src, size_t src_size, void* sys);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
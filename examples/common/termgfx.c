@@ -0,0 +1,381 @@
+#include "termgfx.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define TERMGFX_MAX_CELLS (TERMGFX_MAX_COLS * TERMGFX_MAX_ROWS)
+// worst case per cell: cursor position, fg+bg color and a 3-byte UTF-8 glyph
+#define TERMGFX_MAX_BYTES_PER_CELL (64)
+#define TERMGFX_NO_COLOR (0xFFFFFFFF)
+
+typedef struct {
+    bool valid;
+    bool full_redraw;
+    int term_cols;
+    int term_rows;
+    chips_dim_t pixel_aspect;
+    void (*write_cb)(const void* ptr, size_t num_bytes);
+    // current layout
+    chips_rect_t screen;
+    int cols;
+    int rows;
+    int src_x[TERMGFX_MAX_COLS + 1];        // source pixel column boundaries of each cell column
+    int src_y[TERMGFX_MAX_ROWS * 2 + 1];    // source pixel row boundaries of each half-cell row
+    // current terminal state (-1 and TERMGFX_NO_COLOR mean 'unknown')
+    int cur_x;
+    int cur_y;
+    uint32_t cur_fg;
+    uint32_t cur_bg;
+    termgfx_stats_t stats;
+    // downsampled pixels, 2 per cell, and the pixels sent in the previous frame
+    uint32_t pixels[TERMGFX_MAX_ROWS * 2][TERMGFX_MAX_COLS];
+    uint32_t prev_pixels[TERMGFX_MAX_ROWS * 2][TERMGFX_MAX_COLS];
+    uint32_t acc[TERMGFX_MAX_COLS][4];
+    // output buffer
+    size_t out_pos;
+    char out[TERMGFX_MAX_CELLS * TERMGFX_MAX_BYTES_PER_CELL];
+} termgfx_state_t;
+static termgfx_state_t state;
+
+static void _termgfx_put_str(const char* str) {
+    while (*str) {
+        state.out[state.out_pos++] = *str++;
+    }
+}
+
+static void _termgfx_put_int(int val) {
+    char buf[12];
+    int i = 0;
+    do {
+        buf[i++] = '0' + (val % 10);
+        val /= 10;
+    } while (val > 0);
+    while (i > 0) {
+        state.out[state.out_pos++] = buf[--i];
+    }
+}
+
+static void _termgfx_put_rgb(uint32_t c) {
+    _termgfx_put_int(c & 0xFF);
+    state.out[state.out_pos++] = ';';
+    _termgfx_put_int((c >> 8) & 0xFF);
+    state.out[state.out_pos++] = ';';
+    _termgfx_put_int((c >> 16) & 0xFF);
+}
+
+static void _termgfx_flush(void) {
+    if (state.out_pos > 0) {
+        if (state.write_cb) {
+            state.write_cb(state.out, state.out_pos);
+        }
+        else {
+            fwrite(state.out, 1, state.out_pos, stdout);
+            fflush(stdout);
+        }
+    }
+    state.stats.frame_bytes = state.out_pos;
+    state.stats.total_bytes += state.out_pos;
+    state.out_pos = 0;
+}
+
+void termgfx_init(const termgfx_desc_t* desc) {
+    assert(desc);
+    // the state is too big for a compound literal on the stack
+    memset(&state, 0, sizeof(state));
+    state.valid = true;
+    state.full_redraw = true;
+    state.pixel_aspect.width = (desc->pixel_aspect.width > 0) ? desc->pixel_aspect.width : 1;
+    state.pixel_aspect.height = (desc->pixel_aspect.height > 0) ? desc->pixel_aspect.height : 1;
+    state.write_cb = desc->write_cb;
+    termgfx_resize(desc->cols, desc->rows);
+    // hide cursor
+    _termgfx_put_str("\033[?25l");
+    _termgfx_flush();
+}
+
+void termgfx_shutdown(void) {
+    assert(state.valid);
+    // reset colors, show cursor and move it below the display
+    _termgfx_put_str("\033[0m\033[?25h\033[");
+    _termgfx_put_int(state.rows + 1);
+    _termgfx_put_str(";1H\n");
+    _termgfx_flush();
+    state.valid = false;
+}
+
+void termgfx_resize(int cols, int rows) {
+    assert(state.valid);
+    state.term_cols = (cols > 0) ? cols : 80;
+    state.term_rows = (rows > 0) ? rows : 24;
+    state.screen = (chips_rect_t){0};
+    termgfx_invalidate();
+}
+
+void termgfx_invalidate(void) {
+    assert(state.valid);
+    state.full_redraw = true;
+}
+
+termgfx_stats_t termgfx_stats(void) {
+    assert(state.valid);
+    return state.stats;
+}
+
+// compute the number of cells and the source pixel ranges covered by each cell,
+// keeping the display aspect ratio (a half-block is roughly square)
+static void _termgfx_layout(chips_rect_t screen) {
+    state.screen = screen;
+    const int aw = state.pixel_aspect.width;
+    const int ah = state.pixel_aspect.height;
+    const float disp_w = (float)(screen.width * aw);
+    const float disp_h = (float)(screen.height * ah);
+    int max_cols = state.term_cols;
+    int max_half_rows = 2 * state.term_rows;
+    if (max_cols > TERMGFX_MAX_COLS) {
+        max_cols = TERMGFX_MAX_COLS;
+    }
+    if (max_half_rows > (2 * TERMGFX_MAX_ROWS)) {
+        max_half_rows = 2 * TERMGFX_MAX_ROWS;
+    }
+    // display units per half-block, never upscale
+    float scale = disp_w / (float)max_cols;
+    if ((disp_h / (float)max_half_rows) > scale) {
+        scale = disp_h / (float)max_half_rows;
+    }
+    if (scale < (float)aw) {
+        scale = (float)aw;
+    }
+    if (scale < (float)ah) {
+        scale = (float)ah;
+    }
+    state.cols = (int)(disp_w / scale);
+    state.rows = (int)(disp_h / scale) / 2;
+    if (state.cols < 1) {
+        state.cols = 1;
+    }
+    if (state.rows < 1) {
+        state.rows = 1;
+    }
+    for (int i = 0; i <= state.cols; i++) {
+        state.src_x[i] = screen.x + (i * screen.width) / state.cols;
+    }
+    const int half_rows = state.rows * 2;
+    for (int i = 0; i <= half_rows; i++) {
+        state.src_y[i] = screen.y + (i * screen.height) / half_rows;
+    }
+    state.stats.cols = state.cols;
+    state.stats.rows = state.rows;
+}
+
+// box-filter the framebuffer into the cell pixel grid
+static void _termgfx_downsample(const chips_display_info_t* info) {
+    const int pitch = info->frame.dim.width;
+    const uint32_t* pal = (const uint32_t*) info->palette.ptr;
+    const uint8_t* fb8 = (const uint8_t*) info->frame.buffer.ptr;
+    const uint32_t* fb32 = (const uint32_t*) info->frame.buffer.ptr;
+    const bool paletted = info->frame.bytes_per_pixel == 1;
+    for (int hy = 0; hy < (state.rows * 2); hy++) {
+        memset(state.acc, 0, (size_t)state.cols * sizeof(state.acc[0]));
+        int y0 = state.src_y[hy];
+        int y1 = state.src_y[hy + 1];
+        if (y1 <= y0) {
+            y1 = y0 + 1;
+        }
+        for (int y = y0; y < y1; y++) {
+            for (int cx = 0; cx < state.cols; cx++) {
+                int x0 = state.src_x[cx];
+                int x1 = state.src_x[cx + 1];
+                if (x1 <= x0) {
+                    x1 = x0 + 1;
+                }
+                uint32_t* acc = state.acc[cx];
+                for (int x = x0; x < x1; x++) {
+                    const uint32_t c = paletted ? pal[fb8[y * pitch + x]] : fb32[y * pitch + x];
+                    acc[0] += c & 0xFF;
+                    acc[1] += (c >> 8) & 0xFF;
+                    acc[2] += (c >> 16) & 0xFF;
+                    acc[3] += 1;
+                }
+            }
+        }
+        uint32_t* dst = state.pixels[hy];
+        for (int cx = 0; cx < state.cols; cx++) {
+            const uint32_t* acc = state.acc[cx];
+            const uint32_t n = acc[3];
+            dst[cx] = (acc[0] / n) | ((acc[1] / n) << 8) | ((acc[2] / n) << 16);
+        }
+    }
+}
+
+static void _termgfx_fg(uint32_t c) {
+    _termgfx_put_str("\033[38;2;");
+    _termgfx_put_rgb(c);
+    state.out[state.out_pos++] = 'm';
+    state.cur_fg = c;
+}
+
+static void _termgfx_bg(uint32_t c) {
+    _termgfx_put_str("\033[48;2;");
+    _termgfx_put_rgb(c);
+    state.out[state.out_pos++] = 'm';
+    state.cur_bg = c;
+}
+
+static void _termgfx_fg_bg(uint32_t fg, uint32_t bg) {
+    _termgfx_put_str("\033[38;2;");
+    _termgfx_put_rgb(fg);
+    _termgfx_put_str(";48;2;");
+    _termgfx_put_rgb(bg);
+    state.out[state.out_pos++] = 'm';
+    state.cur_fg = fg;
+    state.cur_bg = bg;
+}
+
+// true if a cell can be drawn without a color change
+static bool _termgfx_cell_is_free(uint32_t top, uint32_t bottom) {
+    if (top == bottom) {
+        return (top == state.cur_bg) || (top == state.cur_fg);
+    }
+    else {
+        return ((top == state.cur_fg) && (bottom == state.cur_bg)) ||
+               ((top == state.cur_bg) && (bottom == state.cur_fg));
+    }
+}
+
+// draw a cell at the cursor position with the least number of color changes,
+// using ' ', '█', '▀' (top is foreground) or '▄' (bottom is foreground)
+static void _termgfx_cell(uint32_t top, uint32_t bottom) {
+    static const char* space = " ";
+    static const char* full_block = "\xE2\x96\x88";
+    static const char* upper_half = "\xE2\x96\x80";
+    static const char* lower_half = "\xE2\x96\x84";
+    const char* glyph;
+    if (top == bottom) {
+        if (top == state.cur_bg) {
+            glyph = space;
+        }
+        else if (top == state.cur_fg) {
+            glyph = full_block;
+        }
+        else {
+            _termgfx_bg(top);
+            glyph = space;
+        }
+    }
+    else if ((top == state.cur_fg) && (bottom == state.cur_bg)) {
+        glyph = upper_half;
+    }
+    else if ((top == state.cur_bg) && (bottom == state.cur_fg)) {
+        glyph = lower_half;
+    }
+    else if (top == state.cur_fg) {
+        _termgfx_bg(bottom);
+        glyph = upper_half;
+    }
+    else if (bottom == state.cur_fg) {
+        _termgfx_bg(top);
+        glyph = lower_half;
+    }
+    else if (top == state.cur_bg) {
+        _termgfx_fg(bottom);
+        glyph = lower_half;
+    }
+    else if (bottom == state.cur_bg) {
+        _termgfx_fg(top);
+        glyph = upper_half;
+    }
+    else {
+        _termgfx_fg_bg(top, bottom);
+        glyph = upper_half;
+    }
+    _termgfx_put_str(glyph);
+    state.cur_x++;
+}
+
+// move the cursor to a cell, re-sending short runs of unchanged cells
+// if that's cheaper than a cursor movement sequence
+static void _termgfx_move(int x, int y) {
+    if ((state.cur_y == y) && (state.cur_x == x)) {
+        return;
+    }
+    if ((state.cur_y == y) && (state.cur_x >= 0) && (x > state.cur_x)) {
+        const int gap = x - state.cur_x;
+        if (gap <= 2) {
+            bool all_free = true;
+            for (int cx = state.cur_x; cx < x; cx++) {
+                all_free &= _termgfx_cell_is_free(state.pixels[y * 2][cx], state.pixels[y * 2 + 1][cx]);
+            }
+            if (all_free) {
+                for (int cx = state.cur_x; cx < x; cx++) {
+                    _termgfx_cell(state.pixels[y * 2][cx], state.pixels[y * 2 + 1][cx]);
+                }
+                return;
+            }
+        }
+        _termgfx_put_str("\033[");
+        if (gap > 1) {
+            _termgfx_put_int(gap);
+        }
+        state.out[state.out_pos++] = 'C';
+    }
+    else {
+        state.out[state.out_pos++] = '\033';
+        state.out[state.out_pos++] = '[';
+        _termgfx_put_int(y + 1);
+        state.out[state.out_pos++] = ';';
+        _termgfx_put_int(x + 1);
+        state.out[state.out_pos++] = 'H';
+    }
+    state.cur_x = x;
+    state.cur_y = y;
+}
+
+void termgfx_draw(chips_display_info_t display_info) {
+    assert(state.valid);
+    assert(display_info.frame.buffer.ptr);
+    assert((display_info.frame.bytes_per_pixel == 1) || (display_info.frame.bytes_per_pixel == 4));
+    assert((display_info.frame.bytes_per_pixel == 4) || display_info.palette.ptr);
+    const chips_rect_t screen = display_info.screen;
+    if ((screen.x != state.screen.x) || (screen.y != state.screen.y) ||
+        (screen.width != state.screen.width) || (screen.height != state.screen.height))
+    {
+        _termgfx_layout(screen);
+        state.full_redraw = true;
+    }
+    const bool full_redraw = state.full_redraw;
+    if (full_redraw) {
+        state.full_redraw = false;
+        _termgfx_put_str("\033[0m\033[2J");
+        state.cur_x = state.cur_y = -1;
+        state.cur_fg = state.cur_bg = TERMGFX_NO_COLOR;
+    }
+    _termgfx_downsample(&display_info);
+    int changed_cells = 0;
+    for (int y = 0; y < state.rows; y++) {
+        const uint32_t* top = state.pixels[y * 2];
+        const uint32_t* bottom = state.pixels[y * 2 + 1];
+        const uint32_t* prev_top = state.prev_pixels[y * 2];
+        const uint32_t* prev_bottom = state.prev_pixels[y * 2 + 1];
+        for (int x = 0; x < state.cols; x++) {
+            if (!full_redraw && (top[x] == prev_top[x]) && (bottom[x] == prev_bottom[x])) {
+                continue;
+            }
+            _termgfx_move(x, y);
+            _termgfx_cell(top[x], bottom[x]);
+            changed_cells++;
+        }
+        // the cursor position after the last column is terminal specific
+        if (state.cur_x >= state.cols) {
+            state.cur_x = -1;
+            state.cur_y = -1;
+        }
+    }
+    for (int hy = 0; hy < (state.rows * 2); hy++) {
+        memcpy(state.prev_pixels[hy], state.pixels[hy], (size_t)state.cols * sizeof(uint32_t));
+    }
+    state.stats.changed_cells = changed_cells;
+    state.stats.frame_count++;
+    _termgfx_flush();
+}
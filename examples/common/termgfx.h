@@ -0,0 +1,62 @@
+#pragma once
+/*
+    Truecolor terminal renderer for the chips display info.
+
+    Downsamples the visible area of any system's framebuffer (paletted or
+    RGBA8) into Unicode half-block cells ('▀' with the top pixel as
+    foreground and the bottom pixel as background color) and writes
+    24-bit color escape sequences to stdout.
+
+    Only cells that changed since the previous frame are sent. Cursor
+    movement and color changes are only emitted when needed, so a mostly
+    static screen costs a few bytes per frame.
+
+    The output goes to stdout, or to an optional write callback (e.g.
+    termout_write() for non-blocking output, see termout.h). Each
+    termgfx_draw() call sends the difference to the previously drawn
+    frame, so skipping termgfx_draw() for a frame is always safe.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chips/chips_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TERMGFX_MAX_COLS (512)
+#define TERMGFX_MAX_ROWS (256)
+
+typedef struct {
+    int cols;                   // number of terminal columns available (default: 80)
+    int rows;                   // number of terminal rows available (default: 24)
+    chips_dim_t pixel_aspect;   // optional pixel aspect ratio, default is 1:1
+    void (*write_cb)(const void* ptr, size_t num_bytes);    // optional output function, default is stdout
+} termgfx_desc_t;
+
+typedef struct {
+    int cols;                   // number of terminal columns used for the display
+    int rows;                   // number of terminal rows used for the display
+    int changed_cells;          // number of cells sent in the last frame
+    size_t frame_bytes;         // number of bytes sent in the last frame
+    uint64_t total_bytes;       // number of bytes sent since termgfx_init()
+    uint32_t frame_count;       // number of frames drawn since termgfx_init()
+} termgfx_stats_t;
+
+// initialize the renderer, hides the cursor and clears the terminal
+void termgfx_init(const termgfx_desc_t* desc);
+// restore terminal colors and cursor
+void termgfx_shutdown(void);
+// update the terminal size (e.g. after a SIGWINCH), forces a full redraw
+void termgfx_resize(int cols, int rows);
+// force a full redraw in the next termgfx_draw()
+void termgfx_invalidate(void);
+// render a frame, sending only the changed cells
+void termgfx_draw(chips_display_info_t display_info);
+// get byte and cell statistics
+termgfx_stats_t termgfx_stats(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
@@ -0,0 +1,306 @@
+#include "termout.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <assert.h>
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#define TERMOUT_POSIX
+#endif
+
+#define TERMOUT_BUFFER_SIZE (8<<20)
+#define TERMOUT_DEFAULT_MAX_FRAME_TIME_US (100000)
+
+typedef struct {
+    bool valid;
+    bool in_frame;
+    int fd;
+    bool own_fd;
+    int orig_flags;
+    bool measure_only;
+    size_t max_backlog;
+    uint32_t max_frame_time_us;
+    uint64_t start_time_us;
+    uint64_t last_time_us;
+    uint64_t frame_begin_us;
+    uint64_t busy_until_us;
+    termout_stats_t stats;
+    // pending bytes are buf[pos..end]
+    size_t pos;
+    size_t end;
+    uint8_t buf[TERMOUT_BUFFER_SIZE];
+} termout_state_t;
+static termout_state_t state;
+
+#if defined(TERMOUT_POSIX)
+
+static uint64_t _termout_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// write as many bytes as the terminal accepts, returns the number of bytes written
+static size_t _termout_write_some(const uint8_t* ptr, size_t num_bytes) {
+    size_t written = 0;
+    while (written < num_bytes) {
+        const ssize_t res = write(state.fd, ptr + written, num_bytes - written);
+        if (res > 0) {
+            written += (size_t)res;
+            state.stats.bytes_written += (uint64_t)res;
+        }
+        else if ((res < 0) && (errno == EINTR)) {
+            continue;
+        }
+        else {
+            // EAGAIN: the terminal is busy, anything else: the output is gone, drop the bytes
+            if ((res < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                written = num_bytes;
+            }
+            break;
+        }
+    }
+    return written;
+}
+
+static void _termout_flush(void) {
+    if (state.pos < state.end) {
+        state.pos += _termout_write_some(&state.buf[state.pos], state.end - state.pos);
+    }
+    if (state.pos == state.end) {
+        state.pos = state.end = 0;
+    }
+}
+
+// block until all pending bytes are written
+static void _termout_drain(void) {
+    _termout_flush();
+    while (state.pos < state.end) {
+        struct pollfd pfd = { .fd = state.fd, .events = POLLOUT };
+        poll(&pfd, 1, 100);
+        _termout_flush();
+    }
+}
+
+// bytes written but not yet sent by the terminal
+static size_t _termout_output_queue(void) {
+    #if defined(TIOCOUTQ)
+    int queued = 0;
+    if ((ioctl(state.fd, TIOCOUTQ, &queued) == 0) && (queued > 0)) {
+        return (size_t)queued;
+    }
+    #endif
+    return 0;
+}
+
+// true if the terminal accepts more output without blocking
+static bool _termout_writable(void) {
+    struct pollfd pfd = { .fd = state.fd, .events = POLLOUT };
+    return (poll(&pfd, 1, 0) == 1) && (0 != (pfd.revents & POLLOUT));
+}
+
+void termout_init(const termout_desc_t* desc) {
+    assert(!state.valid);
+    assert(desc);
+    state.valid = true;
+    state.in_frame = false;
+    state.fd = (desc->fd > 0) ? desc->fd : STDOUT_FILENO;
+    state.own_fd = false;
+    state.orig_flags = -1;
+    state.measure_only = desc->measure_only;
+    state.max_backlog = desc->max_backlog;
+    state.max_frame_time_us = (desc->max_frame_time_us > 0) ? desc->max_frame_time_us : TERMOUT_DEFAULT_MAX_FRAME_TIME_US;
+    state.start_time_us = state.last_time_us = _termout_now_us();
+    state.frame_begin_us = state.busy_until_us = 0;
+    state.stats = (termout_stats_t){0};
+    state.pos = state.end = 0;
+    if (!state.measure_only) {
+        // anything buffered by stdio must go out before the non-blocking output
+        fflush(stdout);
+        // stdin and stdout usually share the terminal's open file description,
+        // so open the terminal again instead of making stdin non-blocking too
+        const char* tty_name = isatty(state.fd) ? ttyname(state.fd) : 0;
+        const int tty_fd = tty_name ? open(tty_name, O_WRONLY | O_NOCTTY | O_NONBLOCK) : -1;
+        if (tty_fd >= 0) {
+            state.fd = tty_fd;
+            state.own_fd = true;
+        }
+        else {
+            state.orig_flags = fcntl(state.fd, F_GETFL);
+            if (state.orig_flags != -1) {
+                fcntl(state.fd, F_SETFL, state.orig_flags | O_NONBLOCK);
+            }
+        }
+    }
+}
+
+void termout_shutdown(void) {
+    assert(state.valid);
+    if (!state.measure_only) {
+        _termout_drain();
+        if (state.own_fd) {
+            close(state.fd);
+        }
+        else if (state.orig_flags != -1) {
+            fcntl(state.fd, F_SETFL, state.orig_flags);
+        }
+    }
+    state.valid = false;
+}
+
+uint32_t termout_frame_time(void) {
+    assert(state.valid);
+    const uint64_t now = _termout_now_us();
+    uint64_t frame_time_us = now - state.last_time_us;
+    state.last_time_us = now;
+    // prevent a death-spiral if the host is too slow to emulate in real time
+    if (frame_time_us > state.max_frame_time_us) {
+        frame_time_us = state.max_frame_time_us;
+    }
+    state.stats.emu_time_us += frame_time_us;
+    return (uint32_t)frame_time_us;
+}
+
+size_t termout_backlog(void) {
+    assert(state.valid);
+    return (state.end - state.pos) + _termout_output_queue();
+}
+
+bool termout_begin_frame(void) {
+    assert(state.valid && !state.in_frame);
+    if (!state.measure_only) {
+        _termout_flush();
+    }
+    const uint64_t now = _termout_now_us();
+    const size_t backlog = termout_backlog();
+    if (backlog > state.stats.max_backlog) {
+        state.stats.max_backlog = backlog;
+    }
+    state.stats.frames++;
+    if ((backlog > state.max_backlog) || (now < state.busy_until_us) || !_termout_writable()) {
+        state.stats.frames_dropped++;
+        return false;
+    }
+    state.in_frame = true;
+    state.frame_begin_us = now;
+    return true;
+}
+
+void termout_end_frame(void) {
+    assert(state.valid && state.in_frame);
+    state.in_frame = false;
+    state.stats.frames_written++;
+    if (state.measure_only) {
+        // the output blocked for this long, skip frames for the same time so
+        // that blocking output takes at most half of the wall clock time
+        const uint64_t now = _termout_now_us();
+        state.busy_until_us = now + (now - state.frame_begin_us);
+    }
+}
+
+void termout_write(const void* ptr, size_t num_bytes) {
+    assert(state.valid && !state.measure_only);
+    assert(ptr || (num_bytes == 0));
+    const uint8_t* src = (const uint8_t*)ptr;
+    if (state.pos == state.end) {
+        const size_t written = _termout_write_some(src, num_bytes);
+        src += written;
+        num_bytes -= written;
+    }
+    while (num_bytes > 0) {
+        if (state.end == TERMOUT_BUFFER_SIZE) {
+            // the pending buffer is full, this can only block if a single
+            // frame is larger than the pending buffer
+            _termout_drain();
+        }
+        size_t n = TERMOUT_BUFFER_SIZE - state.end;
+        if (n > num_bytes) {
+            n = num_bytes;
+        }
+        memcpy(&state.buf[state.end], src, n);
+        state.end += n;
+        src += n;
+        num_bytes -= n;
+    }
+}
+
+void termout_printf(const char* fmt, ...) {
+    char str[256];
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(str, sizeof(str), fmt, args);
+    va_end(args);
+    assert((len >= 0) && (len < (int)sizeof(str)));
+    termout_write(str, (size_t)len);
+}
+
+void termout_wait(uint32_t frame_time_us) {
+    assert(state.valid);
+    const uint64_t due = state.last_time_us + frame_time_us;
+    // pending bytes are pushed out even if the frame is already due
+    if (!state.measure_only) {
+        _termout_flush();
+    }
+    uint64_t now;
+    while ((now = _termout_now_us()) < due) {
+        const uint64_t remaining_us = due - now;
+        if (!state.measure_only && (state.pos < state.end)) {
+            // round up, so that the last millisecond isn't busy-polled
+            struct pollfd pfd = { .fd = state.fd, .events = POLLOUT };
+            poll(&pfd, 1, (int)((remaining_us + 999) / 1000));
+            _termout_flush();
+        }
+        else {
+            const struct timespec ts = {
+                .tv_sec = (time_t)(remaining_us / 1000000),
+                .tv_nsec = (long)(remaining_us % 1000000) * 1000,
+            };
+            nanosleep(&ts, 0);
+        }
+    }
+}
+
+termout_stats_t termout_stats(void) {
+    assert(state.valid);
+    termout_stats_t stats = state.stats;
+    stats.backlog = termout_backlog();
+    stats.wall_time_us = _termout_now_us() - state.start_time_us;
+    return stats;
+}
+
+#else
+
+// no non-blocking output on this platform, write blocking to stdout,
+// and run the emulation at a fixed 60Hz frame time
+void termout_init(const termout_desc_t* desc) { (void)desc; state.valid = true; }
+void termout_shutdown(void) { fflush(stdout); state.valid = false; }
+uint32_t termout_frame_time(void) { state.stats.emu_time_us += 16667; return 16667; }
+bool termout_begin_frame(void) { state.stats.frames++; state.stats.frames_written++; return true; }
+void termout_end_frame(void) { fflush(stdout); }
+void termout_write(const void* ptr, size_t num_bytes) { state.stats.bytes_written += fwrite(ptr, 1, num_bytes, stdout); }
+void termout_printf(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
+void termout_wait(uint32_t frame_time_us) { (void)frame_time_us; }
+size_t termout_backlog(void) { return 0; }
+termout_stats_t termout_stats(void) { return state.stats; }
+
+#endif
+
+void termout_print_stats(const termout_stats_t* stats) {
+    assert(stats);
+    if (stats->wall_time_us > 0) {
+        printf("emulation speed %.1f%%, output %.1f fps (%u of %u frames dropped, max backlog %zu bytes)\n",
+            100.0 * (double)stats->emu_time_us / (double)stats->wall_time_us,
+            stats->frames_written * 1000000.0 / (double)stats->wall_time_us,
+            stats->frames_dropped, stats->frames, stats->max_backlog);
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+/*
+    Non-blocking terminal output with backpressure (for the terminal frontends).
+
+    Frame output is written to the (non-blocking) terminal as far as the
+    terminal accepts it, the rest is kept in a pending buffer and pushed
+    out by later termout calls, so a slow terminal or SSH link never stalls
+    the emulation.
+
+    The backlog is the number of pending bytes, plus the bytes still in the
+    terminal's output queue. Before rendering a frame, the frontend calls
+    termout_begin_frame(), which returns false while the backlog is above
+    the limit, or the terminal doesn't accept more output. The frontend
+    then skips rendering, the terminal gets the latest frame once it has
+    caught up (skipped frames are merged into the next rendered frame,
+    since only complete frames are ever queued).
+
+    The emulation runs on fixed time: termout_frame_time() returns the
+    wall clock time since its previous call, which is independent of the
+    terminal throughput, and termout_wait() sleeps until the next frame
+    is due while pushing out pending bytes.
+
+    If the output is a terminal, it is opened a second time for the
+    non-blocking output, so that stdin (which usually shares the open file
+    description with stdout) stays blocking.
+
+    With measure_only, termout doesn't write anything itself (e.g. when
+    curses owns the output, which is always blocking). Frames are skipped
+    while the terminal doesn't accept more output, and for as long as the
+    previous frame blocked, so blocking output takes at most half the wall
+    clock time and the emulation catches up with termout_frame_time().
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int fd;                         // output file descriptor (default: stdout)
+    bool measure_only;              // don't write, only check whether the terminal accepts more output
+    size_t max_backlog;             // don't render a frame while more bytes are pending (default: 0)
+    uint32_t max_frame_time_us;     // clamp for termout_frame_time() (default: 100000)
+} termout_desc_t;
+
+typedef struct {
+    uint32_t frames;                // number of termout_begin_frame() calls
+    uint32_t frames_written;        // number of frames sent to the terminal
+    uint32_t frames_dropped;        // number of frames skipped because the terminal was lagging
+    uint64_t bytes_written;         // number of bytes accepted by the terminal
+    size_t backlog;                 // current backlog in bytes
+    size_t max_backlog;             // largest backlog seen in termout_begin_frame()
+    uint64_t emu_time_us;           // sum of termout_frame_time() results
+    uint64_t wall_time_us;          // wall clock time since termout_init()
+} termout_stats_t;
+
+// switch the output to non-blocking
+void termout_init(const termout_desc_t* desc);
+// write all pending bytes (blocking) and restore the output flags
+void termout_shutdown(void);
+// get the wall clock time since the previous call (or termout_init()), clamped
+uint32_t termout_frame_time(void);
+// push out pending bytes, returns false if the terminal is lagging and the frame should be skipped
+bool termout_begin_frame(void);
+// finish a frame started with termout_begin_frame()
+void termout_end_frame(void);
+// write bytes, never blocks unless the pending buffer is full
+void termout_write(const void* ptr, size_t num_bytes);
+// write a formatted string (for short escape sequences)
+void termout_printf(const char* fmt, ...);
+// sleep until frame_time_us after the last termout_frame_time() call, pushing out pending bytes
+void termout_wait(uint32_t frame_time_us);
+// get the current backlog in bytes
+size_t termout_backlog(void);
+// get frame, byte and timing statistics
+termout_stats_t termout_stats(void);
+// print emulation speed, output frame rate and dropped frames (after termout_shutdown() and endwin())
+void termout_print_stats(const termout_stats_t* stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
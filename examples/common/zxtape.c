@@ -0,0 +1,268 @@
+#include "zxtape.h"
+#include <string.h>
+#include <assert.h>
+
+#define ZXTAPE_TZX_HEADER_SIZE (10)
+
+typedef struct {
+    uint8_t id;         // TZX block id, or 0x10 for TAP blocks
+    bool has_data;      // true if the block can be loaded through LD-BYTES
+    uint32_t offset;    // offset of the data bytes
+    uint32_t size;      // number of data bytes
+} zxtape_block_t;
+
+typedef struct {
+    bool valid;
+    zxtape_format_t format;
+    int num_blocks;
+    int num_data_blocks;
+    int cur_block;
+    uint32_t size;
+    zxtape_block_t blocks[ZXTAPE_MAX_BLOCKS];
+    uint8_t buf[ZXTAPE_MAX_SIZE];
+} zxtape_state_t;
+static zxtape_state_t state;
+
+static const uint8_t _zxtape_tzx_sig[8] = { 'Z', 'X', 'T', 'a', 'p', 'e', '!', 0x1A };
+
+static uint32_t _zxtape_u16(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t _zxtape_u24(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+}
+
+static uint32_t _zxtape_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool _zxtape_add_block(uint8_t id, bool has_data, uint32_t offset, uint32_t size) {
+    if ((state.num_blocks >= ZXTAPE_MAX_BLOCKS) || ((offset + size) > state.size)) {
+        return false;
+    }
+    state.blocks[state.num_blocks++] = (zxtape_block_t){
+        .id = id,
+        .has_data = has_data,
+        .offset = offset,
+        .size = size,
+    };
+    if (has_data) {
+        state.num_data_blocks++;
+    }
+    return true;
+}
+
+// a TAP file is a sequence of 16-bit length prefixed blocks
+static bool _zxtape_parse_tap(void) {
+    uint32_t pos = 0;
+    while ((pos + 2) <= state.size) {
+        const uint32_t len = _zxtape_u16(&state.buf[pos]);
+        if (!_zxtape_add_block(0x10, len > 0, pos + 2, len)) {
+            return false;
+        }
+        pos += 2 + len;
+    }
+    return pos == state.size;
+}
+
+// parse TZX blocks, see https://worldofspectrum.net/TZXformat.html
+static bool _zxtape_parse_tzx(void) {
+    uint32_t pos = ZXTAPE_TZX_HEADER_SIZE;
+    while (pos < state.size) {
+        const uint8_t id = state.buf[pos++];
+        const uint8_t* p = &state.buf[pos];
+        const uint32_t remaining = state.size - pos;
+        // size of the fixed block header, and of the variable part after it
+        uint32_t head = 0;
+        uint32_t body = 0;
+        bool has_data = false;
+        // make sure the fixed-size part of each block can be read
+        #define _ZXTAPE_NEED(n) if (remaining < (n)) { return false; }
+        switch (id) {
+            case 0x10:  // standard speed data
+                _ZXTAPE_NEED(4); head = 4; body = _zxtape_u16(p + 2); has_data = true; break;
+            case 0x11:  // turbo speed data
+                _ZXTAPE_NEED(18); head = 18; body = _zxtape_u24(p + 15); has_data = true; break;
+            case 0x12:  // pure tone
+                head = 4; break;
+            case 0x13:  // pulse sequence
+                _ZXTAPE_NEED(1); head = 1; body = 2 * (uint32_t)p[0]; break;
+            case 0x14:  // pure data
+                _ZXTAPE_NEED(10); head = 10; body = _zxtape_u24(p + 7); has_data = true; break;
+            case 0x15:  // direct recording
+                _ZXTAPE_NEED(8); head = 8; body = _zxtape_u24(p + 5); break;
+            case 0x18:  // CSW recording
+            case 0x19:  // generalized data
+                _ZXTAPE_NEED(4); head = 4; body = _zxtape_u32(p); break;
+            case 0x20:  // pause / stop the tape
+            case 0x23:  // jump to block
+            case 0x24:  // loop start
+                head = 2; break;
+            case 0x21:  // group start
+            case 0x30:  // text description
+                _ZXTAPE_NEED(1); head = 1; body = p[0]; break;
+            case 0x22:  // group end
+            case 0x25:  // loop end
+            case 0x27:  // return from sequence
+                break;
+            case 0x26:  // call sequence
+                _ZXTAPE_NEED(2); head = 2; body = 2 * _zxtape_u16(p); break;
+            case 0x28:  // select block
+            case 0x32:  // archive info
+                _ZXTAPE_NEED(2); head = 2; body = _zxtape_u16(p); break;
+            case 0x2A:  // stop the tape if in 48K mode
+                head = 4; break;
+            case 0x2B:  // set signal level
+                head = 5; break;
+            case 0x31:  // message block
+                _ZXTAPE_NEED(2); head = 2; body = p[1]; break;
+            case 0x33:  // hardware type
+                _ZXTAPE_NEED(1); head = 1; body = 3 * (uint32_t)p[0]; break;
+            case 0x35:  // custom info
+                _ZXTAPE_NEED(20); head = 20; body = _zxtape_u32(p + 16); break;
+            case 0x5A:  // glue block
+                head = 9; break;
+            default:
+                // unknown blocks start with a 32-bit length
+                _ZXTAPE_NEED(4); head = 4; body = _zxtape_u32(p); break;
+        }
+        #undef _ZXTAPE_NEED
+        if ((head > remaining) || (body > (remaining - head))) {
+            return false;
+        }
+        if (!_zxtape_add_block(id, has_data && (body > 0), pos + head, body)) {
+            return false;
+        }
+        pos += head + body;
+    }
+    return true;
+}
+
+void zxtape_init(void) {
+    memset(&state, 0, sizeof(state));
+    state.valid = true;
+}
+
+bool zxtape_is_tzx(chips_range_t data) {
+    assert(data.ptr);
+    return (data.size >= ZXTAPE_TZX_HEADER_SIZE) && (0 == memcmp(data.ptr, _zxtape_tzx_sig, sizeof(_zxtape_tzx_sig)));
+}
+
+bool zxtape_insert(chips_range_t data) {
+    assert(state.valid);
+    assert(data.ptr);
+    zxtape_eject();
+    if ((data.size == 0) || (data.size > ZXTAPE_MAX_SIZE)) {
+        return false;
+    }
+    memcpy(state.buf, data.ptr, data.size);
+    state.size = (uint32_t)data.size;
+    bool success;
+    if (zxtape_is_tzx(data)) {
+        state.format = ZXTAPE_FORMAT_TZX;
+        success = _zxtape_parse_tzx();
+    }
+    else {
+        state.format = ZXTAPE_FORMAT_TAP;
+        success = _zxtape_parse_tap();
+    }
+    if (!success || (state.num_data_blocks == 0)) {
+        zxtape_eject();
+        return false;
+    }
+    return true;
+}
+
+void zxtape_eject(void) {
+    assert(state.valid);
+    state.format = ZXTAPE_FORMAT_NONE;
+    state.num_blocks = 0;
+    state.num_data_blocks = 0;
+    state.cur_block = 0;
+    state.size = 0;
+}
+
+void zxtape_rewind(void) {
+    assert(state.valid);
+    state.cur_block = 0;
+}
+
+bool zxtape_inserted(void) {
+    assert(state.valid);
+    return state.format != ZXTAPE_FORMAT_NONE;
+}
+
+bool zxtape_has_data(void) {
+    assert(state.valid);
+    for (int i = state.cur_block; i < state.num_blocks; i++) {
+        if (state.blocks[i].has_data) {
+            return true;
+        }
+    }
+    return false;
+}
+
+zxtape_ld_bytes_result_t zxtape_ld_bytes(const zxtape_ld_bytes_t* req) {
+    assert(state.valid);
+    assert(req && req->read_cb && req->write_cb);
+    zxtape_ld_bytes_result_t res = {
+        .success = false,
+        .parity = 0xFF,
+        .addr = req->addr,
+        .len = req->len,
+    };
+    // skip to the next data block
+    const zxtape_block_t* blk = 0;
+    while (state.cur_block < state.num_blocks) {
+        const zxtape_block_t* b = &state.blocks[state.cur_block++];
+        if (b->has_data) {
+            blk = b;
+            break;
+        }
+    }
+    if (0 == blk) {
+        return res;
+    }
+    // the first byte is the flag byte (0x00 for headers, 0xFF for data), the
+    // last byte is the checksum (all bytes XORed together must be zero), a
+    // flag mismatch makes the ROM skip the block
+    const uint8_t* data = &state.buf[blk->offset];
+    if (data[0] != req->flag) {
+        return res;
+    }
+    uint8_t parity = data[0];
+    uint32_t pos = 1;
+    while ((res.len > 0) && (pos < blk->size)) {
+        const uint8_t val = data[pos++];
+        parity ^= val;
+        if (req->verify) {
+            if (req->read_cb(res.addr, req->user_data) != val) {
+                return res;
+            }
+        }
+        else {
+            req->write_cb(res.addr, val, req->user_data);
+        }
+        res.addr++;
+        res.len--;
+    }
+    // block too short, or no checksum byte
+    if ((res.len > 0) || (pos >= blk->size)) {
+        return res;
+    }
+    parity ^= data[pos];
+    res.parity = parity;
+    res.success = (parity == 0);
+    return res;
+}
+
+zxtape_status_t zxtape_status(void) {
+    assert(state.valid);
+    return (zxtape_status_t){
+        .format = state.format,
+        .num_blocks = state.num_blocks,
+        .num_data_blocks = state.num_data_blocks,
+        .cur_block = state.cur_block,
+    };
+}
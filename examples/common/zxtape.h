@@ -0,0 +1,87 @@
+#pragma once
+/*
+    ZX Spectrum tape images (.tap and .tzx) for ROM-trap fast loading.
+
+    The tape image is parsed into a list of blocks. Blocks which carry
+    ROM-loader compatible data (TAP blocks and the TZX standard speed,
+    turbo speed and pure data blocks) are handed out one after another by
+    zxtape_ld_bytes(), which performs the work of the ROM LD-BYTES routine
+    at 0x0556 in a single step (flag byte check, copying to memory or
+    verifying, checksum check). The emulator detects the LD-BYTES call,
+    calls zxtape_ld_bytes() with the CPU registers and simulates a RET.
+
+    Other TZX blocks (pauses, pulse sequences, groups, text and archive
+    info, ...) are skipped.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chips/chips_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ZXTAPE_MAX_SIZE (1024 * 1024)
+#define ZXTAPE_MAX_BLOCKS (2048)
+// address of the LD-BYTES routine in the 48K ROM
+#define ZXTAPE_LD_BYTES_ADDR (0x0556)
+
+typedef enum {
+    ZXTAPE_FORMAT_NONE,
+    ZXTAPE_FORMAT_TAP,
+    ZXTAPE_FORMAT_TZX,
+} zxtape_format_t;
+
+// memory access callbacks
+typedef uint8_t (*zxtape_read_t)(uint16_t addr, void* user_data);
+typedef void (*zxtape_write_t)(uint16_t addr, uint8_t data, void* user_data);
+
+// LD-BYTES inputs, taken from the CPU registers at 0x0556
+typedef struct {
+    uint8_t flag;           // expected flag byte (A)
+    bool verify;            // true for VERIFY, false for LOAD (carry flag clear/set)
+    uint16_t addr;          // start address (IX)
+    uint16_t len;           // number of bytes (DE)
+    zxtape_read_t read_cb;
+    zxtape_write_t write_cb;
+    void* user_data;
+} zxtape_ld_bytes_t;
+
+// LD-BYTES outputs, to be written back into the CPU registers
+typedef struct {
+    bool success;           // carry flag
+    uint8_t parity;         // A (0 on success)
+    uint16_t addr;          // IX
+    uint16_t len;           // DE
+} zxtape_ld_bytes_result_t;
+
+typedef struct {
+    zxtape_format_t format;
+    int num_blocks;         // number of blocks in the tape image
+    int num_data_blocks;    // number of ROM-loadable data blocks
+    int cur_block;          // index of the next block
+} zxtape_status_t;
+
+// initialize the tape module (no tape inserted)
+void zxtape_init(void);
+// check if data looks like a TZX image (TAP has no signature)
+bool zxtape_is_tzx(chips_range_t data);
+// insert a .tap or .tzx image (the data is copied)
+bool zxtape_insert(chips_range_t data);
+// remove the tape
+void zxtape_eject(void);
+// rewind to the first block
+void zxtape_rewind(void);
+// return true if a tape is inserted
+bool zxtape_inserted(void);
+// return true if a tape is inserted and has more data blocks
+bool zxtape_has_data(void);
+// perform the ROM LD-BYTES routine on the next data block
+zxtape_ld_bytes_result_t zxtape_ld_bytes(const zxtape_ld_bytes_t* req);
+// get the current tape status
+zxtape_status_t zxtape_status(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
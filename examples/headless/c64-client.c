@@ -0,0 +1,226 @@
+//------------------------------------------------------------------------------
+//  c64-client.c
+//
+//  Test client for the C64 session server (see c64-server.c). Connects to
+//  the server, decodes the frame deltas, and periodically presses a key.
+//  Reports the received frame rate, the bandwidth (compared to sending
+//  raw palette-indexed or RGB frames), and the end-to-end input latency,
+//  from sending a key press to receiving the first frame which was
+//  emulated after the key press arrived.
+//
+//  Command line args:
+//
+//  socket=[path]       socket path (default: /tmp/c64-server.sock)
+//  seconds=[num]       run time (default: 10)
+//  interval=[ms]       time between key presses (default: 200)
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "framedelta.h"
+#include "session.h"
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#define SOKOL_ARGS_IMPL
+#include "sokol_args.h"
+
+#define DEFAULT_SOCKET_PATH "/tmp/c64-server.sock"
+#define MAX_FRAME_SIZE (1<<20)
+#define IN_BUFFER_SIZE (SESSION_HEADER_SIZE + SESSION_MAX_PAYLOAD)
+#define KEY_HOLD_US (60000)
+
+static struct {
+    int fd;
+    int width;
+    int height;
+    uint32_t sample_rate;
+    bool have_hello;
+    bool have_keyframe;
+    uint8_t frame[MAX_FRAME_SIZE];
+    size_t in_len;
+    uint8_t in[IN_BUFFER_SIZE];
+    // input sent, and waiting for the frame which reflects it
+    uint32_t input_seq;
+    uint32_t pending_seq;
+    uint64_t pending_time;
+    // statistics
+    uint32_t frames;
+    uint32_t frames_lost;
+    uint32_t last_frame;
+    uint32_t decode_errors;
+    uint64_t video_bytes;
+    uint64_t audio_bytes;
+    uint64_t audio_samples;
+    uint32_t num_latencies;
+    double latency_ms;
+    double max_latency_ms;
+} state;
+
+static int connect_socket(const char* path) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        close(fd);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool send_input(uint8_t type, uint8_t value) {
+    uint8_t msg[SESSION_HEADER_SIZE + 6];
+    session_put_header(msg, SESSION_MSG_INPUT, 6);
+    session_put_u32(&msg[SESSION_HEADER_SIZE], ++state.input_seq);
+    msg[SESSION_HEADER_SIZE + 4] = type;
+    msg[SESSION_HEADER_SIZE + 5] = value;
+    return send(state.fd, msg, sizeof(msg), 0) == (ssize_t)sizeof(msg);
+}
+
+static void handle_message(uint8_t type, const uint8_t* payload, uint32_t size) {
+    switch (type) {
+        case SESSION_MSG_HELLO:
+            if (size >= 12) {
+                state.width = (int)session_get_u16(payload);
+                state.height = (int)session_get_u16(payload + 2);
+                state.sample_rate = session_get_u32(payload + 4);
+                state.have_hello = ((size_t)(state.width * state.height) <= MAX_FRAME_SIZE);
+                printf("== connected: %dx%d, %u colors, %u Hz\n", state.width, state.height, session_get_u32(payload + 8), state.sample_rate);
+            }
+            break;
+        case SESSION_MSG_FRAME:
+            if (state.have_hello && (size >= 8)) {
+                const uint32_t frame = session_get_u32(payload);
+                const uint32_t input_seq = session_get_u32(payload + 4);
+                if (framedelta_decode(payload + 8, size - 8, state.frame, state.width, state.height)) {
+                    state.have_keyframe = true;
+                }
+                else {
+                    state.decode_errors++;
+                }
+                if (state.frames > 0) {
+                    state.frames_lost += frame - state.last_frame - 1;
+                }
+                state.last_frame = frame;
+                state.frames++;
+                state.video_bytes += SESSION_HEADER_SIZE + size;
+                if (state.pending_seq && (input_seq >= state.pending_seq)) {
+                    const double ms = stm_ms(stm_since(state.pending_time));
+                    state.latency_ms += ms;
+                    state.num_latencies++;
+                    if (ms > state.max_latency_ms) {
+                        state.max_latency_ms = ms;
+                    }
+                    state.pending_seq = 0;
+                }
+            }
+            break;
+        case SESSION_MSG_AUDIO:
+            state.audio_bytes += SESSION_HEADER_SIZE + size;
+            state.audio_samples += size / 2;
+            break;
+        default:
+            break;
+    }
+}
+
+// receive and handle all complete messages, returns false if the connection was closed
+static bool receive(void) {
+    const ssize_t res = recv(state.fd, state.in + state.in_len, IN_BUFFER_SIZE - state.in_len, 0);
+    if (res <= 0) {
+        return (res < 0) && (errno == EINTR);
+    }
+    state.in_len += (size_t)res;
+    size_t pos = 0;
+    while ((state.in_len - pos) >= SESSION_HEADER_SIZE) {
+        const uint8_t* msg = &state.in[pos];
+        const uint32_t size = session_get_u32(&msg[4]);
+        if (size > SESSION_MAX_PAYLOAD) {
+            return false;
+        }
+        if ((state.in_len - pos) < (SESSION_HEADER_SIZE + size)) {
+            break;
+        }
+        handle_message(msg[0], msg + SESSION_HEADER_SIZE, size);
+        pos += SESSION_HEADER_SIZE + size;
+    }
+    state.in_len -= pos;
+    memmove(state.in, state.in + pos, state.in_len);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    sargs_setup(&(sargs_desc){ .argc=argc, .argv=argv });
+    stm_setup();
+    const char* path = sargs_value_def("socket", DEFAULT_SOCKET_PATH);
+    const double seconds = atof(sargs_value_def("seconds", "10"));
+    const double interval_us = atof(sargs_value_def("interval", "200")) * 1000.0;
+    state.fd = connect_socket(path);
+    if (state.fd < 0) {
+        printf("!! FAILED: can't connect to '%s'\n", path);
+        return 10;
+    }
+
+    // press and release keys A..Z, one key at a time
+    const uint64_t start_time = stm_now();
+    double next_key_us = interval_us;
+    double key_up_us = 0.0;
+    uint8_t key = 0;
+    bool connected = true;
+    while (connected && (stm_sec(stm_since(start_time)) < seconds)) {
+        struct pollfd pfd = { .fd = state.fd, .events = POLLIN };
+        if (poll(&pfd, 1, 1) > 0) {
+            connected = receive();
+        }
+        const double t = stm_us(stm_since(start_time));
+        if (key && (t >= key_up_us)) {
+            connected = connected && send_input(SESSION_INPUT_KEY_UP, key);
+            key = 0;
+        }
+        if (state.have_keyframe && !key && (t >= next_key_us)) {
+            key = (uint8_t)('A' + (state.input_seq / 2) % 26);
+            connected = connected && send_input(SESSION_INPUT_KEY_DOWN, key);
+            // only measure if the previous measurement is done
+            if (!state.pending_seq) {
+                state.pending_seq = state.input_seq;
+                state.pending_time = stm_now();
+            }
+            key_up_us = t + KEY_HOLD_US;
+            next_key_us = t + interval_us;
+        }
+    }
+    const double elapsed = stm_sec(stm_since(start_time));
+    close(state.fd);
+    if (state.frames == 0) {
+        printf("!! FAILED: no frames received\n");
+        return 10;
+    }
+    const double raw_indexed = (double)state.width * state.height;
+    const double video_per_frame = (double)state.video_bytes / state.frames;
+    printf("== %u frames in %.2f s (%.1f fps), %u lost or skipped by the server, %u decode errors\n",
+        state.frames, elapsed, state.frames / elapsed, state.frames_lost, state.decode_errors);
+    printf("== video: %.1f KB/s, %.0f bytes/frame (%.1f%% of raw indexed, %.2f%% of raw RGB)\n",
+        state.video_bytes / 1024.0 / elapsed, video_per_frame,
+        100.0 * video_per_frame / raw_indexed, 100.0 * video_per_frame / (raw_indexed * 3.0));
+    printf("== audio: %.1f KB/s, %.0f samples/s\n", state.audio_bytes / 1024.0 / elapsed, state.audio_samples / elapsed);
+    printf("== input latency: avg %.2f ms, max %.2f ms (%u key presses)\n",
+        state.num_latencies ? (state.latency_ms / state.num_latencies) : 0.0, state.max_latency_ms, state.num_latencies);
+    sargs_shutdown();
+    return (state.decode_errors == 0) ? 0 : 10;
+}
@@ -0,0 +1,341 @@
+//------------------------------------------------------------------------------
+//  c64-forkserver.c
+//
+//  Headless C64 fork-server. The C64 is initialized and booted once to the
+//  BASIC READY prompt, after that each connection on a local (Unix domain)
+//  socket fork()s a child process which inherits the booted machine as
+//  copy-on-write memory, so that a new session costs a fork() instead of
+//  a process start and a ROM boot.
+//
+//  Each child reports its spawn latency (from accepting the connection to
+//  the child being ready), and the memory it has actually dirtied (private
+//  dirty memory on Linux, and the number of minor page faults, which are
+//  mostly copy-on-write faults).
+//
+//  Session protocol, one command per line, one response line per command:
+//
+//  run [frames]        run the emulator for a number of 50Hz frames
+//  type [text]         type text followed by Return (fed during 'run')
+//  peek [addr] [len]   read memory, response is a hex string
+//  stats               frames, dirty memory and page faults
+//  quit                end the session
+//
+//  Command line args:
+//
+//  socket=[path]   socket path (default: /tmp/c64-forkserver.sock)
+//  bench=[num]     spawn num sessions over socket pairs, run one second of
+//                  emulation in each and report spawn latency and dirty
+//                  memory, instead of listening on the socket
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "keybuf.h"
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#define SOKOL_ARGS_IMPL
+#include "sokol_args.h"
+#define CHIPS_IMPL
+#include "chips/chips_common.h"
+#include "chips/m6502.h"
+#include "chips/m6526.h"
+#include "chips/m6569.h"
+#include "chips/m6581.h"
+#include "chips/beeper.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/clk.h"
+#include "systems/c1530.h"
+#include "chips/m6522.h"
+#include "systems/c1541.h"
+#include "systems/c64.h"
+#include "c64-roms.h"
+
+#define FRAME_USEC (20000)
+#define MAX_BOOT_FRAMES (250)
+#define DEFAULT_SOCKET_PATH "/tmp/c64-forkserver.sock"
+#define LINE_SIZE (1024)
+#define MAX_PEEK (256)
+#define BENCH_FRAMES (50)
+
+static struct {
+    c64_t c64;
+    uint32_t boot_frames;
+    // session state (in the child process)
+    struct {
+        uint32_t frames;
+        long minflt_at_fork;
+    } session;
+} state;
+
+typedef struct {
+    double spawn_us;
+    long dirty_kb;
+    long minflt;
+} session_stats_t;
+
+// check for "READY." in the C64 screen memory (as screen codes)
+static bool c64_ready(void) {
+    static const uint8_t ready[6] = { 0x12, 0x05, 0x01, 0x04, 0x19, 0x2E };
+    for (uint16_t addr = 0x0400; addr < (0x0400 + 1000 - 6); addr++) {
+        bool match = true;
+        for (int i = 0; match && (i < 6); i++) {
+            match = mem_rd(&state.c64.mem_cpu, addr + i) == ready[i];
+        }
+        if (match) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void c64_frame(void) {
+    uint8_t key_code;
+    if (0 != (key_code = keybuf_get(FRAME_USEC))) {
+        c64_key_down(&state.c64, key_code);
+        c64_key_up(&state.c64, key_code);
+    }
+    c64_exec(&state.c64, FRAME_USEC);
+}
+
+static long minor_faults(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+// private dirty memory of this process in KB (-1 if unknown)
+static long private_dirty_kb(void) {
+    #if defined(__linux__)
+        FILE* fp = fopen("/proc/self/smaps_rollup", "r");
+        if (!fp) {
+            return -1;
+        }
+        char line[256];
+        long kb = -1;
+        while (fgets(line, sizeof(line), fp)) {
+            if (1 == sscanf(line, "Private_Dirty: %ld kB", &kb)) {
+                break;
+            }
+        }
+        fclose(fp);
+        return kb;
+    #else
+        return -1;
+    #endif
+}
+
+// run a session on a connected socket (in the child process)
+static void serve_session(int fd, uint64_t accept_time) {
+    state.session.frames = 0;
+    state.session.minflt_at_fork = minor_faults();
+    FILE* in = fdopen(fd, "r");
+    FILE* out = fdopen(dup(fd), "w");
+    if (!in || !out) {
+        return;
+    }
+    fprintf(out, "ready pid=%d spawn_us=%.1f\n", (int)getpid(), stm_us(stm_since(accept_time)));
+    fflush(out);
+    char line[LINE_SIZE];
+    while (fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (0 == strncmp(line, "run ", 4)) {
+            const int frames = atoi(line + 4);
+            const uint64_t start = stm_now();
+            for (int i = 0; i < frames; i++) {
+                c64_frame();
+            }
+            state.session.frames += (uint32_t)(frames > 0 ? frames : 0);
+            fprintf(out, "ok frames=%u us=%.1f\n", state.session.frames, stm_us(stm_since(start)));
+        }
+        else if (0 == strncmp(line, "type ", 5)) {
+            keybuf_put(line + 5);
+            keybuf_put("\n");
+            fprintf(out, "ok\n");
+        }
+        else if (0 == strncmp(line, "peek ", 5)) {
+            unsigned int addr = 0, len = 0;
+            if ((2 != sscanf(line + 5, "%x %u", &addr, &len)) || (len > MAX_PEEK)) {
+                fprintf(out, "error\n");
+            }
+            else {
+                for (unsigned int i = 0; i < len; i++) {
+                    fprintf(out, "%02X", mem_rd(&state.c64.mem_cpu, (uint16_t)(addr + i)));
+                }
+                fprintf(out, "\n");
+            }
+        }
+        else if (0 == strcmp(line, "stats")) {
+            fprintf(out, "stats frames=%u dirty_kb=%ld minflt=%ld\n",
+                state.session.frames, private_dirty_kb(), minor_faults() - state.session.minflt_at_fork);
+        }
+        else if (0 == strcmp(line, "quit")) {
+            break;
+        }
+        else {
+            fprintf(out, "error\n");
+        }
+        fflush(out);
+    }
+    fclose(out);
+    fclose(in);
+    fprintf(stderr, "session pid=%d frames=%u dirty_kb=%ld minflt=%ld\n",
+        (int)getpid(), state.session.frames, private_dirty_kb(), minor_faults() - state.session.minflt_at_fork);
+}
+
+// fork a child process for a session, the child never returns
+static pid_t spawn_session(int fd, int listen_fd, uint64_t accept_time) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        serve_session(fd, accept_time);
+        _exit(0);
+    }
+    close(fd);
+    return pid;
+}
+
+static int listen_socket(const char* path) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        close(fd);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if ((bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) || (listen(fd, 64) < 0)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int run_server(const char* path) {
+    const int listen_fd = listen_socket(path);
+    if (listen_fd < 0) {
+        printf("Failed to listen on '%s'\n", path);
+        return 10;
+    }
+    printf("== listening on %s\n", path);
+    fflush(stdout);
+    while (true) {
+        const int fd = accept(listen_fd, 0, 0);
+        if (fd < 0) {
+            continue;
+        }
+        const uint64_t accept_time = stm_now();
+        const pid_t pid = spawn_session(fd, listen_fd, accept_time);
+        printf("== session pid=%d fork_us=%.1f\n", (int)pid, stm_us(stm_since(accept_time)));
+        fflush(stdout);
+    }
+    return 0;
+}
+
+// act as client on the parent side of a socket pair
+static bool bench_session(int fd, session_stats_t* stats) {
+    FILE* in = fdopen(fd, "r");
+    FILE* out = fdopen(dup(fd), "w");
+    if (!in || !out) {
+        return false;
+    }
+    char line[LINE_SIZE];
+    bool ok = fgets(line, sizeof(line), in) && (1 == sscanf(line, "ready pid=%*d spawn_us=%lf", &stats->spawn_us));
+    fprintf(out, "run %d\nstats\nquit\n", BENCH_FRAMES);
+    fflush(out);
+    ok = ok && fgets(line, sizeof(line), in);
+    ok = ok && fgets(line, sizeof(line), in) && (2 == sscanf(line, "stats frames=%*u dirty_kb=%ld minflt=%ld", &stats->dirty_kb, &stats->minflt));
+    fclose(out);
+    fclose(in);
+    return ok;
+}
+
+static int run_bench(int num_sessions) {
+    double spawn_us = 0.0;
+    double dirty_kb = 0.0;
+    double minflt = 0.0;
+    for (int i = 0; i < num_sessions; i++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            return 10;
+        }
+        const uint64_t start = stm_now();
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            serve_session(fds[1], start);
+            _exit(0);
+        }
+        close(fds[1]);
+        session_stats_t stats = {0};
+        const bool ok = bench_session(fds[0], &stats);
+        waitpid(pid, 0, 0);
+        if (!ok) {
+            printf("!! FAILED: session %d\n", i);
+            return 10;
+        }
+        spawn_us += stats.spawn_us;
+        dirty_kb += (double)stats.dirty_kb;
+        minflt += (double)stats.minflt;
+    }
+    printf("== %d sessions, %d frames each\n", num_sessions, BENCH_FRAMES);
+    printf("== spawn latency: %.1f us\n", spawn_us / num_sessions);
+    printf("== dirty memory: %.1f KB (%.1f minor page faults) per session\n", dirty_kb / num_sessions, minflt / num_sessions);
+    printf("== machine state: %.1f KB shared\n", sizeof(c64_t) / 1024.0);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    sargs_setup(&(sargs_desc){ .argc=argc, .argv=argv });
+    stm_setup();
+    keybuf_init(&(keybuf_desc_t){ .key_delay_frames = 5 });
+
+    // boot once to the READY prompt, all sessions start from here
+    const uint64_t boot_start = stm_now();
+    c64_init(&state.c64, &(c64_desc_t){
+        .roms = {
+            .chars = { .ptr=dump_c64_char_bin, .size=sizeof(dump_c64_char_bin) },
+            .basic = { .ptr=dump_c64_basic_bin, .size=sizeof(dump_c64_basic_bin) },
+            .kernal = { .ptr=dump_c64_kernalv3_bin, .size=sizeof(dump_c64_kernalv3_bin) }
+        }
+    });
+    while (!c64_ready() && (state.boot_frames < MAX_BOOT_FRAMES)) {
+        c64_frame();
+        state.boot_frames++;
+    }
+    if (!c64_ready()) {
+        printf("!! FAILED: no READY prompt\n");
+        return 10;
+    }
+    printf("== booted in %u frames, %.3f ms\n", state.boot_frames, stm_ms(stm_since(boot_start)));
+    fflush(stdout);
+
+    int res;
+    if (sargs_exists("bench")) {
+        const int num_sessions = atoi(sargs_value("bench"));
+        res = run_bench((num_sessions > 0) ? num_sessions : 10);
+    }
+    else {
+        // children are reaped automatically
+        signal(SIGCHLD, SIG_IGN);
+        res = run_server(sargs_value_def("socket", DEFAULT_SOCKET_PATH));
+    }
+    sargs_shutdown();
+    return res;
+}
@@ -0,0 +1,412 @@
+//------------------------------------------------------------------------------
+//  c64-server.c
+//
+//  Headless C64 session server. Runs a C64 in real time and streams it to
+//  clients on a local (Unix domain) socket as palette-indexed frame deltas
+//  (only changed rows, run-length encoded, see framedelta.h) plus 16-bit
+//  audio. The clients' keyboard and joystick input is fed into the
+//  emulator. All clients share the same C64 (e.g. a player and viewers),
+//  see session.h for the protocol.
+//
+//  Output to the clients is non-blocking, a client whose socket buffer is
+//  still full at the next frame skips that frame, the next frame is then
+//  encoded relative to the last frame the client actually received, so
+//  that a slow client never stalls the emulation or the other clients.
+//
+//  Command line args:
+//
+//  socket=[path]   socket path (default: /tmp/c64-server.sock)
+//  input=[text]    keyboard input after boot
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "keybuf.h"
+#include "framedelta.h"
+#include "session.h"
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#define SOKOL_ARGS_IMPL
+#include "sokol_args.h"
+#define CHIPS_IMPL
+#include "chips/chips_common.h"
+#include "chips/m6502.h"
+#include "chips/m6526.h"
+#include "chips/m6569.h"
+#include "chips/m6581.h"
+#include "chips/beeper.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/clk.h"
+#include "systems/c1530.h"
+#include "chips/m6522.h"
+#include "systems/c1541.h"
+#include "systems/c64.h"
+#include "c64-roms.h"
+
+#define FRAME_USEC (20000)
+#define SAMPLE_RATE (44100)
+#define DEFAULT_SOCKET_PATH "/tmp/c64-server.sock"
+#define MAX_CLIENTS (16)
+#define MAX_FRAME_WIDTH (512)
+#define MAX_FRAME_HEIGHT (320)
+#define MAX_AUDIO_SAMPLES (4096)
+#define IN_BUFFER_SIZE (1024)
+#define OUT_BUFFER_SIZE (FRAMEDELTA_MAX_SIZE(MAX_FRAME_WIDTH, MAX_FRAME_HEIGHT) + 2 * MAX_AUDIO_SAMPLES + 4096)
+#define INPUT_MSG_SIZE (SESSION_HEADER_SIZE + 6)
+#define STATS_FRAMES (250)
+
+typedef struct {
+    bool active;
+    int fd;
+    uint32_t input_seq;     // last input applied
+    bool has_ref;           // ref holds the last frame sent to the client
+    uint8_t ref[MAX_FRAME_WIDTH * MAX_FRAME_HEIGHT];
+    size_t in_len;
+    uint8_t in[IN_BUFFER_SIZE];
+    size_t out_len;
+    uint8_t out[OUT_BUFFER_SIZE];
+    uint32_t frames_sent;
+    uint32_t frames_skipped;
+    uint64_t bytes_sent;
+} client_t;
+
+static struct {
+    c64_t c64;
+    uint32_t frame_count;
+    int width;
+    int height;
+    uint32_t num_colors;
+    uint32_t palette[256];
+    uint8_t frame[MAX_FRAME_WIDTH * MAX_FRAME_HEIGHT];
+    struct {
+        int num_samples;
+        int16_t samples[MAX_AUDIO_SAMPLES];
+    } audio;
+    client_t clients[MAX_CLIENTS];
+} state;
+
+static int quit_requested = 0;
+static void catch_sigint(int signo) {
+    (void)signo;
+    quit_requested = 1;
+}
+
+static void push_audio(const float* samples, int num_samples, void* user_data) {
+    (void)user_data;
+    for (int i = 0; (i < num_samples) && (state.audio.num_samples < MAX_AUDIO_SAMPLES); i++) {
+        float s = samples[i];
+        s = (s > 1.0f) ? 1.0f : ((s < -1.0f) ? -1.0f : s);
+        state.audio.samples[state.audio.num_samples++] = (int16_t)(s * 32767.0f);
+    }
+}
+
+// copy the visible screen area into a contiguous palette-indexed frame
+static void grab_frame(void) {
+    const chips_display_info_t info = c64_display_info(&state.c64);
+    const size_t pitch = (size_t)info.frame.dim.width;
+    const uint8_t* src = (const uint8_t*)info.frame.buffer.ptr + (size_t)info.screen.y * pitch + (size_t)info.screen.x;
+    for (int y = 0; y < state.height; y++) {
+        memcpy(&state.frame[y * state.width], src + (size_t)y * pitch, (size_t)state.width);
+    }
+}
+
+// flush as much pending output as the socket takes, returns false on error
+static bool flush_client(client_t* client) {
+    while (client->out_len > 0) {
+        const ssize_t res = send(client->fd, client->out, client->out_len, 0);
+        if (res < 0) {
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+        }
+        client->bytes_sent += (uint64_t)res;
+        client->out_len -= (size_t)res;
+        memmove(client->out, client->out + res, client->out_len);
+        if (res == 0) {
+            break;
+        }
+    }
+    return true;
+}
+
+static void close_client(client_t* client) {
+    printf("== client %d disconnected: %u frames sent, %u skipped, %.1f KB/frame\n",
+        (int)(client - state.clients), client->frames_sent, client->frames_skipped,
+        client->frames_sent ? (client->bytes_sent / 1024.0 / client->frames_sent) : 0.0);
+    fflush(stdout);
+    close(client->fd);
+    client->active = false;
+}
+
+static void send_hello(client_t* client) {
+    uint8_t* dst = client->out + client->out_len;
+    const uint32_t size = 12 + state.num_colors * 4;
+    session_put_header(dst, SESSION_MSG_HELLO, size);
+    dst += SESSION_HEADER_SIZE;
+    session_put_u16(dst, (uint32_t)state.width);
+    session_put_u16(dst + 2, (uint32_t)state.height);
+    session_put_u32(dst + 4, SAMPLE_RATE);
+    session_put_u32(dst + 8, state.num_colors);
+    for (uint32_t i = 0; i < state.num_colors; i++) {
+        session_put_u32(dst + 12 + i * 4, state.palette[i]);
+    }
+    client->out_len += SESSION_HEADER_SIZE + size;
+}
+
+static void accept_client(int listen_fd) {
+    const int fd = accept(listen_fd, 0, 0);
+    if (fd < 0) {
+        return;
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        client_t* client = &state.clients[i];
+        if (!client->active) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            client->active = true;
+            client->fd = fd;
+            client->input_seq = 0;
+            client->has_ref = false;
+            client->in_len = 0;
+            client->out_len = 0;
+            client->frames_sent = 0;
+            client->frames_skipped = 0;
+            client->bytes_sent = 0;
+            send_hello(client);
+            printf("== client %d connected\n", i);
+            fflush(stdout);
+            return;
+        }
+    }
+    // no free client slot
+    close(fd);
+}
+
+static uint8_t c64_joystick_mask(uint8_t mask) {
+    uint8_t res = 0;
+    if (mask & SESSION_JOYSTICK_UP)    { res |= C64_JOYSTICK_UP; }
+    if (mask & SESSION_JOYSTICK_DOWN)  { res |= C64_JOYSTICK_DOWN; }
+    if (mask & SESSION_JOYSTICK_LEFT)  { res |= C64_JOYSTICK_LEFT; }
+    if (mask & SESSION_JOYSTICK_RIGHT) { res |= C64_JOYSTICK_RIGHT; }
+    if (mask & SESSION_JOYSTICK_FIRE)  { res |= C64_JOYSTICK_BTN; }
+    return res;
+}
+
+// read and apply client input, returns false if the client disconnected
+static bool read_client(client_t* client) {
+    const ssize_t res = recv(client->fd, client->in + client->in_len, IN_BUFFER_SIZE - client->in_len, 0);
+    if (res == 0) {
+        return false;
+    }
+    if (res < 0) {
+        return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+    }
+    client->in_len += (size_t)res;
+    size_t pos = 0;
+    while ((client->in_len - pos) >= INPUT_MSG_SIZE) {
+        const uint8_t* msg = &client->in[pos];
+        if ((msg[0] != SESSION_MSG_INPUT) || (session_get_u32(&msg[4]) != 6)) {
+            return false;
+        }
+        const uint8_t type = msg[SESSION_HEADER_SIZE + 4];
+        const uint8_t value = msg[SESSION_HEADER_SIZE + 5];
+        switch (type) {
+            case SESSION_INPUT_KEY_DOWN: c64_key_down(&state.c64, value); break;
+            case SESSION_INPUT_KEY_UP:   c64_key_up(&state.c64, value); break;
+            case SESSION_INPUT_JOYSTICK: c64_joystick(&state.c64, 0, c64_joystick_mask(value)); break;
+            default: break;
+        }
+        client->input_seq = session_get_u32(&msg[SESSION_HEADER_SIZE]);
+        pos += INPUT_MSG_SIZE;
+    }
+    client->in_len -= pos;
+    memmove(client->in, client->in + pos, client->in_len);
+    return true;
+}
+
+static void send_frame(client_t* client) {
+    if (client->out_len > 0) {
+        // the client hasn't received the previous frame yet
+        client->frames_skipped++;
+        return;
+    }
+    uint8_t* dst = client->out;
+    const size_t delta_size = framedelta_encode(client->has_ref ? client->ref : 0, state.frame, state.width, state.height,
+        dst + SESSION_HEADER_SIZE + 8, OUT_BUFFER_SIZE - SESSION_HEADER_SIZE - 8);
+    assert(delta_size > 0);
+    session_put_header(dst, SESSION_MSG_FRAME, (uint32_t)(8 + delta_size));
+    session_put_u32(dst + SESSION_HEADER_SIZE, state.frame_count);
+    session_put_u32(dst + SESSION_HEADER_SIZE + 4, client->input_seq);
+    client->out_len = SESSION_HEADER_SIZE + 8 + delta_size;
+    memcpy(client->ref, state.frame, (size_t)(state.width * state.height));
+    client->has_ref = true;
+    client->frames_sent++;
+    // audio goes with the frame, and is dropped together with skipped frames
+    if (state.audio.num_samples > 0) {
+        const uint32_t size = (uint32_t)state.audio.num_samples * 2;
+        dst = client->out + client->out_len;
+        session_put_header(dst, SESSION_MSG_AUDIO, size);
+        dst += SESSION_HEADER_SIZE;
+        for (int i = 0; i < state.audio.num_samples; i++) {
+            session_put_u16(dst + i * 2, (uint16_t)state.audio.samples[i]);
+        }
+        client->out_len += SESSION_HEADER_SIZE + size;
+    }
+}
+
+static void run_frame(void) {
+    uint8_t key_code;
+    if (0 != (key_code = keybuf_get(FRAME_USEC))) {
+        c64_key_down(&state.c64, key_code);
+        c64_key_up(&state.c64, key_code);
+    }
+    state.audio.num_samples = 0;
+    c64_exec(&state.c64, FRAME_USEC);
+    state.frame_count++;
+    grab_frame();
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        client_t* client = &state.clients[i];
+        if (client->active) {
+            send_frame(client);
+            if (!flush_client(client)) {
+                close_client(client);
+            }
+        }
+    }
+}
+
+static int listen_socket(const char* path) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        close(fd);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if ((bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) || (listen(fd, MAX_CLIENTS) < 0)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char* argv[]) {
+    sargs_setup(&(sargs_desc){ .argc=argc, .argv=argv });
+    stm_setup();
+    keybuf_init(&(keybuf_desc_t){ .key_delay_frames = 5 });
+    c64_init(&state.c64, &(c64_desc_t){
+        .audio = {
+            .callback = { .func = push_audio },
+            .sample_rate = SAMPLE_RATE,
+        },
+        .roms = {
+            .chars = { .ptr=dump_c64_char_bin, .size=sizeof(dump_c64_char_bin) },
+            .basic = { .ptr=dump_c64_basic_bin, .size=sizeof(dump_c64_basic_bin) },
+            .kernal = { .ptr=dump_c64_kernalv3_bin, .size=sizeof(dump_c64_kernalv3_bin) }
+        }
+    });
+    const chips_display_info_t info = c64_display_info(&state.c64);
+    if ((info.frame.bytes_per_pixel != 1) || (info.screen.width > MAX_FRAME_WIDTH) || (info.screen.height > MAX_FRAME_HEIGHT)) {
+        printf("!! FAILED: unsupported display\n");
+        return 10;
+    }
+    state.width = info.screen.width;
+    state.height = info.screen.height;
+    state.num_colors = (uint32_t)(info.palette.size / sizeof(uint32_t));
+    if (state.num_colors > 256) {
+        state.num_colors = 256;
+    }
+    memcpy(state.palette, info.palette.ptr, state.num_colors * sizeof(uint32_t));
+    if (sargs_exists("input")) {
+        keybuf_put(sargs_value("input"));
+    }
+
+    const char* path = sargs_value_def("socket", DEFAULT_SOCKET_PATH);
+    const int listen_fd = listen_socket(path);
+    if (listen_fd < 0) {
+        printf("Failed to listen on '%s'\n", path);
+        return 10;
+    }
+    printf("== listening on %s (%dx%d, %u colors)\n", path, state.width, state.height, state.num_colors);
+    fflush(stdout);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, catch_sigint);
+
+    // run the emulation on fixed time, and handle sockets in between frames
+    const uint64_t start_time = stm_now();
+    double next_frame_us = 0.0;
+    double emu_us = 0.0;
+    while (!quit_requested) {
+        struct pollfd fds[MAX_CLIENTS + 1];
+        client_t* fd_clients[MAX_CLIENTS + 1];
+        int num_fds = 0;
+        fds[num_fds] = (struct pollfd){ .fd = listen_fd, .events = POLLIN };
+        fd_clients[num_fds++] = 0;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            client_t* client = &state.clients[i];
+            if (client->active) {
+                fds[num_fds] = (struct pollfd){ .fd = client->fd, .events = (short)(POLLIN | ((client->out_len > 0) ? POLLOUT : 0)) };
+                fd_clients[num_fds++] = client;
+            }
+        }
+        const double now_us = stm_us(stm_since(start_time));
+        const int timeout_ms = (next_frame_us > now_us) ? (int)((next_frame_us - now_us + 999.0) / 1000.0) : 0;
+        if (poll(fds, (nfds_t)num_fds, timeout_ms) > 0) {
+            for (int i = 0; i < num_fds; i++) {
+                client_t* client = fd_clients[i];
+                if (0 == fds[i].revents) {
+                    continue;
+                }
+                if (!client) {
+                    accept_client(listen_fd);
+                }
+                else if ((fds[i].revents & (POLLERR | POLLHUP)) && !(fds[i].revents & POLLIN)) {
+                    close_client(client);
+                }
+                else if (((fds[i].revents & POLLIN) && !read_client(client)) || !flush_client(client)) {
+                    close_client(client);
+                }
+            }
+        }
+        const double t = stm_us(stm_since(start_time));
+        if (t >= next_frame_us) {
+            const uint64_t frame_start = stm_now();
+            run_frame();
+            emu_us += stm_us(stm_since(frame_start));
+            next_frame_us += FRAME_USEC;
+            // don't try to catch up after a stall
+            if ((t - next_frame_us) > (5 * FRAME_USEC)) {
+                next_frame_us = t + FRAME_USEC;
+            }
+            if (0 == (state.frame_count % STATS_FRAMES)) {
+                printf("== frame %u: %.2f ms per frame (emulation and encoding)\n", state.frame_count, emu_us / 1000.0 / STATS_FRAMES);
+                fflush(stdout);
+                emu_us = 0.0;
+            }
+        }
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (state.clients[i].active) {
+            close_client(&state.clients[i]);
+        }
+    }
+    close(listen_fd);
+    unlink(path);
+    sargs_shutdown();
+    return 0;
+}
@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+//  gym-bench.c
+//
+//  Throughput benchmark for the vectorized stepping API (see gym.h). Runs
+//  a number of environments with random joystick input and reports the
+//  emulated frames per second over all environments.
+//
+//  Command line args:
+//
+//  envs=[num]      number of environments (default: 64)
+//  threads=[num]   number of threads (default: number of CPU cores)
+//  frames=[num]    frames per step (default: 4)
+//  steps=[num]     number of steps (default: 250)
+//  warmup=[num]    frames to run before measuring, e.g. to boot (default: 100)
+//  downsample=[n]  framebuffer downsampling factor (default: 2)
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "gym.h"
+#define SOKOL_ARGS_IMPL
+#include "sokol_args.h"
+
+static int arg_int(const char* key, int def) {
+    const int val = atoi(sargs_value_def(key, ""));
+    return (val > 0) ? val : def;
+}
+
+int main(int argc, char* argv[]) {
+    sargs_setup(&(sargs_desc){ .argc=argc, .argv=argv });
+    const int num_envs = arg_int("envs", 64);
+    const int num_threads = arg_int("threads", (int)sysconf(_SC_NPROCESSORS_ONLN));
+    const int num_frames = arg_int("frames", 4);
+    const int num_steps = arg_int("steps", 250);
+    const int num_warmup = arg_int("warmup", 100);
+    const int downsample = arg_int("downsample", 2);
+    sargs_shutdown();
+
+    if (!gym_init(&(gym_desc_t){ .num_envs=num_envs, .num_threads=num_threads, .downsample=downsample })) {
+        printf("!! FAILED: gym_init()\n");
+        return 10;
+    }
+    const gym_obs_t obs = gym_obs();
+    printf("== %s: %d envs, %d threads, frame %dx%dx%d (%d KB), ram %d KB per env\n",
+        gym_system(), num_envs, (num_threads < num_envs) ? num_threads : num_envs, obs.width, obs.height, obs.bytes_per_pixel,
+        (int)(obs.frame.size / 1024), (int)(obs.ram.size / 1024));
+    gym_step(0, num_warmup);
+    const gym_stats_t warmup_stats = gym_stats();
+
+    // the inputs are prepared up front, so only the stepping is measured
+    static gym_input_t inputs[GYM_MAX_ENVS];
+    uint32_t rnd = 0x12345678;
+    uint32_t checksum = 0;
+    for (int step = 0; step < num_steps; step++) {
+        for (int i = 0; i < num_envs; i++) {
+            rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+            inputs[i].buttons = (uint8_t)(rnd & (GYM_BUTTON_LEFT|GYM_BUTTON_RIGHT|GYM_BUTTON_UP|GYM_BUTTON_DOWN|GYM_BUTTON_FIRE));
+        }
+        gym_step(inputs, num_frames);
+        // touch the observations like an agent would
+        for (int i = 0; i < num_envs; i++) {
+            checksum += obs.frame.ptr[i * obs.frame.stride + obs.frame.size / 2];
+            checksum += obs.ram.ptr[i * obs.ram.stride + (step % obs.ram.size)];
+        }
+    }
+    const gym_stats_t stats = gym_stats();
+    const double frames = (double)(stats.frames - warmup_stats.frames);
+    const double seconds = stats.seconds - warmup_stats.seconds;
+    const double fps = frames / seconds;
+    printf("== %d steps x %d frames: %.0f frames in %.3f s\n", num_steps, num_frames, frames, seconds);
+    printf("== %.0f frames/sec (%.1f million frames/hour, %.1fx realtime per env, checksum %08X)\n",
+        fps, fps * 3600.0 / 1000000.0, (stats.realtime / stats.fps) * fps / num_envs, checksum);
+    gym_shutdown();
+    return 0;
+}
@@ -0,0 +1,518 @@
+//------------------------------------------------------------------------------
+//  gym.c
+//
+//  Vectorized stepping of many emulator instances (see gym.h), compiled once
+//  per system, the system is selected with one of the CHIPS_GYM_* defines.
+//------------------------------------------------------------------------------
+#include "gym.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#define CHIPS_IMPL
+#include "chips/chips_common.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/clk.h"
+#if defined(CHIPS_GYM_C64)
+    #include "chips/m6502.h"
+    #include "chips/m6526.h"
+    #include "chips/m6569.h"
+    #include "chips/m6581.h"
+    #include "chips/beeper.h"
+    #include "systems/c1530.h"
+    #include "chips/m6522.h"
+    #include "systems/c1541.h"
+    #include "systems/c64.h"
+    #include "c64-roms.h"
+#elif defined(CHIPS_GYM_ZX)
+    #include "chips/z80.h"
+    #include "chips/beeper.h"
+    #include "chips/ay38910.h"
+    #include "systems/zx.h"
+    #include "zx-roms.h"
+#elif defined(CHIPS_GYM_ATOM)
+    #include "chips/m6502.h"
+    #include "chips/mc6847.h"
+    #include "chips/i8255.h"
+    #include "chips/m6522.h"
+    #include "chips/beeper.h"
+    #include "systems/atom.h"
+    #include "atom-roms.h"
+#elif defined(CHIPS_GYM_PACMAN)
+    #include "chips/z80.h"
+    #include "pacman-roms.h"
+    #define NAMCO_PACMAN
+    #include "systems/namco.h"
+#elif defined(CHIPS_GYM_PENGO)
+    #include "chips/z80.h"
+    #include "pengo-roms.h"
+    #define NAMCO_PENGO
+    #include "systems/namco.h"
+#elif defined(CHIPS_GYM_BOMBJACK)
+    #include "chips/z80.h"
+    #include "chips/ay38910.h"
+    #include "systems/bombjack.h"
+    #include "bombjack-roms.h"
+#else
+    #error "no CHIPS_GYM_* system selected"
+#endif
+
+// system specific wrappers, the home computers route the cursor keys
+// and space to the joystick, so the buttons are fed in as key codes
+#if defined(CHIPS_GYM_C64)
+#define SYS_NAME "c64"
+#define SYS_FRAME_USEC (20000)
+#define SYS_HAS_KEYBOARD (1)
+#define SYS_RAM(sys) ((sys)->ram)
+typedef c64_t sys_t;
+static void sys_init(sys_t* sys) {
+    c64_init(sys, &(c64_desc_t){
+        .joystick_type = C64_JOYSTICKTYPE_DIGITAL_2,
+        .roms = {
+            .chars = { .ptr=dump_c64_char_bin, .size=sizeof(dump_c64_char_bin) },
+            .basic = { .ptr=dump_c64_basic_bin, .size=sizeof(dump_c64_basic_bin) },
+            .kernal = { .ptr=dump_c64_kernalv3_bin, .size=sizeof(dump_c64_kernalv3_bin) },
+        },
+    });
+}
+static void sys_exec(sys_t* sys, uint32_t micro_seconds) { c64_exec(sys, micro_seconds); }
+static void sys_key_down(sys_t* sys, int c) { c64_key_down(sys, c); }
+static void sys_key_up(sys_t* sys, int c) { c64_key_up(sys, c); }
+static chips_display_info_t sys_display_info(sys_t* sys) { return c64_display_info(sys); }
+#elif defined(CHIPS_GYM_ZX)
+#define SYS_NAME "zx"
+#define SYS_FRAME_USEC (20000)
+#define SYS_HAS_KEYBOARD (1)
+#define SYS_RAM(sys) ((sys)->ram)
+typedef zx_t sys_t;
+static void sys_init(sys_t* sys) {
+    zx_init(sys, &(zx_desc_t){
+        .type = ZX_TYPE_48K,
+        .joystick_type = ZX_JOYSTICKTYPE_KEMPSTON,
+        .roms = {
+            .zx48k = { .ptr=dump_amstrad_zx48k_bin, .size=sizeof(dump_amstrad_zx48k_bin) },
+            .zx128_0 = { .ptr=dump_amstrad_zx128k_0_bin, .size=sizeof(dump_amstrad_zx128k_0_bin) },
+            .zx128_1 = { .ptr=dump_amstrad_zx128k_1_bin, .size=sizeof(dump_amstrad_zx128k_1_bin) },
+        },
+    });
+}
+static void sys_exec(sys_t* sys, uint32_t micro_seconds) { zx_exec(sys, micro_seconds); }
+static void sys_key_down(sys_t* sys, int c) { zx_key_down(sys, c); }
+static void sys_key_up(sys_t* sys, int c) { zx_key_up(sys, c); }
+static chips_display_info_t sys_display_info(sys_t* sys) { return zx_display_info(sys); }
+#elif defined(CHIPS_GYM_ATOM)
+#define SYS_NAME "atom"
+#define SYS_FRAME_USEC (16667)
+#define SYS_HAS_KEYBOARD (1)
+#define SYS_RAM(sys) ((sys)->ram)
+typedef atom_t sys_t;
+static void sys_init(sys_t* sys) {
+    atom_init(sys, &(atom_desc_t){
+        .joystick_type = ATOM_JOYSTICKTYPE_MMC,
+        .roms = {
+            .abasic = { .ptr=dump_abasic_ic20, .size = sizeof(dump_abasic_ic20) },
+            .afloat = { .ptr=dump_afloat_ic21, .size = sizeof(dump_afloat_ic21) },
+            .dosrom = { .ptr=dump_dosrom_u15, .size = sizeof(dump_dosrom_u15) }
+        },
+    });
+}
+static void sys_exec(sys_t* sys, uint32_t micro_seconds) { atom_exec(sys, micro_seconds); }
+static void sys_key_down(sys_t* sys, int c) { atom_key_down(sys, c); }
+static void sys_key_up(sys_t* sys, int c) { atom_key_up(sys, c); }
+static chips_display_info_t sys_display_info(sys_t* sys) { return atom_display_info(sys); }
+#elif defined(CHIPS_GYM_PACMAN) || defined(CHIPS_GYM_PENGO)
+#if defined(CHIPS_GYM_PACMAN)
+#define SYS_NAME "pacman"
+#else
+#define SYS_NAME "pengo"
+#endif
+#define SYS_FRAME_USEC (16667)
+#define SYS_RAM(sys) ((sys)->main_ram)
+typedef namco_t sys_t;
+static void sys_init(sys_t* sys) {
+    namco_init(sys, &(namco_desc_t){
+        .roms = {
+            #if defined(CHIPS_GYM_PACMAN)
+            .common = {
+                .cpu_0000_0FFF = { .ptr=dump_pacman_6e, .size = sizeof(dump_pacman_6e) },
+                .cpu_1000_1FFF = { .ptr=dump_pacman_6f, .size = sizeof(dump_pacman_6f) },
+                .cpu_2000_2FFF = { .ptr=dump_pacman_6h, .size = sizeof(dump_pacman_6h) },
+                .cpu_3000_3FFF = { .ptr=dump_pacman_6j, .size = sizeof(dump_pacman_6j) },
+                .prom_0000_001F = { .ptr=dump_82s123_7f, .size = sizeof(dump_82s123_7f) },
+                .sound_0000_00FF = { .ptr=dump_82s126_1m, .size = sizeof(dump_82s126_1m) },
+                .sound_0100_01FF = { .ptr=dump_82s126_3m, .size = sizeof(dump_82s126_3m) },
+            },
+            .pacman = {
+                .gfx_0000_0FFF = { .ptr=dump_pacman_5e, .size = sizeof(dump_pacman_5e) },
+                .gfx_1000_1FFF = { .ptr=dump_pacman_5f, .size = sizeof(dump_pacman_5f) },
+                .prom_0020_011F = { .ptr=dump_82s126_4a, .size = sizeof(dump_82s126_4a) },
+            }
+            #else
+            .common = {
+                .cpu_0000_0FFF = { .ptr=dump_ep5120_8, .size=sizeof(dump_ep5120_8) },
+                .cpu_1000_1FFF = { .ptr=dump_ep5121_7, .size=sizeof(dump_ep5121_7) },
+                .cpu_2000_2FFF = { .ptr=dump_ep5122_15, .size=sizeof(dump_ep5122_15) },
+                .cpu_3000_3FFF = { .ptr=dump_ep5123_14, .size=sizeof(dump_ep5123_14) },
+                .prom_0000_001F = { .ptr=dump_pr1633_78, .size=sizeof(dump_pr1633_78) },
+                .sound_0000_00FF = { .ptr=dump_pr1635_51, .size=sizeof(dump_pr1635_51) },
+                .sound_0100_01FF = { .ptr=dump_pr1636_70, .size=sizeof(dump_pr1636_70) }
+            },
+            .pengo = {
+                .cpu_4000_4FFF = { .ptr=dump_ep5124_21, .size=sizeof(dump_ep5124_21) },
+                .cpu_5000_5FFF = { .ptr=dump_ep5125_20, .size=sizeof(dump_ep5125_20) },
+                .cpu_6000_6FFF = { .ptr=dump_ep5126_32, .size=sizeof(dump_ep5126_32) },
+                .cpu_7000_7FFF = { .ptr=dump_ep5127_31, .size=sizeof(dump_ep5127_31) },
+                .gfx_0000_1FFF = { .ptr=dump_ep1640_92, .size=sizeof(dump_ep1640_92) },
+                .gfx_2000_3FFF = { .ptr=dump_ep1695_105, .size=sizeof(dump_ep1695_105) },
+                .prom_0020_041F = { .ptr=dump_pr1634_88, .size=sizeof(dump_pr1634_88) }
+            }
+            #endif
+        },
+    });
+}
+static void sys_exec(sys_t* sys, uint32_t micro_seconds) { namco_exec(sys, micro_seconds); }
+static void sys_buttons(sys_t* sys, uint8_t mask, bool down) {
+    static const uint32_t map[7] = {
+        NAMCO_INPUT_P1_LEFT, NAMCO_INPUT_P1_RIGHT, NAMCO_INPUT_P1_UP, NAMCO_INPUT_P1_DOWN,
+        0, NAMCO_INPUT_P1_COIN, NAMCO_INPUT_P1_START
+    };
+    for (int i = 0; i < 7; i++) {
+        if ((mask & (1<<i)) && map[i]) {
+            if (down) {
+                namco_input_set(sys, map[i]);
+            }
+            else {
+                namco_input_clear(sys, map[i]);
+            }
+        }
+    }
+}
+static chips_display_info_t sys_display_info(sys_t* sys) { return namco_display_info(sys); }
+#elif defined(CHIPS_GYM_BOMBJACK)
+#define SYS_NAME "bombjack"
+#define SYS_FRAME_USEC (16667)
+#define SYS_RAM(sys) ((sys)->main_ram)
+typedef bombjack_t sys_t;
+static void sys_init(sys_t* sys) {
+    bombjack_init(sys, &(bombjack_desc_t){
+        .roms = {
+            .main_0000_1FFF = { .ptr=dump_09_j01b_bin, .size=sizeof(dump_09_j01b_bin) },
+            .main_2000_3FFF = { .ptr=dump_10_l01b_bin, .size=sizeof(dump_10_l01b_bin) },
+            .main_4000_5FFF = { .ptr=dump_11_m01b_bin, .size=sizeof(dump_11_m01b_bin) },
+            .main_6000_7FFF = { .ptr=dump_12_n01b_bin, .size=sizeof(dump_12_n01b_bin) },
+            .main_C000_DFFF = { .ptr=dump_13_1r, .size=sizeof(dump_13_1r) },
+            .sound_0000_1FFF = { .ptr=dump_01_h03t_bin, .size=sizeof(dump_01_h03t_bin) },
+            .chars_0000_0FFF = { .ptr=dump_03_e08t_bin, .size=sizeof(dump_03_e08t_bin) },
+            .chars_1000_1FFF = { .ptr=dump_04_h08t_bin, .size=sizeof(dump_04_h08t_bin) },
+            .chars_2000_2FFF = { .ptr=dump_05_k08t_bin, .size=sizeof(dump_05_k08t_bin) },
+            .tiles_0000_1FFF = { .ptr=dump_06_l08t_bin, .size=sizeof(dump_06_l08t_bin) },
+            .tiles_2000_3FFF = { .ptr=dump_07_n08t_bin, .size=sizeof(dump_07_n08t_bin) },
+            .tiles_4000_5FFF = { .ptr=dump_08_r08t_bin, .size=sizeof(dump_08_r08t_bin) },
+            .sprites_0000_1FFF = { .ptr=dump_16_m07b_bin, .size=sizeof(dump_16_m07b_bin) },
+            .sprites_2000_3FFF = { .ptr=dump_15_l07b_bin, .size=sizeof(dump_15_l07b_bin) },
+            .sprites_4000_5FFF = { .ptr=dump_14_j07b_bin, .size=sizeof(dump_14_j07b_bin) },
+            .maps_0000_0FFF = { .ptr=dump_02_p04t_bin, .size=sizeof(dump_02_p04t_bin) }
+        },
+    });
+}
+static void sys_exec(sys_t* sys, uint32_t micro_seconds) { bombjack_exec(sys, micro_seconds); }
+static void sys_buttons(sys_t* sys, uint8_t mask, bool down) {
+    uint8_t p1 = 0;
+    uint8_t sys_bits = 0;
+    if (mask & GYM_BUTTON_LEFT)  { p1 |= BOMBJACK_JOYSTICK_LEFT; }
+    if (mask & GYM_BUTTON_RIGHT) { p1 |= BOMBJACK_JOYSTICK_RIGHT; }
+    if (mask & GYM_BUTTON_UP)    { p1 |= BOMBJACK_JOYSTICK_UP; }
+    if (mask & GYM_BUTTON_DOWN)  { p1 |= BOMBJACK_JOYSTICK_DOWN; }
+    if (mask & GYM_BUTTON_FIRE)  { p1 |= BOMBJACK_JOYSTICK_BUTTON; }
+    if (mask & GYM_BUTTON_COIN)  { sys_bits |= BOMBJACK_SYS_P1_COIN; }
+    if (mask & GYM_BUTTON_START) { sys_bits |= BOMBJACK_SYS_P1_START; }
+    if (down) {
+        sys->mainboard.p1 |= p1;
+        sys->mainboard.sys |= sys_bits;
+    }
+    else {
+        sys->mainboard.p1 &= ~p1;
+        sys->mainboard.sys &= ~sys_bits;
+    }
+}
+static chips_display_info_t sys_display_info(sys_t* sys) { return bombjack_display_info(sys); }
+#endif
+
+#if defined(SYS_HAS_KEYBOARD)
+// cursor keys and space in the order of the GYM_BUTTON_* bits
+static const uint8_t _gym_joy_keys[5] = { 0x08, 0x09, 0x0B, 0x0A, 0x20 };
+static void sys_buttons(sys_t* sys, uint8_t mask, bool down) {
+    for (int i = 0; i < 5; i++) {
+        if (mask & (1<<i)) {
+            if (down) {
+                sys_key_down(sys, _gym_joy_keys[i]);
+            }
+            else {
+                sys_key_up(sys, _gym_joy_keys[i]);
+            }
+        }
+    }
+}
+#endif
+
+typedef struct {
+    sys_t sys;
+    gym_input_t input;      // currently held down
+} _gym_env_t;
+
+typedef struct {
+    bool valid;
+    gym_desc_t desc;
+    _gym_env_t* envs;
+    uint8_t* frames;
+    gym_obs_t obs;
+    chips_rect_t screen;
+    // current step
+    const gym_input_t* inputs;
+    int num_frames;
+    // worker threads, the calling thread is worker 0
+    int num_threads;
+    pthread_t threads[GYM_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    uint32_t generation;
+    int busy;
+    bool quit;
+    // statistics
+    uint64_t num_env_frames;
+    double seconds;
+} gym_state_t;
+static gym_state_t state;
+
+static double _gym_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+}
+
+static void _gym_set_input(_gym_env_t* env, gym_input_t input) {
+    #if defined(SYS_HAS_KEYBOARD)
+    if (env->input.key != input.key) {
+        if (env->input.key) {
+            sys_key_up(&env->sys, env->input.key);
+        }
+        if (input.key) {
+            sys_key_down(&env->sys, input.key);
+        }
+    }
+    #endif
+    const uint8_t released = env->input.buttons & ~input.buttons;
+    const uint8_t pressed = input.buttons & ~env->input.buttons;
+    if (released) {
+        sys_buttons(&env->sys, released, false);
+    }
+    if (pressed) {
+        sys_buttons(&env->sys, pressed, true);
+    }
+    env->input = input;
+}
+
+// copy the visible screen area of an environment into its observation frame
+static void _gym_observe(int env_index) {
+    _gym_env_t* env = &state.envs[env_index];
+    const chips_display_info_t info = sys_display_info(&env->sys);
+    const size_t bpp = (size_t)state.obs.bytes_per_pixel;
+    const size_t pitch = (size_t)info.frame.dim.width * bpp;
+    const int ds = state.desc.downsample;
+    const uint8_t* src = (const uint8_t*)info.frame.buffer.ptr + (size_t)state.screen.y * pitch + (size_t)state.screen.x * bpp;
+    uint8_t* dst = state.obs.frame.ptr + (size_t)env_index * state.obs.frame.stride;
+    const size_t row_size = (size_t)state.obs.width * bpp;
+    for (int y = 0; y < state.obs.height; y++, src += pitch * ds, dst += row_size) {
+        if (ds == 1) {
+            memcpy(dst, src, row_size);
+        }
+        else if (bpp == 1) {
+            for (int x = 0; x < state.obs.width; x++) {
+                dst[x] = src[x * ds];
+            }
+        }
+        else {
+            for (int x = 0; x < state.obs.width; x++) {
+                memcpy(&dst[x * bpp], &src[x * ds * bpp], bpp);
+            }
+        }
+    }
+}
+
+// run the current step for the environments of one worker
+static void _gym_run(int worker_index) {
+    const int first = (worker_index * state.desc.num_envs) / state.num_threads;
+    const int last = ((worker_index + 1) * state.desc.num_envs) / state.num_threads;
+    for (int i = first; i < last; i++) {
+        _gym_env_t* env = &state.envs[i];
+        _gym_set_input(env, state.inputs ? state.inputs[i] : (gym_input_t){0});
+        for (int frame = 0; frame < state.num_frames; frame++) {
+            sys_exec(&env->sys, SYS_FRAME_USEC);
+        }
+        _gym_observe(i);
+    }
+}
+
+static void* _gym_worker(void* arg) {
+    const int worker_index = (int)(intptr_t)arg;
+    uint32_t generation = 0;
+    pthread_mutex_lock(&state.lock);
+    while (true) {
+        while (!state.quit && (state.generation == generation)) {
+            pthread_cond_wait(&state.work_cond, &state.lock);
+        }
+        if (state.quit) {
+            break;
+        }
+        generation = state.generation;
+        pthread_mutex_unlock(&state.lock);
+        _gym_run(worker_index);
+        pthread_mutex_lock(&state.lock);
+        if (--state.busy == 0) {
+            pthread_cond_signal(&state.done_cond);
+        }
+    }
+    pthread_mutex_unlock(&state.lock);
+    return 0;
+}
+
+bool gym_init(const gym_desc_t* desc) {
+    assert(!state.valid);
+    assert(desc);
+    if ((desc->num_envs <= 0) || (desc->num_envs > GYM_MAX_ENVS)) {
+        return false;
+    }
+    memset(&state, 0, sizeof(state));
+    state.desc = *desc;
+    if (state.desc.downsample <= 0) {
+        state.desc.downsample = 1;
+    }
+    state.num_threads = state.desc.num_threads;
+    if (state.num_threads <= 0) {
+        state.num_threads = 1;
+    }
+    if (state.num_threads > GYM_MAX_THREADS) {
+        state.num_threads = GYM_MAX_THREADS;
+    }
+    if (state.num_threads > state.desc.num_envs) {
+        state.num_threads = state.desc.num_envs;
+    }
+    state.envs = (_gym_env_t*) calloc((size_t)state.desc.num_envs, sizeof(_gym_env_t));
+    if (!state.envs) {
+        return false;
+    }
+    for (int i = 0; i < state.desc.num_envs; i++) {
+        sys_init(&state.envs[i].sys);
+    }
+
+    // the observation layout is fixed by the first environment's display
+    const chips_display_info_t info = sys_display_info(&state.envs[0].sys);
+    assert((info.frame.bytes_per_pixel == 1) || (info.frame.bytes_per_pixel == 4));
+    state.screen = info.screen;
+    const int ds = state.desc.downsample;
+    state.obs.num_envs = state.desc.num_envs;
+    state.obs.width = state.screen.width / ds;
+    state.obs.height = state.screen.height / ds;
+    state.obs.bytes_per_pixel = info.frame.bytes_per_pixel;
+    if (info.frame.bytes_per_pixel == 1) {
+        state.obs.palette = info.palette;
+    }
+    const size_t frame_size = (size_t)(state.obs.width * state.obs.height * state.obs.bytes_per_pixel);
+    state.frames = (uint8_t*) calloc((size_t)state.desc.num_envs, frame_size);
+    if (!state.frames) {
+        free(state.envs);
+        return false;
+    }
+    state.obs.frame = (gym_view_t){ .ptr = state.frames, .stride = frame_size, .size = frame_size };
+    state.obs.ram = (gym_view_t){
+        .ptr = (uint8_t*)SYS_RAM(&state.envs[0].sys),
+        .stride = sizeof(_gym_env_t),
+        .size = sizeof(SYS_RAM(&state.envs[0].sys)),
+    };
+    for (int i = 0; i < state.desc.num_envs; i++) {
+        _gym_observe(i);
+    }
+
+    pthread_mutex_init(&state.lock, 0);
+    pthread_cond_init(&state.work_cond, 0);
+    pthread_cond_init(&state.done_cond, 0);
+    for (int i = 1; i < state.num_threads; i++) {
+        if (0 != pthread_create(&state.threads[i], 0, _gym_worker, (void*)(intptr_t)i)) {
+            // run with the threads created so far
+            state.num_threads = i;
+            break;
+        }
+    }
+    state.valid = true;
+    return true;
+}
+
+void gym_shutdown(void) {
+    assert(state.valid);
+    pthread_mutex_lock(&state.lock);
+    state.quit = true;
+    pthread_cond_broadcast(&state.work_cond);
+    pthread_mutex_unlock(&state.lock);
+    for (int i = 1; i < state.num_threads; i++) {
+        pthread_join(state.threads[i], 0);
+    }
+    pthread_cond_destroy(&state.done_cond);
+    pthread_cond_destroy(&state.work_cond);
+    pthread_mutex_destroy(&state.lock);
+    free(state.frames);
+    free(state.envs);
+    state.valid = false;
+}
+
+const char* gym_system(void) {
+    return SYS_NAME;
+}
+
+gym_obs_t gym_obs(void) {
+    assert(state.valid);
+    return state.obs;
+}
+
+void gym_step(const gym_input_t* inputs, int num_frames) {
+    assert(state.valid);
+    const double start = _gym_now();
+    pthread_mutex_lock(&state.lock);
+    state.inputs = inputs;
+    state.num_frames = num_frames;
+    state.busy = state.num_threads - 1;
+    state.generation++;
+    pthread_cond_broadcast(&state.work_cond);
+    pthread_mutex_unlock(&state.lock);
+    _gym_run(0);
+    pthread_mutex_lock(&state.lock);
+    while (state.busy > 0) {
+        pthread_cond_wait(&state.done_cond, &state.lock);
+    }
+    pthread_mutex_unlock(&state.lock);
+    state.num_env_frames += (uint64_t)state.desc.num_envs * (uint64_t)(num_frames > 0 ? num_frames : 0);
+    state.seconds += _gym_now() - start;
+}
+
+void gym_reset(int env_index) {
+    assert(state.valid);
+    assert((env_index >= 0) && (env_index < state.desc.num_envs));
+    _gym_env_t* env = &state.envs[env_index];
+    sys_init(&env->sys);
+    env->input = (gym_input_t){0};
+}
+
+gym_stats_t gym_stats(void) {
+    assert(state.valid);
+    gym_stats_t stats = {
+        .frames = state.num_env_frames,
+        .seconds = state.seconds,
+    };
+    if (state.seconds > 0.0) {
+        stats.fps = (double)state.num_env_frames / state.seconds;
+        stats.realtime = stats.fps * (SYS_FRAME_USEC / 1000000.0);
+    }
+    return stats;
+}
@@ -0,0 +1,102 @@
+#pragma once
+/*
+    Gym-style vectorized stepping for many emulator instances.
+
+    gym_init() allocates a number of instances (environments) of one
+    emulated system, plus all observation buffers, once. After that,
+    gym_step() runs every environment for a number of frames with
+    per-environment inputs, spread over a pool of worker threads, and
+    never allocates.
+
+    Observations are views into memory owned by the gym module:
+
+    - frame: the visible screen area of each environment, optionally
+      downsampled by an integer factor (nearest pixel), in one contiguous
+      buffer (environment i starts at ptr + i * stride). Pixels are
+      palette indices if the system has a palette, otherwise RGBA8.
+      Each worker writes the frames of its own environments right after
+      running them, while the framebuffer is still in the cache.
+    - ram: the main RAM of each environment, this is zero-copy, the view
+      points directly into the emulator instances (stride is the distance
+      between instances).
+
+    The views are valid until gym_shutdown(), and the content until the
+    next gym_step() or gym_reset().
+
+    The gym module is compiled once per system, the system is selected
+    with one of the CHIPS_GYM_* defines (see CMakeLists.txt).
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chips/chips_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GYM_MAX_ENVS (4096)
+#define GYM_MAX_THREADS (64)
+
+// input buttons, on home computers this is the joystick
+#define GYM_BUTTON_LEFT     (1<<0)
+#define GYM_BUTTON_RIGHT    (1<<1)
+#define GYM_BUTTON_UP       (1<<2)
+#define GYM_BUTTON_DOWN     (1<<3)
+#define GYM_BUTTON_FIRE     (1<<4)
+#define GYM_BUTTON_COIN     (1<<5)  // arcade machines only
+#define GYM_BUTTON_START    (1<<6)  // arcade machines only
+
+typedef struct {
+    int num_envs;           // number of emulator instances
+    int num_threads;        // number of threads including the caller (default: 1)
+    int downsample;         // framebuffer downsampling factor (default: 1)
+} gym_desc_t;
+
+// the input of one environment, held down for the whole step
+typedef struct {
+    uint8_t key;            // key code on home computers (0: no key)
+    uint8_t buttons;        // GYM_BUTTON_* mask
+} gym_input_t;
+
+typedef struct {
+    uint8_t* ptr;           // first environment
+    size_t stride;          // bytes from one environment to the next
+    size_t size;            // bytes per environment
+} gym_view_t;
+
+typedef struct {
+    int num_envs;
+    int width;              // frame width in pixels (after downsampling)
+    int height;             // frame height in pixels (after downsampling)
+    int bytes_per_pixel;    // 1: palette indices, 4: RGBA8
+    chips_range_t palette;  // RGBA8 palette, empty if no palette
+    gym_view_t frame;
+    gym_view_t ram;
+} gym_obs_t;
+
+typedef struct {
+    uint64_t frames;        // emulated frames over all environments
+    double seconds;         // wall clock time spent in gym_step()
+    double fps;             // emulated frames per second over all environments
+    double realtime;        // fps as a multiple of the system's frame rate
+} gym_stats_t;
+
+// allocate and initialize all environments and observation buffers
+bool gym_init(const gym_desc_t* desc);
+// stop the worker threads and free all memory
+void gym_shutdown(void);
+// name of the emulated system
+const char* gym_system(void);
+// get the observation views (valid until gym_shutdown)
+gym_obs_t gym_obs(void);
+// run all environments for a number of frames, inputs has one item per environment (or null)
+void gym_step(const gym_input_t* inputs, int num_frames);
+// restart one environment (the frame observation is updated on the next step)
+void gym_reset(int env_index);
+// get throughput statistics since gym_init()
+gym_stats_t gym_stats(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
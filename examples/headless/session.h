@@ -0,0 +1,68 @@
+#pragma once
+/*
+    Wire protocol between the emulator session server and its clients.
+
+    Every message starts with an 8-byte header (u8 type, 3 bytes padding,
+    u32 payload size), all values are little endian.
+
+    Server to client:
+
+    - SESSION_MSG_HELLO: u16 width, u16 height, u32 sample rate, u32 number
+      of colors, followed by the RGBA8 palette
+    - SESSION_MSG_FRAME: u32 frame number, u32 sequence number of the last
+      input applied before the frame, followed by a palette-indexed frame
+      delta relative to the previous frame sent to this client (see
+      framedelta.h), the first frame is a keyframe
+    - SESSION_MSG_AUDIO: mono s16 samples
+
+    Client to server:
+
+    - SESSION_MSG_INPUT: u32 input sequence number, u8 input type, u8 value
+      (key code, or SESSION_JOYSTICK_* mask)
+*/
+#include <stdint.h>
+#include <stddef.h>
+
+#define SESSION_HEADER_SIZE (8)
+#define SESSION_MAX_PAYLOAD (1<<20)
+
+#define SESSION_MSG_HELLO (1)
+#define SESSION_MSG_FRAME (2)
+#define SESSION_MSG_AUDIO (3)
+#define SESSION_MSG_INPUT (16)
+
+#define SESSION_INPUT_KEY_DOWN (1)
+#define SESSION_INPUT_KEY_UP (2)
+#define SESSION_INPUT_JOYSTICK (3)
+
+#define SESSION_JOYSTICK_UP     (1<<0)
+#define SESSION_JOYSTICK_DOWN   (1<<1)
+#define SESSION_JOYSTICK_LEFT   (1<<2)
+#define SESSION_JOYSTICK_RIGHT  (1<<3)
+#define SESSION_JOYSTICK_FIRE   (1<<4)
+
+static inline void session_put_u16(uint8_t* dst, uint32_t val) {
+    dst[0] = (uint8_t)val;
+    dst[1] = (uint8_t)(val >> 8);
+}
+
+static inline void session_put_u32(uint8_t* dst, uint32_t val) {
+    dst[0] = (uint8_t)val;
+    dst[1] = (uint8_t)(val >> 8);
+    dst[2] = (uint8_t)(val >> 16);
+    dst[3] = (uint8_t)(val >> 24);
+}
+
+static inline uint32_t session_get_u16(const uint8_t* src) {
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8);
+}
+
+static inline uint32_t session_get_u32(const uint8_t* src) {
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static inline void session_put_header(uint8_t* dst, uint8_t type, uint32_t size) {
+    dst[0] = type;
+    dst[1] = dst[2] = dst[3] = 0;
+    session_put_u32(&dst[4], size);
+}
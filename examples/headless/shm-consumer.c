@@ -0,0 +1,183 @@
+//------------------------------------------------------------------------------
+//  shm-consumer.c
+//
+//  Reference consumer for the shared-memory frame and audio export (see
+//  shmexport.h), start an emulator with shm=[name] first. Frames and audio
+//  blocks are read directly from the shared memory (zero-copy), the tool
+//  reports the received frame rate, dropped frames and the latency from
+//  publishing to reading, and can record the raw frames and audio.
+//
+//  Command line args:
+//
+//  shm=[name]      shared-memory object name (default: /chips-c64)
+//  seconds=[num]   stop after a number of seconds (default: run until Ctrl-C)
+//  video=[path]    append the raw frames (width*height palette indices or RGBA8)
+//  audio=[path]    append the raw audio samples (mono 32-bit float)
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include "shmexport.h"
+#define SOKOL_ARGS_IMPL
+#include "sokol_args.h"
+
+#define POLL_USEC (1000)
+#define REPORT_SEC (1.0)
+
+static int quit_requested = 0;
+static void catch_sigint(int signo) {
+    (void)signo;
+    quit_requested = 1;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static struct {
+    uint64_t frames;
+    uint64_t dropped;
+    uint64_t audio_blocks;
+    uint64_t audio_dropped;
+    uint64_t samples;
+    double latency_us;
+    double max_latency_us;
+    uint32_t checksum;
+} stats;
+
+static void print_stats(const char* prefix, double seconds) {
+    printf("%s %.1f fps, %llu frames (%llu dropped), %.0f samples/s (%llu blocks dropped), latency avg %.1f us max %.1f us, checksum %08X\n",
+        prefix,
+        stats.frames / seconds,
+        (unsigned long long)stats.frames, (unsigned long long)stats.dropped,
+        stats.samples / seconds, (unsigned long long)stats.audio_dropped,
+        stats.frames ? (stats.latency_us / stats.frames) : 0.0, stats.max_latency_us,
+        stats.checksum);
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    sargs_setup(&(sargs_desc){ .argc=argc, .argv=argv });
+    const char* name = sargs_value_def("shm", "/chips-c64");
+    const double max_seconds = atof(sargs_value_def("seconds", "0"));
+    FILE* video_fp = sargs_exists("video") ? fopen(sargs_value("video"), "wb") : 0;
+    FILE* audio_fp = sargs_exists("audio") ? fopen(sargs_value("audio"), "wb") : 0;
+
+    const shmexport_header_t* hdr = 0;
+    while (!(hdr = shmexport_attach(name))) {
+        printf("== waiting for '%s'...\n", name);
+        fflush(stdout);
+        sleep(1);
+    }
+    printf("== attached to '%s' (%u bytes, %u Hz)\n", name, hdr->size, hdr->sample_rate);
+    signal(SIGINT, catch_sigint);
+
+    // start with the next published frame and audio block
+    uint64_t frame_seq = shmexport_frame_seq(hdr) + 1;
+    uint64_t audio_seq = shmexport_audio_seq(hdr) + 1;
+    const uint64_t start_ns = now_ns();
+    uint64_t report_ns = start_ns;
+    while (!quit_requested) {
+        bool idle = true;
+        // skip frames which have already been overwritten
+        const uint64_t last_frame_seq = shmexport_frame_seq(hdr);
+        if ((last_frame_seq >= frame_seq) && ((last_frame_seq - frame_seq) >= SHMEXPORT_NUM_FRAME_SLOTS)) {
+            stats.dropped += last_frame_seq - frame_seq + 1 - SHMEXPORT_NUM_FRAME_SLOTS;
+            frame_seq = last_frame_seq + 1 - SHMEXPORT_NUM_FRAME_SLOTS;
+        }
+        while (frame_seq <= shmexport_frame_seq(hdr)) {
+            idle = false;
+            const shmexport_frame_t* frame = shmexport_frame_begin(hdr, frame_seq);
+            if (frame) {
+                const double latency_us = (now_ns() - frame->time_ns) / 1000.0;
+                const uint8_t* pixels = shmexport_frame_pixels(frame);
+                // the size may be torn, it's only trusted after shmexport_frame_end()
+                size_t size = (size_t)frame->width * frame->height * frame->bytes_per_pixel;
+                if (size > (hdr->frame_slot_size - sizeof(shmexport_frame_t))) {
+                    size = 0;
+                }
+                uint32_t checksum = stats.checksum;
+                for (size_t i = 0; i < size; i += 64) {
+                    checksum = (checksum * 31) + pixels[i];
+                }
+                // written straight from the shared memory, the producer only
+                // laps this loop if the consumer is a whole ring behind
+                if (video_fp) {
+                    fwrite(pixels, size, 1, video_fp);
+                }
+                if (shmexport_frame_end(frame, frame_seq)) {
+                    stats.frames++;
+                    stats.checksum = checksum;
+                    stats.latency_us += latency_us;
+                    if (latency_us > stats.max_latency_us) {
+                        stats.max_latency_us = latency_us;
+                    }
+                }
+                else {
+                    stats.dropped++;
+                }
+            }
+            else {
+                stats.dropped++;
+            }
+            frame_seq++;
+        }
+        const uint64_t last_audio_seq = shmexport_audio_seq(hdr);
+        if ((last_audio_seq >= audio_seq) && ((last_audio_seq - audio_seq) >= SHMEXPORT_NUM_AUDIO_SLOTS)) {
+            stats.audio_dropped += last_audio_seq - audio_seq + 1 - SHMEXPORT_NUM_AUDIO_SLOTS;
+            audio_seq = last_audio_seq + 1 - SHMEXPORT_NUM_AUDIO_SLOTS;
+        }
+        while (audio_seq <= shmexport_audio_seq(hdr)) {
+            idle = false;
+            const shmexport_audio_t* audio = shmexport_audio_begin(hdr, audio_seq);
+            if (audio) {
+                uint32_t num_samples = audio->num_samples;
+                if (num_samples > SHMEXPORT_MAX_AUDIO_SAMPLES) {
+                    num_samples = 0;
+                }
+                if (audio_fp) {
+                    fwrite(audio->samples, sizeof(float), num_samples, audio_fp);
+                }
+                if (shmexport_audio_end(audio, audio_seq)) {
+                    stats.audio_blocks++;
+                    stats.samples += num_samples;
+                }
+                else {
+                    stats.audio_dropped++;
+                }
+            }
+            else {
+                stats.audio_dropped++;
+            }
+            audio_seq++;
+        }
+        const uint64_t t = now_ns();
+        const double seconds = (t - start_ns) / 1.0e9;
+        if ((max_seconds > 0.0) && (seconds >= max_seconds)) {
+            break;
+        }
+        if (((t - report_ns) / 1.0e9) >= REPORT_SEC) {
+            report_ns = t;
+            print_stats("==", seconds);
+        }
+        if (idle) {
+            usleep(POLL_USEC);
+        }
+    }
+    print_stats("== total:", (now_ns() - start_ns) / 1.0e9);
+    if (video_fp) {
+        fclose(video_fp);
+    }
+    if (audio_fp) {
+        fclose(audio_fp);
+    }
+    shmexport_detach(hdr);
+    sargs_shutdown();
+    return 0;
+}
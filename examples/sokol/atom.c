@@ -97,6 +97,13 @@ atom_desc_t atom_desc(atom_joystick_type_t joy_type) {
     };
 }
 
+static void send_keybuf_input(uint32_t micro_seconds);
+
+// run the emulator for one exec slice (see slice.h)
+static uint32_t exec_slice(uint32_t micro_seconds) {
+    return atom_exec(&state.atom, micro_seconds);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
@@ -111,6 +118,10 @@ void app_init(void) {
     atom_init(&state.atom, &desc);
     gfx_init(&(gfx_desc_t) {
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .framehash = {
+            .golden_path = sargs_value("golden"),
+            .golden_record = sargs_exists("golden-record"),
+        },
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -125,6 +136,12 @@ void app_init(void) {
     keybuf_init(&(keybuf_desc_t){ .key_delay_frames = 10 });
     clock_init();
     prof_init();
+    slice_init(&(slice_desc_t){
+        .slice_us = (uint32_t)atoi(sargs_value_def("slice", "0")),
+        .exec_cb = exec_slice,
+        .freq_hz = ATOM_FREQUENCY,
+        .between_cb = send_keybuf_input,
+    });
     fs_init();
     #ifdef CHIPS_USE_UI
         ui_init(&(ui_desc_t){
@@ -172,18 +189,16 @@ void app_init(void) {
 }
 
 static void handle_file_loading(void);
-static void send_keybuf_input(void);
 static void draw_status_bar(void);
 
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = atom_exec(&state.atom, state.frame_time_us);
+    state.ticks = slice_exec(state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
     draw_status_bar();
     gfx_draw(atom_display_info(&state.atom));
     handle_file_loading();
-    send_keybuf_input();
 }
 
 /* keyboard input handling */
@@ -253,11 +268,15 @@ void app_cleanup(void) {
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
+    // report a failed golden-image test in the exit code
+    if (framehash_golden_result() == FRAMEHASH_GOLDEN_FAILED) {
+        exit(10);
+    }
 }
 
-static void send_keybuf_input(void) {
+static void send_keybuf_input(uint32_t micro_seconds) {
     uint8_t key_code;
-    if (0 != (key_code = keybuf_get(state.frame_time_us))) {
+    if (0 != (key_code = keybuf_get(micro_seconds))) {
         atom_key_down(&state.atom, key_code);
         atom_key_up(&state.atom, key_code);
     }
@@ -299,6 +318,7 @@ static void draw_status_bar(void) {
     sdtx_color3b(255, 255, 255);
     sdtx_pos(1.0f, (h / 8.0f) - 1.5f);
     sdtx_printf("frame:%.2fms emu:%.2fms (min:%.2fms max:%.2fms) ticks:%d", (float)state.frame_time_us * 0.001f, emu_stats.avg_val, emu_stats.min_val, emu_stats.max_val, state.ticks);
+    slice_draw_stats(1.0f, (h / 8.0f) - 2.5f);
 }
 
 #if defined(CHIPS_USE_UI)
@@ -17,6 +17,10 @@
 #include "systems/c64.h"
 #include "c64-roms.h"
 #include "c1541-roms.h"
+#include "d64.h"
+#include "c64tape.h"
+#include "snapshot.h"
+#include "shmexport.h"
 #if defined(CHIPS_USE_UI)
     #define UI_DBG_USE_M6502
     #include "ui.h"
@@ -35,19 +39,50 @@
     #include "ui/ui_kbd.h"
     #include "ui/ui_snapshot.h"
     #include "ui/ui_c64.h"
+    #include "c64-snapshot.h"
 #endif
 #include <stdlib.h>
+#include <string.h>
 
 typedef struct {
     uint32_t version;
     c64_t c64;
 } c64_snapshot_t;
 
+// snapshots in storage are a header followed by the packed c64_t
+typedef struct {
+    uint32_t version;
+    uint32_t size;
+    uint32_t flags;
+} c64_snapshot_header_t;
+
+// the C1541 ROM isn't stored, so a snapshot only loads with the same drive config
+#define C64_SNAPSHOT_FLAG_C1541 (1<<0)
+
 static struct {
     c64_t c64;
     uint32_t frame_time_us;
     uint32_t ticks;
     double emu_time_ms;
+    bool fastload;
+    struct {
+        bool enabled;
+        bool active;
+        bool stopped;
+        bool trapped;
+        #if defined(CHIPS_USE_UI)
+            chips_debug_t ui_debug;
+        #endif
+    } vdrive;
+    struct {
+        bool active;
+        bool reached;
+        uint16_t addr;
+    } keybuf_pc;
+    struct {
+        bool active;
+        uint16_t v_count;
+    } shm;
     #ifdef CHIPS_USE_UI
         ui_c64_t ui;
         struct {
@@ -55,6 +90,7 @@ static struct {
             uint32_t exit_addr;
         } dbg;
         c64_snapshot_t snapshots[UI_SNAPSHOT_MAX_SLOTS];
+        snapshot_layout_t snapshot_layout;
     #endif
 } state;
 
@@ -93,11 +129,16 @@ static void web_dbg_read_memory(uint16_t addr, int num_bytes, uint8_t* dst_ptr);
 #define BORDER_RIGHT (8)
 #define BORDER_BOTTOM (16)
 #define LOAD_DELAY_FRAMES (180)
+#define KERNAL_LOAD_ADDR (0xF4A5)   // LOAD routine behind the ILOAD vector
 
 // audio-streaming callback
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // mute while fast-forwarding through tape loading
+    if (!slice_warping()) {
+        saudio_push(samples, num_samples);
+    }
+    shmexport_audio(samples, num_samples);
 }
 
 // get c64_desc_t struct based on joystick type
@@ -125,6 +166,163 @@ c64_desc_t c64_desc(c64_joystick_type_t joy_type, bool c1530_enabled, bool c1541
     };
 }
 
+static void send_keybuf_input(uint32_t micro_seconds);
+static bool keybuf_pc_reached(uint16_t addr, void* user_data);
+static uint8_t keybuf_mem_rd(uint16_t addr, void* user_data);
+static bool keybuf_screen_contains(const char* text, void* user_data);
+
+static uint8_t vdrive_mem_read(uint16_t addr, void* user_data) {
+    (void)user_data;
+    return mem_rd(&state.c64.mem_cpu, addr);
+}
+
+static void vdrive_mem_write(uint16_t addr, uint8_t data, void* user_data) {
+    (void)user_data;
+    mem_wr(&state.c64.mem_cpu, addr, data);
+}
+
+// the virtual drive replaces the 1541 when a disk is inserted and
+// true-drive emulation is off
+static bool vdrive_active(void) {
+    return state.vdrive.enabled && d64_inserted() && !state.c64.c1541.valid;
+}
+
+// check for 'STA $93; LDA #$00' at the start of the KERNAL LOAD routine,
+// so that the trap only triggers when the KERNAL ROM is mapped
+static bool vdrive_load_mapped(void) {
+    return (mem_rd(&state.c64.mem_cpu, KERNAL_LOAD_ADDR + 0) == 0x85) &&
+           (mem_rd(&state.c64.mem_cpu, KERNAL_LOAD_ADDR + 1) == 0x93) &&
+           (mem_rd(&state.c64.mem_cpu, KERNAL_LOAD_ADDR + 2) == 0xA9) &&
+           (mem_rd(&state.c64.mem_cpu, KERNAL_LOAD_ADDR + 3) == 0x00);
+}
+
+// per-tick debug callback while the virtual drive is active, the keybuf
+// waits for a program counter, or frames are exported: stops execution at
+// the opcode fetch of the KERNAL LOAD routine when loading from device 8,
+// records when the keybuf's program counter is reached, and publishes the
+// framebuffer when the VIC raster wraps around to the first line
+static void exec_trap_cb(void* user_data, uint64_t pins) {
+    (void)user_data;
+    #if defined(CHIPS_USE_UI)
+        state.vdrive.ui_debug.callback.func(state.vdrive.ui_debug.callback.user_data, pins);
+        state.vdrive.stopped = *state.vdrive.ui_debug.stopped;
+    #endif
+    if (state.shm.active) {
+        const uint16_t v_count = state.c64.vic.rs.v_count;
+        if (v_count < state.shm.v_count) {
+            shmexport_frame(c64_display_info(&state.c64));
+        }
+        state.shm.v_count = v_count;
+    }
+    if (!state.vdrive.stopped && (pins & M6502_SYNC)) {
+        const uint16_t addr = M6502_GET_ADDR(pins);
+        if (state.keybuf_pc.active && (addr == state.keybuf_pc.addr)) {
+            state.keybuf_pc.reached = true;
+        }
+        if (state.vdrive.active && (addr == KERNAL_LOAD_ADDR)) {
+            if ((mem_rd(&state.c64.mem_cpu, 0xBA) == 8) && vdrive_load_mapped()) {
+                state.vdrive.trapped = true;
+                state.vdrive.stopped = true;
+            }
+        }
+    }
+}
+
+// perform the KERNAL LOAD from the inserted disk, and return to the caller
+static void vdrive_load(void) {
+    m6502_t* cpu = &state.c64.cpu;
+    mem_t* mem = &state.c64.mem_cpu;
+    uint8_t name[16];
+    int name_len = mem_rd(mem, 0xB7);
+    if (name_len > 16) {
+        name_len = 16;
+    }
+    const uint16_t name_addr = mem_rd(mem, 0xBB) | (mem_rd(mem, 0xBC) << 8);
+    for (int i = 0; i < name_len; i++) {
+        name[i] = mem_rd(mem, (uint16_t)(name_addr + i));
+    }
+    const d64_load_result_t res = d64_load(&(d64_load_t){
+        .name = name,
+        .name_len = name_len,
+        .use_file_addr = 0 != mem_rd(mem, 0xB9),
+        .addr = mem_rd(mem, 0xC3) | (mem_rd(mem, 0xC4) << 8),
+        .verify = 0 != cpu->A,
+        .read_cb = vdrive_mem_read,
+        .write_cb = vdrive_mem_write,
+    });
+    // verify flag, status and end address like the KERNAL serial LOAD
+    mem_wr(mem, 0x93, cpu->A);
+    if (res.error == D64_LOAD_OK) {
+        mem_wr(mem, 0x90, 0x40 | (res.verify_error ? 0x10 : 0x00));
+        mem_wr(mem, 0xAE, (uint8_t)res.end_addr);
+        mem_wr(mem, 0xAF, (uint8_t)(res.end_addr >> 8));
+        cpu->X = (uint8_t)res.end_addr;
+        cpu->Y = (uint8_t)(res.end_addr >> 8);
+        cpu->P &= ~M6502_CF;
+    }
+    else {
+        cpu->A = (uint8_t)res.error;
+        cpu->P |= M6502_CF;
+    }
+    // RTS
+    cpu->S++;
+    const uint8_t l = mem_rd(mem, 0x0100 | cpu->S++);
+    const uint8_t h = mem_rd(mem, 0x0100 | cpu->S);
+    const uint16_t ret_addr = (uint16_t)(((h << 8) | l) + 1);
+    M6502_SET_ADDR(state.c64.pins, ret_addr);
+    M6502_SET_DATA(state.c64.pins, mem_rd(mem, ret_addr));
+    state.c64.pins |= M6502_SYNC|M6502_RW;
+    cpu->PC = ret_addr;
+}
+
+// run the emulator for one exec slice (see slice.h)
+static uint32_t exec_slice(uint32_t micro_seconds) {
+    uint16_t keybuf_pc;
+    if (keybuf_wait_pc(&keybuf_pc)) {
+        // a new wait must see the address again
+        if (!state.keybuf_pc.active || (state.keybuf_pc.addr != keybuf_pc)) {
+            state.keybuf_pc.reached = false;
+        }
+        state.keybuf_pc.active = true;
+        state.keybuf_pc.addr = keybuf_pc;
+    }
+    else {
+        state.keybuf_pc.active = false;
+    }
+    state.vdrive.active = vdrive_active();
+    state.shm.active = shmexport_active();
+    if (!state.vdrive.active && !state.keybuf_pc.active && !state.shm.active) {
+        return c64_exec(&state.c64, micro_seconds);
+    }
+    // install the LOAD, program counter and frame export traps, chained with the UI debugger
+    const chips_debug_t debug = state.c64.debug;
+    #if defined(CHIPS_USE_UI)
+        state.vdrive.ui_debug = ui_c64_get_debug(&state.ui);
+        state.vdrive.stopped = *state.vdrive.ui_debug.stopped;
+    #else
+        state.vdrive.stopped = false;
+    #endif
+    state.c64.debug = (chips_debug_t){
+        .callback = { .func = exec_trap_cb },
+        .stopped = &state.vdrive.stopped,
+    };
+    // the rest of the slice is skipped after a trap, loading a file
+    // takes no emulated time anyway
+    const uint32_t ticks = c64_exec(&state.c64, micro_seconds);
+    state.c64.debug = debug;
+    if (state.vdrive.trapped) {
+        state.vdrive.trapped = false;
+        vdrive_load();
+    }
+    return ticks;
+}
+
+// fast-forward while the datasette motor is on, this makes tape loading
+// (including turbo loaders) take a few seconds instead of minutes
+static bool fastload_active(void) {
+    return state.fastload && state.c64.c1530.valid && c64_is_tape_motor_on(&state.c64);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
@@ -145,6 +343,10 @@ void app_init(void) {
     c64_init(&state.c64, &desc);
     gfx_init(&(gfx_desc_t){
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .framehash = {
+            .golden_path = sargs_value("golden"),
+            .golden_record = sargs_exists("golden-record"),
+        },
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -156,10 +358,37 @@ void app_init(void) {
         },
         .display_info = c64_display_info(&state.c64),
     });
-    keybuf_init(&(keybuf_desc_t){ .key_delay_frames=5 });
+    // optionally publish frames and audio to other processes
+    if (sargs_exists("shm")) {
+        const char* shm_name = sargs_value("shm");
+        shmexport_init(&(shmexport_desc_t){
+            .name = shm_name[0] ? shm_name : "/chips-c64",
+            .display_info = c64_display_info(&state.c64),
+            .sample_rate = saudio_sample_rate(),
+        });
+    }
+    keybuf_init(&(keybuf_desc_t){
+        .key_delay_frames = 5,
+        .sys = {
+            .pc_reached = keybuf_pc_reached,
+            .mem_rd = keybuf_mem_rd,
+            .screen_contains = keybuf_screen_contains,
+        },
+    });
     clock_init();
     prof_init();
+    slice_init(&(slice_desc_t){
+        .slice_us = (uint32_t)atoi(sargs_value_def("slice", "0")),
+        .exec_cb = exec_slice,
+        .freq_hz = C64_FREQUENCY,
+        .between_cb = send_keybuf_input,
+        .warp_cb = fastload_active,
+    });
+    state.fastload = !sargs_exists("disable-fastload");
     fs_init();
+    d64_init();
+    c64tape_init();
+    state.vdrive.enabled = !sargs_exists("disable-vdrive");
     #ifdef CHIPS_USE_UI
         ui_init(&(ui_desc_t){
             .draw_cb = ui_draw_cb,
@@ -197,6 +426,7 @@ void app_init(void) {
             }
         });
         ui_c64_load_settings(&state.ui, ui_settings());
+        state.snapshot_layout = snapshot_layout(sizeof(c64_t), c64_snapshot_exclude, C64_SNAPSHOT_NUM_EXCLUDE);
         ui_load_snapshots_from_storage();
         // important: initialize webapi after ui
         webapi_init(&(webapi_desc_t){
@@ -236,18 +466,16 @@ void app_init(void) {
 }
 
 static void handle_file_loading(void);
-static void send_keybuf_input(void);
 static void draw_status_bar(void);
 
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = c64_exec(&state.c64, state.frame_time_us);
+    state.ticks = slice_exec(state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
     draw_status_bar();
     gfx_draw(c64_display_info(&state.c64));
     handle_file_loading();
-    send_keybuf_input();
 }
 
 void app_input(const sapp_event* event) {
@@ -313,6 +541,7 @@ void app_input(const sapp_event* event) {
 
 void app_cleanup(void) {
     c64_discard(&state.c64);
+    shmexport_shutdown();
     #ifdef CHIPS_USE_UI
         ui_c64_discard(&state.ui);
         ui_discard();
@@ -320,11 +549,15 @@ void app_cleanup(void) {
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
+    // report a failed golden-image test in the exit code
+    if (framehash_golden_result() == FRAMEHASH_GOLDEN_FAILED) {
+        exit(10);
+    }
 }
 
-static void send_keybuf_input(void) {
+static void send_keybuf_input(uint32_t micro_seconds) {
     uint8_t key_code;
-    if (0 != (key_code = keybuf_get(state.frame_time_us))) {
+    if (0 != (key_code = keybuf_get(micro_seconds))) {
         /* FIXME: this is ugly */
         c64_joystick_type_t joy_type = state.c64.joystick_type;
         state.c64.joystick_type = C64_JOYSTICKTYPE_NONE;
@@ -334,6 +567,57 @@ static void send_keybuf_input(void) {
     }
 }
 
+// keybuf callbacks for the ${waitpc:}, ${waitmem:} and ${waitscreen:} commands
+static bool keybuf_pc_reached(uint16_t addr, void* user_data) {
+    (void)user_data;
+    if (state.keybuf_pc.reached && (state.keybuf_pc.addr == addr)) {
+        // a following wait for the same address must see it again
+        state.keybuf_pc.active = false;
+        state.keybuf_pc.reached = false;
+        return true;
+    }
+    return false;
+}
+
+static uint8_t keybuf_mem_rd(uint16_t addr, void* user_data) {
+    (void)user_data;
+    return mem_rd(&state.c64.mem_cpu, addr);
+}
+
+// search the 40x25 text screen (the VIC's current video matrix), screen codes
+// are converted to ASCII for the uppercase/graphics character set
+static bool keybuf_screen_contains(const char* text, void* user_data) {
+    (void)user_data;
+    char upper[64];
+    size_t len = 0;
+    for (; text[len] && (len < (sizeof(upper) - 1)); len++) {
+        upper[len] = (char)toupper((unsigned char)text[len]);
+    }
+    upper[len] = 0;
+    const uint16_t screen_addr = (uint16_t)((state.c64.vic.reg.mem_ptrs & 0xF0) << 6);
+    char screen[40 * 25 + 1];
+    for (int i = 0; i < (40 * 25); i++) {
+        const uint8_t c = mem_rd(&state.c64.mem_vic, (uint16_t)(screen_addr + i)) & 0x7F;
+        screen[i] = (c < 0x20) ? (char)(c + 0x40) : ((c < 0x40) ? (char)c : 0x7F);
+    }
+    screen[40 * 25] = 0;
+    return 0 != strstr(screen, upper);
+}
+
+// load the first PRG file from an inserted disk image into memory
+static bool d64_quickload(void) {
+    static uint8_t buf[D64_MAX_FILE_SIZE];
+    d64_dir_entry_t entry;
+    if (!d64_find_file(0, 0, &entry)) {
+        return false;
+    }
+    const int size = d64_read_file(&entry, buf, sizeof(buf));
+    if (size <= 2) {
+        return false;
+    }
+    return c64_quickload(&state.c64, (chips_range_t){ .ptr = buf, .size = (size_t)size });
+}
+
 static void handle_file_loading(void) {
     fs_dowork();
     const uint32_t load_delay_frames = LOAD_DELAY_FRAMES;
@@ -344,6 +628,10 @@ static void handle_file_loading(void) {
             keybuf_put((const char*)fs_data(FS_CHANNEL_IMAGES).ptr);
         } else if (fs_ext(FS_CHANNEL_IMAGES, "tap")) {
             load_success = c64_insert_tape(&state.c64, fs_data(FS_CHANNEL_IMAGES));
+            // only used for the block index, the datasette plays the original image
+            c64tape_insert(fs_data(FS_CHANNEL_IMAGES));
+        } else if (fs_ext(FS_CHANNEL_IMAGES, "d64") || fs_ext(FS_CHANNEL_IMAGES, "g64")) {
+            load_success = d64_insert(fs_data(FS_CHANNEL_IMAGES)) && d64_quickload();
         } else if (fs_ext(FS_CHANNEL_IMAGES, "bin") || fs_ext(FS_CHANNEL_IMAGES, "prg") || fs_ext(FS_CHANNEL_IMAGES, "")) {
             load_success = c64_quickload(&state.c64, fs_data(FS_CHANNEL_IMAGES));
         }
@@ -359,7 +647,7 @@ static void handle_file_loading(void) {
                     keybuf_put(sargs_value("input"));
                 } else if (fs_ext(FS_CHANNEL_IMAGES, "tap")) {
                     c64_basic_load(&state.c64);
-                } else if (fs_ext(FS_CHANNEL_IMAGES, "prg")) {
+                } else if (fs_ext(FS_CHANNEL_IMAGES, "prg") || fs_ext(FS_CHANNEL_IMAGES, "d64") || fs_ext(FS_CHANNEL_IMAGES, "g64")) {
                     c64_basic_run(&state.c64);
                 }
             }
@@ -379,6 +667,13 @@ static void draw_status_bar(void) {
     sdtx_color3b(255, 255, 255);
     sdtx_pos(1.0f, (h / 8.0f) - 1.5f);
     sdtx_printf("frame:%.2fms emu:%.2fms (min:%.2fms max:%.2fms) ticks:%d", (float)state.frame_time_us * 0.001f, emu_stats.avg_val, emu_stats.min_val, emu_stats.max_val, state.ticks);
+    if (c64tape_inserted() && state.c64.c1530.valid) {
+        sdtx_printf(" tape:%d/%d", c64tape_block_at_offset(state.c64.c1530.pos) + 1, c64tape_status().num_blocks);
+    }
+    if (slice_warp_frames() > 0) {
+        sdtx_printf(" FAST:x%d", slice_warp_frames() + 1);
+    }
+    slice_draw_stats(1.0f, (h / 8.0f) - 2.5f);
 }
 
 #if defined(CHIPS_USE_UI)
@@ -412,7 +707,13 @@ static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = c64_save_snapshot(&state.c64, &state.snapshots[slot].c64);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("c64", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(c64_snapshot_t) });
+        // only the mutable state goes into storage
+        static uint8_t buf[sizeof(c64_snapshot_header_t) + sizeof(c64_t)];
+        c64_snapshot_header_t* hdr = (c64_snapshot_header_t*)buf;
+        hdr->version = state.snapshots[slot].version;
+        hdr->flags = state.snapshots[slot].c64.c1541.valid ? C64_SNAPSHOT_FLAG_C1541 : 0;
+        hdr->size = (uint32_t)snapshot_pack(&state.snapshot_layout, &state.snapshots[slot].c64, buf + sizeof(c64_snapshot_header_t), sizeof(c64_t));
+        fs_save_snapshot("c64", slot, (chips_range_t){ .ptr = buf, .size = sizeof(c64_snapshot_header_t) + hdr->size });
     }
 }
 
@@ -429,15 +730,28 @@ static void ui_fetch_snapshot_callback(const fs_snapshot_response_t* response) {
     if (response->result != FS_RESULT_SUCCESS) {
         return;
     }
-    if (response->data.size != sizeof(c64_snapshot_t)) {
+    if (response->data.size < sizeof(c64_snapshot_header_t)) {
+        return;
+    }
+    const c64_snapshot_header_t* hdr = (const c64_snapshot_header_t*)response->data.ptr;
+    if (hdr->version != C64_SNAPSHOT_VERSION) {
+        return;
+    }
+    if ((hdr->size != state.snapshot_layout.packed_size) || (response->data.size != (sizeof(c64_snapshot_header_t) + hdr->size))) {
         return;
     }
-    if (((c64_snapshot_t*)response->data.ptr)->version != C64_SNAPSHOT_VERSION) {
+    if ((0 != (hdr->flags & C64_SNAPSHOT_FLAG_C1541)) != state.c64.c1541.valid) {
         return;
     }
     size_t snapshot_slot = response->snapshot_index;
     assert(snapshot_slot < UI_SNAPSHOT_MAX_SLOTS);
-    memcpy(&state.snapshots[snapshot_slot], response->data.ptr, response->data.size);
+    // the excluded state comes from the running instance
+    c64_snapshot_t* snapshot = &state.snapshots[snapshot_slot];
+    c64_save_snapshot(&state.c64, &snapshot->c64);
+    snapshot_unpack(&state.snapshot_layout, hdr + 1, hdr->size, &snapshot->c64);
+    snapshot->version = hdr->version;
+    // the framebuffer isn't stored, the screenshot stays blank until the snapshot is loaded
+    memset(snapshot->c64.fb, 0, sizeof(snapshot->c64.fb));
     ui_update_snapshot_screenshot(snapshot_slot);
 }
 
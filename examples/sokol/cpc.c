@@ -53,6 +53,7 @@ static struct {
     uint32_t frame_time_us;
     uint32_t ticks;
     double emu_time_ms;
+    bool fastload;
     #if defined(CHIPS_USE_UI)
         ui_cpc_t ui;
         struct {
@@ -107,7 +108,10 @@ static void web_dbg_read_memory(uint16_t addr, int num_bytes, uint8_t* dst_ptr);
 // audio-streaming callback
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // mute while fast-forwarding through disc loading
+    if (!slice_warping()) {
+        saudio_push(samples, num_samples);
+    }
 }
 
 // get cpc_desc_t struct based on model and joystick type
@@ -140,6 +144,19 @@ cpc_desc_t cpc_desc(cpc_type_t type, cpc_joystick_type_t joy_type) {
     };
 }
 
+static void send_keybuf_input(uint32_t micro_seconds);
+
+// run the emulator for one exec slice (see slice.h)
+static uint32_t exec_slice(uint32_t micro_seconds) {
+    return cpc_exec(&state.cpc, micro_seconds);
+}
+
+// fast-forward while the disc drive motor is on, the CPU spends disc
+// loading in FDC polling loops, so this makes loading near-instant
+static bool fastload_active(void) {
+    return state.fastload && state.cpc.fdd.motor_on;
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
@@ -160,6 +177,10 @@ void app_init(void) {
     cpc_init(&state.cpc, &desc);
     gfx_init(&(gfx_desc_t){
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .framehash = {
+            .golden_path = sargs_value("golden"),
+            .golden_record = sargs_exists("golden-record"),
+        },
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -178,6 +199,14 @@ void app_init(void) {
     keybuf_init(&(keybuf_desc_t) { .key_delay_frames=7 });
     clock_init();
     prof_init();
+    slice_init(&(slice_desc_t){
+        .slice_us = (uint32_t)atoi(sargs_value_def("slice", "0")),
+        .exec_cb = exec_slice,
+        .freq_hz = CPC_FREQUENCY,
+        .between_cb = send_keybuf_input,
+        .warp_cb = fastload_active,
+    });
+    state.fastload = !sargs_exists("disable-fastload");
     fs_init();
     #ifdef CHIPS_USE_UI
         ui_init(&(ui_desc_t){
@@ -257,18 +286,16 @@ void app_init(void) {
 }
 
 static void handle_file_loading(void);
-static void send_keybuf_input(void);
 static void draw_status_bar(void);
 
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = cpc_exec(&state.cpc, state.frame_time_us);
+    state.ticks = slice_exec(state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
     draw_status_bar();
     gfx_draw(cpc_display_info(&state.cpc));
     handle_file_loading();
-    send_keybuf_input();
 }
 
 void app_input(const sapp_event* event) {
@@ -352,11 +379,15 @@ void app_cleanup(void) {
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
+    // report a failed golden-image test in the exit code
+    if (framehash_golden_result() == FRAMEHASH_GOLDEN_FAILED) {
+        exit(10);
+    }
 }
 
-static void send_keybuf_input(void) {
+static void send_keybuf_input(uint32_t micro_seconds) {
     uint8_t key_code;
-    if (0 != (key_code = keybuf_get(state.frame_time_us))) {
+    if (0 != (key_code = keybuf_get(micro_seconds))) {
         cpc_key_down(&state.cpc, key_code);
         cpc_key_up(&state.cpc, key_code);
     }
@@ -442,11 +473,15 @@ static void draw_status_bar(void) {
 
     sdtx_color1i(text_color);
     sdtx_printf("  TRACK:%d", state.cpc.fdd.cur_track_index);
+    if (slice_warp_frames() > 0) {
+        sdtx_printf("  FAST:x%d", slice_warp_frames() + 1);
+    }
 
     sdtx_font(0);
     sdtx_color1i(text_color);
     sdtx_pos(0.0f, 1.5f);
     sdtx_printf("frame:%.2fms emu:%.2fms (min:%.2fms max:%.2fms) ticks:%d", (float)state.frame_time_us * 0.001f, emu_stats.avg_val, emu_stats.min_val, emu_stats.max_val, state.ticks);
+    slice_draw_stats(0.0f, 2.5f);
 }
 
 #if defined(CHIPS_USE_UI)
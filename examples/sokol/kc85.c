@@ -159,12 +159,23 @@ kc85_desc_t kc85_desc(void) {
     };
 }
 
+static void send_keybuf_input(uint32_t micro_seconds);
+
+// run the emulator for one exec slice (see slice.h)
+static uint32_t exec_slice(uint32_t micro_seconds) {
+    return kc85_exec(&state.kc85, micro_seconds);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
     });
     gfx_init(&(gfx_desc_t) {
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .framehash = {
+            .golden_path = sargs_value("golden"),
+            .golden_record = sargs_exists("golden-record"),
+        },
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -179,6 +190,12 @@ void app_init(void) {
     keybuf_init(&(keybuf_desc_t){ .key_delay_frames = 10 });
     clock_init();
     prof_init();
+    slice_init(&(slice_desc_t){
+        .slice_us = (uint32_t)atoi(sargs_value_def("slice", "0")),
+        .exec_cb = exec_slice,
+        .freq_hz = KC85_FREQUENCY,
+        .between_cb = send_keybuf_input,
+    });
     fs_init();
     const kc85_desc_t desc = kc85_desc();
     kc85_init(&state.kc85, &desc);
@@ -289,17 +306,15 @@ void app_init(void) {
 }
 
 static void handle_file_loading(void);
-static void send_keybuf_input(void);
 static void draw_status_bar(void);
 
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = kc85_exec(&state.kc85, state.frame_time_us);
+    state.ticks = slice_exec(state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
     draw_status_bar();
     gfx_draw(kc85_display_info(&state.kc85));
-    send_keybuf_input();
     handle_file_loading();
 }
 
@@ -393,11 +408,15 @@ void app_cleanup(void) {
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
+    // report a failed golden-image test in the exit code
+    if (framehash_golden_result() == FRAMEHASH_GOLDEN_FAILED) {
+        exit(10);
+    }
 }
 
-static void send_keybuf_input(void) {
+static void send_keybuf_input(uint32_t micro_seconds) {
     uint8_t key_code;
-    if (0 != (key_code = keybuf_get(state.frame_time_us))) {
+    if (0 != (key_code = keybuf_get(micro_seconds))) {
         kc85_key_down(&state.kc85, key_code);
         kc85_key_up(&state.kc85, key_code);
     }
@@ -477,6 +496,7 @@ static void draw_status_bar(void) {
     sdtx_pos(0.0f, 1.5f);
     sdtx_color1i(text_color);
     sdtx_printf("frame:%.2fms emu:%.2fms (min:%.2fms max:%.2fms) ticks:%d", (float)state.frame_time_us * 0.001f, emu_stats.avg_val, emu_stats.min_val, emu_stats.max_val, state.ticks);
+    slice_draw_stats(0.0f, 2.5f);
 }
 
 #if defined(CHIPS_USE_UI)
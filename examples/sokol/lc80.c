@@ -72,6 +72,11 @@ static lc80_desc_t lc80_desc(void) {
     };
 }
 
+// run the emulator for one exec slice (see slice.h)
+static uint32_t exec_slice(uint32_t micro_seconds) {
+    return lc80_exec(&state.lc80, micro_seconds);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
@@ -87,6 +92,11 @@ void app_init(void) {
     });
     clock_init();
     prof_init();
+    slice_init(&(slice_desc_t){
+        .slice_us = (uint32_t)atoi(sargs_value_def("slice", "0")),
+        .exec_cb = exec_slice,
+        .freq_hz = LC80_FREQUENCY,
+    });
     fs_init();
 
     lc80_desc_t desc = lc80_desc();
@@ -127,7 +137,7 @@ static void draw_status_bar(void);
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = lc80_exec(&state.lc80, state.frame_time_us);
+    state.ticks = slice_exec(state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
     draw_status_bar();
     sg_begin_pass(&(sg_pass){ .swapchain = sglue_swapchain() });
@@ -160,6 +170,7 @@ static void draw_status_bar(void) {
     sdtx_color3b(255, 255, 255);
     sdtx_pos(1.0f, (h / 8.0f) - 1.5f);
     sdtx_printf("frame:%.2fms emu:%.2fms (min:%.2fms max:%.2fms) ticks:%d", (float)state.frame_time_us * 0.001f, emu_stats.avg_val, emu_stats.min_val, emu_stats.max_val, state.ticks);
+    slice_draw_stats(1.0f, (h / 8.0f) - 2.5f);
 }
 
 static void ui_boot_cb(lc80_t* sys) {
@@ -63,6 +63,11 @@ static void push_audio(const float* samples, int num_samples, void* user_data) {
     saudio_push(samples, num_samples);
 }
 
+// run the emulator for one exec slice (see slice.h)
+static uint32_t exec_slice(uint32_t micro_seconds) {
+    return namco_exec(&state.sys, micro_seconds);
+}
+
 static void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
@@ -94,6 +99,10 @@ static void app_init(void) {
     });
     gfx_init(&(gfx_desc_t) {
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .framehash = {
+            .golden_path = sargs_value("golden"),
+            .golden_record = sargs_exists("golden-record"),
+        },
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -111,6 +120,11 @@ static void app_init(void) {
     });
     clock_init();
     prof_init();
+    slice_init(&(slice_desc_t){
+        .slice_us = (uint32_t)atoi(sargs_value_def("slice", "0")),
+        .exec_cb = exec_slice,
+        .freq_hz = NAMCO_CPU_CLOCK,
+    });
     fs_init();
     #ifdef CHIPS_USE_UI
         ui_init(&(ui_desc_t){
@@ -152,7 +166,7 @@ static void draw_status_bar(void);
 static void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = namco_exec(&state.sys, state.frame_time_us);
+    state.ticks = slice_exec(state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
     draw_status_bar();
     gfx_draw(namco_display_info(&state.sys));
@@ -202,6 +216,10 @@ static void app_cleanup(void) {
     #endif
     saudio_shutdown();
     gfx_shutdown();
+    // report a failed golden-image test in the exit code
+    if (framehash_golden_result() == FRAMEHASH_GOLDEN_FAILED) {
+        exit(10);
+    }
 }
 
 static void draw_status_bar(void) {
@@ -213,6 +231,7 @@ static void draw_status_bar(void) {
     sdtx_color3b(255, 255, 255);
     sdtx_pos(1.0f, (h / 8.0f) - 1.5f);
     sdtx_printf("frame:%.2fms emu:%.2fms (min:%.2fms max:%.2fms) ticks:%d", (float)state.frame_time_us * 0.001f, emu_stats.avg_val, emu_stats.min_val, emu_stats.max_val, state.ticks);
+    slice_draw_stats(1.0f, (h / 8.0f) - 2.5f);
 }
 
 #if defined(CHIPS_USE_UI)
@@ -3,7 +3,9 @@
     ZX Spectrum 48/128 emulator.
     - contended memory timing not emulated
     - video decoding works with scanline accuracy, not cycle accuracy
-    - no tape or disc emulation
+    - tape loading (.tap and .tzx) only through a ROM LD-BYTES trap,
+      custom tape loaders don't work
+    - no disc emulation
 */
 #define CHIPS_IMPL
 #include "chips/chips_common.h"
@@ -16,6 +18,7 @@
 #include "chips/mem.h"
 #include "systems/zx.h"
 #include "zx-roms.h"
+#include "zxtape.h"
 #if defined(CHIPS_USE_UI)
     #define UI_DBG_USE_Z80
     #include "ui.h"
@@ -44,6 +47,13 @@ static struct {
     uint32_t frame_time_us;
     uint32_t ticks;
     double emu_time_ms;
+    struct {
+        bool stopped;
+        bool trapped;
+        #if defined(CHIPS_USE_UI)
+            chips_debug_t ui_debug;
+        #endif
+    } tape;
     #if defined(CHIPS_USE_UI)
         ui_zx_t ui;
         zx_snapshot_t snapshots[UI_SNAPSHOT_MAX_SLOTS];
@@ -91,12 +101,100 @@ zx_desc_t zx_desc(zx_type_t type, zx_joystick_type_t joy_type) {
     };
 }
 
+static void send_keybuf_input(uint32_t micro_seconds);
+
+static uint8_t tape_mem_read(uint16_t addr, void* user_data) {
+    (void)user_data;
+    return mem_rd(&state.zx.mem, addr);
+}
+
+static void tape_mem_write(uint16_t addr, uint8_t data, void* user_data) {
+    (void)user_data;
+    mem_wr(&state.zx.mem, addr, data);
+}
+
+// check for the start of 'INC D; EX AF,AF'; DEC D; DI' at 0x0556, so that
+// the trap only triggers when the 48K BASIC ROM is mapped
+static bool tape_ld_bytes_mapped(void) {
+    return (mem_rd(&state.zx.mem, ZXTAPE_LD_BYTES_ADDR + 0) == 0x14) &&
+           (mem_rd(&state.zx.mem, ZXTAPE_LD_BYTES_ADDR + 1) == 0x08) &&
+           (mem_rd(&state.zx.mem, ZXTAPE_LD_BYTES_ADDR + 2) == 0x15) &&
+           (mem_rd(&state.zx.mem, ZXTAPE_LD_BYTES_ADDR + 3) == 0xF3);
+}
+
+// per-tick debug callback while a tape is inserted, stops execution when
+// the next instruction is the first instruction of LD-BYTES
+static void tape_trap_cb(void* user_data, uint64_t pins) {
+    (void)user_data;
+    #if defined(CHIPS_USE_UI)
+        state.tape.ui_debug.callback.func(state.tape.ui_debug.callback.user_data, pins);
+        state.tape.stopped = *state.tape.ui_debug.stopped;
+    #endif
+    if (!state.tape.stopped && z80_opdone(&state.zx.cpu) && (Z80_GET_ADDR(pins) == ZXTAPE_LD_BYTES_ADDR) && tape_ld_bytes_mapped()) {
+        state.tape.trapped = true;
+        state.tape.stopped = true;
+    }
+}
+
+// perform LD-BYTES in one step, and return to the caller
+static void tape_ld_bytes(void) {
+    z80_t* cpu = &state.zx.cpu;
+    const zxtape_ld_bytes_result_t res = zxtape_ld_bytes(&(zxtape_ld_bytes_t){
+        .flag = cpu->a,
+        .verify = 0 == (cpu->f & Z80_CF),
+        .addr = cpu->ix,
+        .len = cpu->de,
+        .read_cb = tape_mem_read,
+        .write_cb = tape_mem_write,
+    });
+    cpu->ix = res.addr;
+    cpu->de = res.len;
+    cpu->a = res.parity;
+    cpu->f = res.success ? (cpu->f | Z80_CF) : (cpu->f & ~Z80_CF);
+    const uint16_t ret_addr = mem_rd(&state.zx.mem, cpu->sp) | (mem_rd(&state.zx.mem, cpu->sp + 1) << 8);
+    cpu->sp += 2;
+    cpu->wz = ret_addr;
+    state.zx.pins = z80_prefetch(cpu, ret_addr);
+}
+
+// run the emulator for one exec slice (see slice.h)
+static uint32_t exec_slice(uint32_t micro_seconds) {
+    if (!zxtape_has_data()) {
+        return zx_exec(&state.zx, micro_seconds);
+    }
+    // install the LD-BYTES trap, chained with the UI debugger
+    const chips_debug_t debug = state.zx.debug;
+    #if defined(CHIPS_USE_UI)
+        state.tape.ui_debug = ui_zx_get_debug(&state.ui);
+        state.tape.stopped = *state.tape.ui_debug.stopped;
+    #else
+        state.tape.stopped = false;
+    #endif
+    state.zx.debug = (chips_debug_t){
+        .callback = { .func = tape_trap_cb },
+        .stopped = &state.tape.stopped,
+    };
+    // the rest of the slice is skipped after a trap, loading a block
+    // takes no emulated time anyway
+    const uint32_t ticks = zx_exec(&state.zx, micro_seconds);
+    state.zx.debug = debug;
+    if (state.tape.trapped) {
+        state.tape.trapped = false;
+        tape_ld_bytes();
+    }
+    return ticks;
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
     });
     gfx_init(&(gfx_desc_t){
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .framehash = {
+            .golden_path = sargs_value("golden"),
+            .golden_record = sargs_exists("golden-record"),
+        },
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -111,7 +209,13 @@ void app_init(void) {
     keybuf_init(&(keybuf_desc_t){ .key_delay_frames=6 });
     clock_init();
     prof_init();
+    slice_init(&(slice_desc_t){
+        .slice_us = (uint32_t)atoi(sargs_value_def("slice", "0")),
+        .exec_cb = exec_slice,
+        .between_cb = send_keybuf_input,
+    });
     fs_init();
+    zxtape_init();
     zx_type_t type = ZX_TYPE_128;
     if (sargs_exists("type")) {
         if (sargs_equals("type", "zx48k")) {
@@ -178,18 +282,18 @@ void app_init(void) {
 }
 
 static void handle_file_loading(void);
-static void send_keybuf_input(void);
 static void draw_status_bar(void);
 
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = zx_exec(&state.zx, state.frame_time_us);
+    // the clock frequency depends on the model, which can change on reboot or snapshot loading
+    slice_set_freq((uint32_t)state.zx.freq_hz);
+    state.ticks = slice_exec(state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
     draw_status_bar();
     gfx_draw(zx_display_info(&state.zx));
     handle_file_loading();
-    send_keybuf_input();
 }
 
 void app_input(const sapp_event* event) {
@@ -249,11 +353,15 @@ void app_cleanup(void) {
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
+    // report a failed golden-image test in the exit code
+    if (framehash_golden_result() == FRAMEHASH_GOLDEN_FAILED) {
+        exit(10);
+    }
 }
 
-static void send_keybuf_input(void) {
+static void send_keybuf_input(uint32_t micro_seconds) {
     uint8_t key_code;
-    if (0 != (key_code = keybuf_get(state.frame_time_us))) {
+    if (0 != (key_code = keybuf_get(micro_seconds))) {
         zx_key_down(&state.zx, key_code);
         zx_key_up(&state.zx, key_code);
     }
@@ -265,10 +373,15 @@ static void handle_file_loading(void) {
     if (fs_success(FS_CHANNEL_IMAGES) && clock_frame_count_60hz() > load_delay_frames) {
         const chips_range_t file_data = fs_data(FS_CHANNEL_IMAGES);
         bool load_success = false;
+        bool is_tape = false;
         if (fs_ext(FS_CHANNEL_IMAGES, "txt") || fs_ext(FS_CHANNEL_IMAGES, "bas")) {
             load_success = true;
             keybuf_put((const char*)file_data.ptr);
         }
+        else if (fs_ext(FS_CHANNEL_IMAGES, "tap") || fs_ext(FS_CHANNEL_IMAGES, "tzx")) {
+            load_success = zxtape_insert(file_data);
+            is_tape = true;
+        }
         else {
             load_success = zx_quickload(&state.zx, file_data);
         }
@@ -279,6 +392,10 @@ static void handle_file_loading(void) {
             if (sargs_exists("input")) {
                 keybuf_put(sargs_value("input"));
             }
+            else if (is_tape) {
+                // LOAD "" on the 48K, or 'Tape Loader' from the 128K menu
+                keybuf_put((state.zx.type == ZX_TYPE_48K) ? "J\"\"\n" : "\n");
+            }
         }
         else {
             gfx_flash_error();
@@ -296,6 +413,11 @@ static void draw_status_bar(void) {
     sdtx_color3b(255, 255, 255);
     sdtx_pos(1.0f, (h / 8.0f) - 1.5f);
     sdtx_printf("frame:%.2fms emu:%.2fms (min:%.2fms max:%.2fms) ticks:%d", (float)state.frame_time_us * 0.001f, emu_stats.avg_val, emu_stats.min_val, emu_stats.max_val, state.ticks);
+    if (zxtape_inserted()) {
+        const zxtape_status_t tape_status = zxtape_status();
+        sdtx_printf(" tape:%d/%d", tape_status.cur_block, tape_status.num_blocks);
+    }
+    slice_draw_stats(1.0f, (h / 8.0f) - 2.5f);
 }
 
 #if defined(CHIPS_USE_UI)
@@ -4,7 +4,7 @@
 #   into a C array.
 #-------------------------------------------------------------------------------
 
-Version = 5
+Version = 6
 
 import os.path
 import yaml
@@ -21,20 +21,22 @@ def gen_header(in_log, out_hdr):
         f.write('    const char* desc;\n')
         f.write('    uint16_t PC;\n')
         f.write('    uint8_t A,X,Y,P,S;\n')
+        f.write('    uint16_t CYC;\n')
         f.write('} cpu_state;\n');
         f.write('cpu_state state_table[] = {\n')
         lines = []
         with open(in_log, 'r') as fi:
             lines = fi.readlines()
         for line in lines :
-            f.write('  {{ "{}", 0x{},0x{},0x{},0x{},0x{},0x{} }},\n'.format(
+            f.write('  {{ "{}", 0x{},0x{},0x{},0x{},0x{},0x{},{} }},\n'.format(
                 line[16:48],    # desc
                 line[0:4],      # PC
                 line[50:52],    # A
                 line[55:57],    # X
                 line[60:62],    # Y
                 line[65:67],    # P
-                line[71:73]))   # S
+                line[71:73],    # S
+                int(line[78:81])))  # CYC (PPU dots, 3 per CPU cycle)
         f.write('};\n')
 
 #-------------------------------------------------------------------------------
@@ -0,0 +1,64 @@
+"""fips verb to compare native vs WASM throughput of the headless c64-bench"""
+
+import os
+import re
+import subprocess
+
+from mod import log, util, project, config
+
+Target = 'c64-bench'
+WasmConfigs = [ 'wasm-ninja-release', 'wasm-simd-ninja-release' ]
+
+#-------------------------------------------------------------------------------
+def run_bench(cmd_line, cwd):
+    print('> {}'.format(' '.join(cmd_line)))
+    try:
+        output = subprocess.check_output(cmd_line, cwd=cwd, universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError) as err:
+        log.warn("failed to run '{}': {}".format(' '.join(cmd_line), err))
+        return None
+    print(output)
+    match = re.search(r'== time: ([0-9.]+) sec', output)
+    if not match:
+        log.warn("no '== time:' line in output of '{}'".format(' '.join(cmd_line)))
+        return None
+    return float(match.group(1))
+
+#-------------------------------------------------------------------------------
+def bench_config(fips_dir, proj_dir, cfg, secs):
+    if not project.build(fips_dir, proj_dir, cfg):
+        log.warn("failed to build config '{}'".format(cfg))
+        return None
+    deploy_dir = util.get_deploy_dir(fips_dir, 'chips-test', cfg)
+    if cfg.startswith('wasm'):
+        cmd_line = ['node', '{}.js'.format(Target), secs]
+    else:
+        cmd_line = ['./{}'.format(Target), secs]
+    return run_bench(cmd_line, deploy_dir)
+
+#-------------------------------------------------------------------------------
+def run(fips_dir, proj_dir, args) :
+    secs = args[0] if len(args) > 0 else '5'
+    cfgs = [ config.get_default_config() ] + WasmConfigs
+    results = []
+    for cfg in cfgs:
+        log.info("> running {} in config '{}':".format(Target, cfg))
+        results.append((cfg, bench_config(fips_dir, proj_dir, cfg, secs)))
+    native_time = results[0][1]
+    log.info('\n{} results ({} emulated secs):'.format(Target, secs))
+    for cfg, time in results:
+        if time is None:
+            log.info('  {:<32} FAILED'.format(cfg))
+        elif native_time:
+            log.info('  {:<32} {:8.3f} sec ({:.2f}x native)'.format(cfg, time, time / native_time))
+        else:
+            log.info('  {:<32} {:8.3f} sec'.format(cfg, time))
+
+#-------------------------------------------------------------------------------
+def help() :
+    log.info(log.YELLOW +
+        'fips wasmbench\n' +
+        'fips wasmbench [emulated secs]\n' +
+        log.DEF +
+        '    run the headless c64-bench natively and under Node.js (plain WASM\n'
+        '    and WASM with SIMD + pthreads) and compare the results')
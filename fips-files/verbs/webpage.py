@@ -1,6 +1,7 @@
 """fips verb to build the samples webpage"""
 
 import os
+import gzip
 import yaml
 import shutil
 import subprocess
@@ -227,6 +228,12 @@ def cwebp(src_path, dst_path):
     print('> {}'.format(cmd_line))
     subprocess.call(cmd_line, shell=True)
 
+#-------------------------------------------------------------------------------
+# write a precompressed .gz copy next to a file (served by 'http-server -g')
+def gzip_file(path):
+    with open(path, 'rb') as src, gzip.open(path + '.gz', 'wb', 9) as dst:
+        shutil.copyfileobj(src, dst)
+
 #-------------------------------------------------------------------------------
 def to_webp_ext(path):
     return os.path.splitext(path)[0] + '.webp'
@@ -282,6 +289,7 @@ def deploy_webpage(fips_dir, proj_dir, webpage_dir) :
             src_path = '{}/{}.{}'.format(emsc_deploy_dir, system, ext)
             if os.path.isfile(src_path) :
                 shutil.copy(src_path, '{}/'.format(webpage_dir))
+                gzip_file('{}/{}.{}'.format(webpage_dir, system, ext))
         with open(proj_dir + '/webpage/emsc.html', 'r') as f :
             templ = Template(f.read())
         html = templ.safe_substitute(name=system, prog=system)
@@ -305,6 +313,7 @@ def deploy_webpage(fips_dir, proj_dir, webpage_dir) :
                 else:
                     print('> copy {} => {}'.format(src_file, dst_file))
                     shutil.copyfile(src_file, dst_file)
+                    gzip_file(dst_file)
 
 #-------------------------------------------------------------------------------
 def build_deploy_webpage(fips_dir, proj_dir, rebuild) :
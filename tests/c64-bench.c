@@ -1,8 +1,16 @@
 //------------------------------------------------------------------------------
 //  c64-bench.c
 //  Unthrottled headless C64 emu for benchmarking / profiling.
+//
+//  Also builds for WASM and runs under Node.js, for comparing WASM vs
+//  native throughput use the 'fips wasmbench' verb. Optional first arg
+//  is the number of emulated seconds.
+//
+//  Also reports the size of a full snapshot vs a snapshot without the ROMs
+//  (see c64-snapshot.h), and the time to save and restore it.
 //------------------------------------------------------------------------------
 #include <stdio.h>
+#include <stdlib.h>
 #define SOKOL_IMPL
 #include "sokol_time.h"
 #define CHIPS_IMPL
@@ -20,12 +28,19 @@
 #include "systems/c1541.h"
 #include "systems/c64.h"
 #include "c64-roms.h"
+#include "snapshot.h"
+#include "c64-snapshot.h"
 
 static struct {
     c64_t c64;
+    c64_t snapshot;
+    uint8_t packed[sizeof(c64_t)];
 } state;
 
 #define NUM_USEC (5*1000000)
+#define NUM_SNAPSHOTS (1000)
+#define MAX_SECS (24*60*60)
+#define EXEC_CHUNK_USEC (1000000)
 
 static void dummy_audio_callback(const float* samples, int num_samples, void* user_data) {
     (void)samples;
@@ -33,7 +48,7 @@ static void dummy_audio_callback(const float* samples, int num_samples, void* us
     (void)user_data;
 };
 
-int main() {
+int main(int argc, char* argv[]) {
     /* provide "throw-away" pixel buffer and audio callback, so
        that the video and audio generation isn't skipped in the
        emulator
@@ -46,10 +61,49 @@ int main() {
             .kernal = { .ptr=dump_c64_kernalv3_bin, .size=sizeof(dump_c64_kernalv3_bin) }
         }
     });
+    uint64_t num_usec = NUM_USEC;
+    if (argc > 1) {
+        const double secs = atof(argv[1]);
+        if (!(secs > 0.0) || (secs > MAX_SECS)) {
+            printf("!! FAILED: emulated seconds must be > 0 and <= %d\n", MAX_SECS);
+            return 10;
+        }
+        num_usec = (uint64_t) (secs * 1000000.0);
+    }
     stm_setup();
-    printf("== running emulation for %.2f emulated secs\n", NUM_USEC / 1000000.0);
+    printf("== running emulation for %.2f emulated secs\n", num_usec / 1000000.0);
     uint64_t start = stm_now();
-    c64_exec(&state.c64, NUM_USEC);
-    printf("== time: %f sec\n", stm_sec(stm_since(start)));
+    // c64_exec() takes a 32-bit microsecond count, run long durations in 1 second chunks
+    uint64_t ticks = 0;
+    for (uint64_t usec = 0; usec < num_usec; usec += EXEC_CHUNK_USEC) {
+        const uint64_t left = num_usec - usec;
+        ticks += c64_exec(&state.c64, (uint32_t)((left < EXEC_CHUNK_USEC) ? left : EXEC_CHUNK_USEC));
+    }
+    double dur = stm_sec(stm_since(start));
+    printf("== time: %f sec\n", dur);
+    printf("== ticks: %llu (%.2f MHz, %.2fx realtime)\n", (unsigned long long)ticks, (ticks / dur) / 1000000.0, (num_usec / 1000000.0) / dur);
+
+    // snapshot size and save/restore time
+    const snapshot_layout_t layout = snapshot_layout(sizeof(c64_t), c64_snapshot_exclude, C64_SNAPSHOT_NUM_EXCLUDE);
+    printf("== snapshot: %zu bytes full, %zu bytes packed (%.1f%%)\n", sizeof(c64_t), layout.packed_size, (100.0 * layout.packed_size) / sizeof(c64_t));
+    start = stm_now();
+    for (int i = 0; i < NUM_SNAPSHOTS; i++) {
+        c64_save_snapshot(&state.c64, &state.snapshot);
+    }
+    printf("== full snapshot: %.3f us\n", stm_us(stm_since(start)) / NUM_SNAPSHOTS);
+    start = stm_now();
+    for (int i = 0; i < NUM_SNAPSHOTS; i++) {
+        snapshot_pack(&layout, &state.snapshot, state.packed, sizeof(state.packed));
+    }
+    printf("== pack: %.3f us\n", stm_us(stm_since(start)) / NUM_SNAPSHOTS);
+    start = stm_now();
+    for (int i = 0; i < NUM_SNAPSHOTS; i++) {
+        snapshot_unpack(&layout, state.packed, layout.packed_size, &state.snapshot);
+    }
+    printf("== unpack: %.3f us\n", stm_us(stm_since(start)) / NUM_SNAPSHOTS);
+    if (!c64_load_snapshot(&state.c64, C64_SNAPSHOT_VERSION, &state.snapshot)) {
+        printf("!! FAILED: load snapshot\n");
+        return 10;
+    }
     return 0;
 }
@@ -0,0 +1,38 @@
+#pragma once
+//------------------------------------------------------------------------------
+//  c64-memmap.h
+//
+//  Maps the CPU-visible C64 memory for one of the 8 processor port
+//  configurations (LORAM/HIRAM/CHAREN, no cartridge) into a mem_t, with
+//  the same layers as c64.h. The I/O area at D000 is not emulated and
+//  reads as RAM. Shared by mem-test.c and mem-bench.c.
+//------------------------------------------------------------------------------
+#include <stdint.h>
+#include "chips/mem.h"
+
+// C64 processor port bits which control the memory configuration
+#define C64_LORAM   (1<<0)
+#define C64_HIRAM   (1<<1)
+#define C64_CHAREN  (1<<2)
+
+typedef struct {
+    uint8_t ram[1<<16];
+    uint8_t basic[0x2000];
+    uint8_t chars[0x1000];
+    uint8_t kernal[0x2000];
+} c64_banks_t;
+
+// remap the CPU-visible memory like the C64 PLA does
+static void c64_remap(mem_t* mem, c64_banks_t* b, uint8_t port) {
+    mem_unmap_all(mem);
+    mem_map_ram(mem, 1, 0x0000, 0x10000, b->ram);
+    if ((port & (C64_HIRAM|C64_LORAM)) != 0) {
+        const uint8_t* basic = ((port & (C64_HIRAM|C64_LORAM)) == (C64_HIRAM|C64_LORAM)) ? b->basic : &b->ram[0xA000];
+        mem_map_rw(mem, 0, 0xA000, 0x2000, basic, &b->ram[0xA000]);
+        const uint8_t* kernal = (port & C64_HIRAM) ? b->kernal : &b->ram[0xE000];
+        mem_map_rw(mem, 0, 0xE000, 0x2000, kernal, &b->ram[0xE000]);
+        if (0 == (port & C64_CHAREN)) {
+            mem_map_rw(mem, 0, 0xD000, 0x1000, b->chars, &b->ram[0xD000]);
+        }
+    }
+}
@@ -0,0 +1,133 @@
+//------------------------------------------------------------------------------
+//  c64tape-test.c
+//  Test C64 TAP parsing into the block index.
+//------------------------------------------------------------------------------
+#include "c64tape.h"
+#include "utest.h"
+#include <string.h>
+
+#define T(b) ASSERT_TRUE(b)
+
+static uint8_t tape[64 * 1024];
+static uint32_t tape_size;
+static uint32_t pulses[64 * 1024];
+static uint32_t num_pulses;
+
+static void put(uint8_t val) {
+    tape[tape_size++] = val;
+}
+
+static void put_pulse(uint8_t val) {
+    put(val);
+    pulses[num_pulses++] = val * 8;
+}
+
+// a version 1 pause with a 24-bit cycle count
+static void put_pause(uint32_t cycles) {
+    put(0); put(cycles & 0xFF); put((cycles >> 8) & 0xFF); put((cycles >> 16) & 0xFF);
+    pulses[num_pulses++] = cycles;
+}
+
+// a KERNAL-style block: pilot tone and data pulses
+static void put_block(int num_pilot, int num_data) {
+    for (int i = 0; i < num_pilot; i++) {
+        put_pulse(0x30);
+    }
+    for (int i = 0; i < num_data; i++) {
+        put_pulse((i & 1) ? 0x42 : ((i & 2) ? 0x56 : 0x30));
+    }
+}
+
+static void make_tap(int version) {
+    tape_size = 0;
+    num_pulses = 0;
+    const char* sig = "C64-TAPE-RAW";
+    for (int i = 0; i < 12; i++) {
+        put((uint8_t)sig[i]);
+    }
+    put((uint8_t)version); put(0); put(0); put(0);
+    put(0); put(0); put(0); put(0);
+}
+
+static void finish_tap(void) {
+    const uint32_t size = tape_size - C64TAPE_HEADER_SIZE;
+    tape[16] = size & 0xFF;
+    tape[17] = (size >> 8) & 0xFF;
+    tape[18] = (size >> 16) & 0xFF;
+    tape[19] = (size >> 24) & 0xFF;
+}
+
+UTEST(c64tape, blocks) {
+    c64tape_init();
+    make_tap(1);
+    const uint32_t block0_offset = tape_size;
+    put_block(1000, 100);
+    put_pause(500000);
+    const uint32_t block1_offset = tape_size;
+    const uint32_t block1_pulse = num_pulses;
+    put_block(300, 50);
+    finish_tap();
+    T(c64tape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+    T(c64tape_inserted());
+    const c64tape_status_t status = c64tape_status();
+    T(status.version == 1);
+    T(status.num_blocks == 2);
+    T(status.num_pulses == num_pulses);
+    T(c64tape_block(0).tap_offset == block0_offset);
+    T(c64tape_block(0).pulse == 0);
+    T(c64tape_block(1).tap_offset == block1_offset);
+    T(c64tape_block(1).pulse == block1_pulse);
+    uint64_t cycles = 0;
+    for (uint32_t i = 0; i < block1_pulse; i++) {
+        cycles += pulses[i];
+    }
+    T(c64tape_block(1).cycle == cycles);
+    T(c64tape_block_at_offset(0) == 0);
+    T(c64tape_block_at_offset(block1_offset - 1) == 0);
+    T(c64tape_block_at_offset(block1_offset) == 1);
+    T(c64tape_block_at_offset(tape_size) == 1);
+    uint64_t num_cycles = 0;
+    for (uint32_t i = 0; i < num_pulses; i++) {
+        num_cycles += pulses[i];
+    }
+    T(status.num_cycles == num_cycles);
+}
+
+UTEST(c64tape, version0_overflow) {
+    c64tape_init();
+    make_tap(0);
+    put_block(10, 10);
+    // version 0 overflow bytes are pauses
+    put(0); pulses[num_pulses++] = C64TAPE_PAUSE_CYCLES;
+    put(0); pulses[num_pulses++] = C64TAPE_PAUSE_CYCLES;
+    const uint32_t block1_pulse = num_pulses;
+    put_block(10, 10);
+    finish_tap();
+    T(c64tape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+    T(c64tape_status().num_blocks == 2);
+    T(c64tape_status().num_pulses == num_pulses);
+    T(c64tape_block(1).pulse == block1_pulse);
+    uint64_t cycles = 0;
+    for (uint32_t i = 0; i < block1_pulse; i++) {
+        cycles += pulses[i];
+    }
+    T(c64tape_block(1).cycle == cycles);
+}
+
+UTEST(c64tape, bad_tap) {
+    c64tape_init();
+    make_tap(1);
+    finish_tap();
+    // no data
+    T(!c64tape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+    T(!c64tape_inserted());
+    // no signature
+    put_block(10, 10);
+    finish_tap();
+    tape[0] = 'X';
+    T(!c64tape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+    // unsupported version
+    tape[0] = 'C';
+    tape[12] = 2;
+    T(!c64tape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+}
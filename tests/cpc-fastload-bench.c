@@ -0,0 +1,110 @@
+//------------------------------------------------------------------------------
+//  cpc-fastload-bench.c
+//
+//  Headless CPC 6128 disc loading benchmark for the fast-forward mode in
+//  the cpc emulator: loads Boulderdash from tests/disks/boulderdash_cpc.dsk
+//  once in frame-sized steps (the regular path) and once in large steps
+//  while the disc motor is on (like the warp mode in slice.c). Reports how
+//  much emulated time is spent with the disc motor on, and how long this
+//  takes in host time. The loaded data is checked in cpc-fastload-test.c.
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#define CHIPS_IMPL
+#include "chips/chips_common.h"
+#include "chips/z80.h"
+#include "chips/ay38910.h"
+#include "chips/i8255.h"
+#include "chips/mc6845.h"
+#include "chips/am40010.h"
+#include "chips/upd765.h"
+#include "chips/clk.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/fdd.h"
+#include "chips/fdd_cpc.h"
+#include "systems/cpc.h"
+#include "cpc-roms.h"
+#include "disks/fdd-test.h"
+
+#define FRAME_USEC (20000)
+#define WARP_USEC (50 * FRAME_USEC)
+#define BOOT_USEC (2 * 1000000)
+#define LOAD_USEC (40 * 1000000)
+
+static cpc_t cpc;
+
+typedef struct {
+    uint32_t checksum;
+    uint16_t pc;
+    uint32_t motor_usec;
+    double host_sec;
+} result_t;
+
+static void dummy_audio_callback(const float* samples, int num_samples, void* user_data) {
+    (void)samples;
+    (void)num_samples;
+    (void)user_data;
+};
+
+static void type_text(const char* text) {
+    while (*text) {
+        cpc_key_down(&cpc, *text);
+        cpc_exec(&cpc, 2 * FRAME_USEC);
+        cpc_key_up(&cpc, *text);
+        cpc_exec(&cpc, 2 * FRAME_USEC);
+        text++;
+    }
+}
+
+static result_t run(uint32_t warp_usec) {
+    cpc_init(&cpc, &(cpc_desc_t){
+        .type = CPC_TYPE_6128,
+        .audio.callback.func = dummy_audio_callback,
+        .roms.cpc6128 = {
+            .os = { .ptr=dump_cpc6128_os_bin, .size=sizeof(dump_cpc6128_os_bin) },
+            .basic = { .ptr=dump_cpc6128_basic_bin, .size=sizeof(dump_cpc6128_basic_bin) },
+            .amsdos = { .ptr=dump_cpc6128_amsdos_bin, .size=sizeof(dump_cpc6128_amsdos_bin) }
+        },
+    });
+    cpc_exec(&cpc, BOOT_USEC);
+    cpc_insert_disc(&cpc, (chips_range_t){ .ptr=dump_boulderdash_cpc_dsk, .size=sizeof(dump_boulderdash_cpc_dsk) });
+    type_text("run\"boulder\r");
+
+    result_t res = { 0 };
+    const uint64_t start = stm_now();
+    uint32_t elapsed = 0;
+    while (elapsed < LOAD_USEC) {
+        const bool motor_on = cpc.fdd.motor_on;
+        uint32_t us = (motor_on && (warp_usec > 0)) ? warp_usec : FRAME_USEC;
+        if (us > (LOAD_USEC - elapsed)) {
+            us = LOAD_USEC - elapsed;
+        }
+        cpc_exec(&cpc, us);
+        if (motor_on) {
+            res.motor_usec += us;
+        }
+        elapsed += us;
+    }
+    res.host_sec = stm_sec(stm_since(start));
+    for (uint32_t addr = 0; addr < 0x10000; addr++) {
+        res.checksum = (res.checksum * 31) + mem_rd(&cpc.mem, (uint16_t)addr);
+    }
+    res.pc = cpc.cpu.pc;
+    return res;
+}
+
+int main() {
+    stm_setup();
+    const result_t slow = run(0);
+    printf("== frame steps: motor on for %.2f emulated sec, %.3f host sec (checksum: %08X, pc: %04X)\n",
+        slow.motor_usec / 1000000.0, slow.host_sec, slow.checksum, slow.pc);
+    const result_t fast = run(WARP_USEC);
+    printf("== warp steps:  motor on for %.2f emulated sec, %.3f host sec (checksum: %08X, pc: %04X)\n",
+        fast.motor_usec / 1000000.0, fast.host_sec, fast.checksum, fast.pc);
+    printf("== frame steps run at %.1fx realtime, warp steps at %.1fx realtime\n",
+        (LOAD_USEC / 1000000.0) / slow.host_sec, (LOAD_USEC / 1000000.0) / fast.host_sec);
+    return 0;
+}
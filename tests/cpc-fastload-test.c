@@ -0,0 +1,234 @@
+//------------------------------------------------------------------------------
+//  cpc-fastload-test.c
+//
+//  Headless CPC 6128 disc loading test for the fast-forward mode in the
+//  cpc emulator. Boots from tests/disks/boulderdash_cpc.dsk and runs the
+//  BASIC loader, which LOADs three binary files and then CALLs the first
+//  of them (BOUL.BIN). The test stops at the opcode fetch of that call and
+//  checks that the files from the disc image are in memory at their load
+//  addresses. This is done once in frame-sized steps (the regular path)
+//  and once in large steps while the disc motor is on (like the warp mode
+//  in slice.c). See cpc-fastload-bench.c for the timing.
+//------------------------------------------------------------------------------
+#include <string.h>
+#define CHIPS_IMPL
+#include "chips/chips_common.h"
+#include "chips/z80.h"
+#include "chips/ay38910.h"
+#include "chips/i8255.h"
+#include "chips/mc6845.h"
+#include "chips/am40010.h"
+#include "chips/upd765.h"
+#include "chips/clk.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/fdd.h"
+#include "chips/fdd_cpc.h"
+#include "systems/cpc.h"
+#include "cpc-roms.h"
+#include "disks/fdd-test.h"
+#include "utest.h"
+
+#define T(b) ASSERT_TRUE(b)
+
+#define FRAME_USEC (20000)
+#define WARP_USEC (50 * FRAME_USEC)
+#define BOOT_USEC (2 * 1000000)
+#define LOAD_USEC (40 * 1000000)
+
+// size of the AMSDOS file header in front of binary files
+#define AMSDOS_HEADER_SIZE (128)
+#define MAX_FILE_SIZE (0x10000)
+
+typedef struct {
+    uint16_t load_addr;
+    uint16_t len;
+    uint8_t data[MAX_FILE_SIZE];
+} dsk_file_t;
+
+static cpc_t cpc;
+static struct {
+    uint16_t entry_addr;
+    bool stopped;
+    bool entered;
+} trap;
+static dsk_file_t files[3];
+
+static void dummy_audio_callback(const float* samples, int num_samples, void* user_data) {
+    (void)samples;
+    (void)num_samples;
+    (void)user_data;
+};
+
+// find a sector in a single-sided (extended) DSK image
+static const uint8_t* dsk_sector(const uint8_t* dsk, int track, uint8_t sector_id) {
+    const bool extended = 0 == memcmp(dsk, "EXTENDED", 8);
+    const uint8_t* trk = dsk + 0x100;
+    for (int i = 0; i < track; i++) {
+        trk += extended ? (dsk[0x34 + i] * 256) : (dsk[0x32] | (dsk[0x33] << 8));
+    }
+    const uint8_t* data = trk + 0x100;
+    for (int i = 0; i < trk[0x15]; i++) {
+        const uint8_t* info = trk + 0x18 + i * 8;
+        if (info[2] == sector_id) {
+            return data;
+        }
+        data += extended ? (info[6] | (info[7] << 8)) : (128 << info[3]);
+    }
+    return 0;
+}
+
+// AMSDOS data format: 9 sectors per track (C1..C9), 1 KB blocks, the
+// directory is in block 0 and 1
+static const uint8_t* dsk_block_sector(const uint8_t* dsk, int block, int half) {
+    const int index = block * 2 + half;
+    return dsk_sector(dsk, index / 9, (uint8_t)(0xC1 + (index % 9)));
+}
+
+// read a binary file from the disc image (name is 8+3 chars, space padded)
+static bool dsk_read_file(const uint8_t* dsk, const char* name, dsk_file_t* file) {
+    static uint8_t buf[MAX_FILE_SIZE + AMSDOS_HEADER_SIZE];
+    int pos = 0;
+    for (int extent = 0; extent < 32; extent++) {
+        bool found = false;
+        for (int i = 0; (i < 64) && !found; i++) {
+            const uint8_t* dir = dsk_block_sector(dsk, (i * 32) / 1024, ((i * 32) / 512) & 1) + ((i * 32) & 511);
+            if ((dir[0] != 0) || (dir[12] != extent)) {
+                continue;
+            }
+            bool match = true;
+            for (int c = 0; c < 11; c++) {
+                match &= (dir[1 + c] & 0x7F) == (uint8_t)name[c];
+            }
+            if (!match) {
+                continue;
+            }
+            found = true;
+            int num_bytes = dir[15] * 128;
+            for (int b = 0; (b < 16) && (num_bytes > 0) && dir[16 + b]; b++) {
+                for (int half = 0; (half < 2) && (num_bytes > 0); half++) {
+                    const uint8_t* sector = dsk_block_sector(dsk, dir[16 + b], half);
+                    const int n = (num_bytes < 512) ? num_bytes : 512;
+                    if (!sector || ((pos + n) > (int)sizeof(buf))) {
+                        return false;
+                    }
+                    memcpy(&buf[pos], sector, (size_t)n);
+                    pos += n;
+                    num_bytes -= n;
+                }
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+    if (pos < AMSDOS_HEADER_SIZE) {
+        return false;
+    }
+    file->load_addr = buf[21] | (buf[22] << 8);
+    file->len = buf[24] | (buf[25] << 8);
+    if ((file->len == 0) || ((file->len + AMSDOS_HEADER_SIZE) > pos)) {
+        return false;
+    }
+    memcpy(file->data, &buf[AMSDOS_HEADER_SIZE], file->len);
+    return true;
+}
+
+// per-tick debug callback, stops at the opcode fetch of the entry address
+static void trap_cb(void* user_data, uint64_t pins) {
+    (void)user_data;
+    if (z80_opdone(&cpc.cpu) && (Z80_GET_ADDR(pins) == trap.entry_addr)) {
+        trap.entered = true;
+        trap.stopped = true;
+    }
+}
+
+static void type_text(const char* text) {
+    while (*text) {
+        cpc_key_down(&cpc, *text);
+        cpc_exec(&cpc, 2 * FRAME_USEC);
+        cpc_key_up(&cpc, *text);
+        cpc_exec(&cpc, 2 * FRAME_USEC);
+        text++;
+    }
+}
+
+// run the BASIC loader until it calls the entry address, return the
+// emulated time the disc motor was on
+static uint32_t load(uint32_t warp_usec, uint16_t entry_addr) {
+    cpc_init(&cpc, &(cpc_desc_t){
+        .type = CPC_TYPE_6128,
+        .audio.callback.func = dummy_audio_callback,
+        .roms.cpc6128 = {
+            .os = { .ptr=dump_cpc6128_os_bin, .size=sizeof(dump_cpc6128_os_bin) },
+            .basic = { .ptr=dump_cpc6128_basic_bin, .size=sizeof(dump_cpc6128_basic_bin) },
+            .amsdos = { .ptr=dump_cpc6128_amsdos_bin, .size=sizeof(dump_cpc6128_amsdos_bin) }
+        },
+    });
+    cpc_exec(&cpc, BOOT_USEC);
+    cpc_insert_disc(&cpc, (chips_range_t){ .ptr=dump_boulderdash_cpc_dsk, .size=sizeof(dump_boulderdash_cpc_dsk) });
+    type_text("run\"boulder\r");
+
+    trap.entry_addr = entry_addr;
+    trap.stopped = false;
+    trap.entered = false;
+    cpc.debug = (chips_debug_t){
+        .callback = { .func = trap_cb },
+        .stopped = &trap.stopped,
+    };
+    uint32_t motor_usec = 0;
+    uint32_t elapsed = 0;
+    while (!trap.entered && (elapsed < LOAD_USEC)) {
+        const bool motor_on = cpc.fdd.motor_on;
+        uint32_t us = (motor_on && (warp_usec > 0)) ? warp_usec : FRAME_USEC;
+        if (us > (LOAD_USEC - elapsed)) {
+            us = LOAD_USEC - elapsed;
+        }
+        cpc_exec(&cpc, us);
+        if (motor_on) {
+            motor_usec += us;
+        }
+        elapsed += us;
+    }
+    cpc.debug = (chips_debug_t){0};
+    return motor_usec;
+}
+
+static bool file_loaded(const dsk_file_t* file) {
+    for (int i = 0; i < file->len; i++) {
+        if (mem_rd(&cpc.mem, (uint16_t)(file->load_addr + i)) != file->data[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool read_files(void) {
+    // the BASIC loader LOADs these files, then CALLs BOUL.BIN
+    static const char* names[3] = { "BOUL    BIN", "BOULD   BIN", "BOULDE  BIN" };
+    bool success = true;
+    for (int i = 0; i < 3; i++) {
+        success &= dsk_read_file(dump_boulderdash_cpc_dsk, names[i], &files[i]);
+    }
+    return success;
+}
+
+UTEST(cpc_fastload, frame_steps) {
+    T(read_files());
+    T(load(0, files[0].load_addr) > 0);
+    T(trap.entered);
+    T(file_loaded(&files[0]));
+    T(file_loaded(&files[1]));
+    T(file_loaded(&files[2]));
+}
+
+UTEST(cpc_fastload, warp_steps) {
+    T(read_files());
+    T(load(WARP_USEC, files[0].load_addr) > 0);
+    T(trap.entered);
+    T(file_loaded(&files[0]));
+    T(file_loaded(&files[1]));
+    T(file_loaded(&files[2]));
+}
+
+UTEST_MAIN()
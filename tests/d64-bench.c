@@ -0,0 +1,399 @@
+//------------------------------------------------------------------------------
+//  d64-bench.c
+//
+//  Builds a 35-track D64 image with a number of files, then checks and
+//  benchmarks the d64 module: directory listing, loading files by following
+//  their track/sector chains, the virtual drive KERNAL LOAD, and inserting
+//  a G64 image (GCR-encoded here from the D64 image like a disk formatted
+//  by the 1541 DOS) through the GCR decoder. Optional first arg is the
+//  number of iterations.
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#include "d64.h"
+
+#define NUM_ITERATIONS (100)
+#define NUM_FILES (16)
+#define NUM_TRACKS (35)
+#define NUM_SECTORS (683)
+#define G64_NUM_HALF_TRACKS (84)
+#define SYNC_BYTES (5)
+#define HEADER_GAP_BYTES (9)
+#define GCR_SECTOR_BYTES (SYNC_BYTES + 10 + HEADER_GAP_BYTES + SYNC_BYTES + 325)
+
+static struct {
+    uint8_t d64[NUM_SECTORS * D64_SECTOR_SIZE];
+    uint8_t g64[12 + G64_NUM_HALF_TRACKS * 8 + NUM_TRACKS * (2 + D64_MAX_GCR_TRACK_SIZE)];
+    uint8_t file[D64_MAX_FILE_SIZE];
+    uint8_t mem[1<<16];
+    int file_size[NUM_FILES];
+    // next free sector for the file allocator
+    int alloc_track;
+    int alloc_sector;
+} state;
+
+static int sectors_per_track(int track) {
+    return (track <= 17) ? 21 : (track <= 24) ? 19 : (track <= 30) ? 18 : 17;
+}
+
+static uint8_t* sector_ptr(int track, int sector) {
+    int index = 0;
+    for (int t = 1; t < track; t++) {
+        index += sectors_per_track(t);
+    }
+    return &state.d64[(index + sector) * D64_SECTOR_SIZE];
+}
+
+static uint8_t file_byte(int file_index, int pos) {
+    return (uint8_t)((pos * 7) + (pos >> 8) + file_index * 13);
+}
+
+// allocate the next free sector, skipping the directory track
+static void alloc_sector(int* out_track, int* out_sector) {
+    if (state.alloc_sector >= sectors_per_track(state.alloc_track)) {
+        state.alloc_sector = 0;
+        state.alloc_track++;
+        if (state.alloc_track == D64_DIR_TRACK) {
+            state.alloc_track++;
+        }
+    }
+    *out_track = state.alloc_track;
+    *out_sector = state.alloc_sector++;
+}
+
+static void make_d64(void) {
+    memset(state.d64, 0, sizeof(state.d64));
+    // BAM with disk name and ID
+    uint8_t* bam = sector_ptr(D64_DIR_TRACK, 0);
+    bam[0] = D64_DIR_TRACK;
+    bam[1] = 1;
+    bam[2] = 0x41;
+    memset(&bam[0x90], 0xA0, 0x1B);
+    memcpy(&bam[0x90], "BENCHDISK", 9);
+    bam[0xA2] = 'B';
+    bam[0xA3] = 'D';
+    bam[0xA5] = '2';
+    bam[0xA6] = 'A';
+    // files with sizes from 1 to ~40 blocks
+    state.alloc_track = 1;
+    state.alloc_sector = 0;
+    for (int fi = 0; fi < NUM_FILES; fi++) {
+        const int size = 1 + fi * 631;
+        state.file_size[fi] = size;
+        int track, sector;
+        alloc_sector(&track, &sector);
+        uint8_t* dir = sector_ptr(D64_DIR_TRACK, 1 + fi / 8);
+        if ((fi % 8) == 0) {
+            dir[0] = (fi + 8 < NUM_FILES) ? D64_DIR_TRACK : 0;
+            dir[1] = (fi + 8 < NUM_FILES) ? (uint8_t)(2 + fi / 8) : 0xFF;
+        }
+        uint8_t* ent = &dir[(fi % 8) * 32];
+        ent[2] = 0x80 | D64_FILETYPE_PRG;
+        ent[3] = (uint8_t)track;
+        ent[4] = (uint8_t)sector;
+        memset(&ent[5], 0xA0, 16);
+        char name[17];
+        const int name_len = snprintf(name, sizeof(name), "FILE%02d", fi);
+        memcpy(&ent[5], name, (size_t)name_len);
+        int pos = 0;
+        int num_blocks = 0;
+        while (true) {
+            uint8_t* data = sector_ptr(track, sector);
+            num_blocks++;
+            const int n = ((size - pos) > 254) ? 254 : (size - pos);
+            for (int i = 0; i < n; i++) {
+                data[2 + i] = file_byte(fi, pos + i);
+            }
+            pos += n;
+            if (pos == size) {
+                data[0] = 0;
+                data[1] = (uint8_t)(n + 1);
+                break;
+            }
+            alloc_sector(&track, &sector);
+            data[0] = (uint8_t)track;
+            data[1] = (uint8_t)sector;
+        }
+        ent[30] = (uint8_t)num_blocks;
+        ent[31] = (uint8_t)(num_blocks >> 8);
+    }
+}
+
+// number of bytes on a track in the track's speed zone
+static int gcr_track_size(int track) {
+    return (track <= 17) ? 7692 : (track <= 24) ? 7142 : (track <= 30) ? 6666 : 6250;
+}
+
+// GCR-encode 4 bytes into 5 bytes
+static void gcr_encode4(const uint8_t* src, uint8_t* dst) {
+    static const uint8_t gcr[16] = {
+        0x0A, 0x0B, 0x12, 0x13, 0x0E, 0x0F, 0x16, 0x17,
+        0x09, 0x19, 0x1A, 0x1B, 0x0D, 0x1D, 0x1E, 0x15,
+    };
+    uint64_t bits = 0;
+    for (int i = 0; i < 4; i++) {
+        bits = (bits << 10) | ((uint64_t)gcr[src[i] >> 4] << 5) | gcr[src[i] & 0x0F];
+    }
+    for (int i = 0; i < 5; i++) {
+        dst[i] = (uint8_t)(bits >> (32 - i * 8));
+    }
+}
+
+// GCR-encode a track of the D64 image: sync marks, header and data blocks, gaps
+static int gcr_encode_track(int track, uint8_t* buf) {
+    const int track_size = gcr_track_size(track);
+    const uint8_t* bam = sector_ptr(D64_DIR_TRACK, 0);
+    const uint8_t id1 = bam[0xA2];
+    const uint8_t id2 = bam[0xA3];
+    const int num_sectors = sectors_per_track(track);
+    const int gap = (track_size - num_sectors * GCR_SECTOR_BYTES) / num_sectors;
+    memset(buf, 0x55, (size_t)track_size);
+    int pos = 0;
+    for (int sector = 0; sector < num_sectors; sector++) {
+        const uint8_t hdr[8] = { 0x08, (uint8_t)(sector ^ track ^ id2 ^ id1), (uint8_t)sector, (uint8_t)track, id2, id1, 0x0F, 0x0F };
+        memset(&buf[pos], 0xFF, SYNC_BYTES);
+        pos += SYNC_BYTES;
+        gcr_encode4(&hdr[0], &buf[pos]);
+        gcr_encode4(&hdr[4], &buf[pos + 5]);
+        pos += 10 + HEADER_GAP_BYTES;
+        const uint8_t* data = sector_ptr(track, sector);
+        uint8_t blk[260] = { 0x07 };
+        memcpy(&blk[1], data, D64_SECTOR_SIZE);
+        for (int i = 0; i < D64_SECTOR_SIZE; i++) {
+            blk[257] ^= data[i];
+        }
+        memset(&buf[pos], 0xFF, SYNC_BYTES);
+        pos += SYNC_BYTES;
+        for (int i = 0; i < 260; i += 4) {
+            gcr_encode4(&blk[i], &buf[pos]);
+            pos += 5;
+        }
+        pos += gap;
+    }
+    return track_size;
+}
+
+// build a G64 image from the D64 image
+static size_t make_g64(void) {
+    memset(state.g64, 0, sizeof(state.g64));
+    memcpy(state.g64, "GCR-1541", 8);
+    state.g64[9] = G64_NUM_HALF_TRACKS;
+    state.g64[10] = D64_MAX_GCR_TRACK_SIZE & 0xFF;
+    state.g64[11] = D64_MAX_GCR_TRACK_SIZE >> 8;
+    size_t pos = 12 + G64_NUM_HALF_TRACKS * 8;
+    for (int track = 1; track <= NUM_TRACKS; track++) {
+        uint8_t* offset = &state.g64[12 + (track - 1) * 2 * 4];
+        offset[0] = (uint8_t)pos;
+        offset[1] = (uint8_t)(pos >> 8);
+        offset[2] = (uint8_t)(pos >> 16);
+        const int size = gcr_encode_track(track, &state.g64[pos + 2]);
+        state.g64[pos++] = (uint8_t)size;
+        state.g64[pos++] = (uint8_t)(size >> 8);
+        pos += (size_t)size;
+    }
+    return pos;
+}
+
+static bool check(bool cond, const char* msg) {
+    if (!cond) {
+        printf("!! FAILED: %s\n", msg);
+    }
+    return cond;
+}
+
+// check the directory and the content of all files
+static bool verify_disk(void) {
+    d64_dir_entry_t entries[144];
+    const int num_entries = d64_directory(entries, 144);
+    if (!check(num_entries == NUM_FILES, "number of directory entries")) {
+        return false;
+    }
+    for (int fi = 0; fi < NUM_FILES; fi++) {
+        char name[17];
+        snprintf(name, sizeof(name), "FILE%02d", fi);
+        if (!check(0 == strcmp(entries[fi].name, name), "file name")) {
+            return false;
+        }
+        const int size = d64_read_file(&entries[fi], state.file, sizeof(state.file));
+        if (!check(size == state.file_size[fi], "file size")) {
+            return false;
+        }
+        for (int i = 0; i < size; i++) {
+            if (!check(state.file[i] == file_byte(fi, i), "file content")) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static uint8_t mem_read(uint16_t addr, void* user_data) {
+    (void)user_data;
+    return state.mem[addr];
+}
+
+static void mem_write(uint16_t addr, uint8_t data, void* user_data) {
+    (void)user_data;
+    state.mem[addr] = data;
+}
+
+static d64_load_result_t load(const char* name, bool use_file_addr, bool verify) {
+    return d64_load(&(d64_load_t){
+        .name = (const uint8_t*)name,
+        .name_len = (int)strlen(name),
+        .use_file_addr = use_file_addr,
+        .addr = 0x0801,
+        .verify = verify,
+        .read_cb = mem_read,
+        .write_cb = mem_write,
+    });
+}
+
+// check KERNAL LOAD results of the virtual drive
+static bool verify_load(void) {
+    const int fi = 3;
+    const int size = state.file_size[fi];
+    const uint16_t file_addr = (uint16_t)(file_byte(fi, 0) | (file_byte(fi, 1) << 8));
+    // LOAD"FILE03",8,1 loads to the address in the file
+    memset(state.mem, 0, sizeof(state.mem));
+    d64_load_result_t res = load("FILE03", true, false);
+    bool ok = check(res.error == D64_LOAD_OK, "load file");
+    ok = ok && check((res.start_addr == file_addr) && (res.end_addr == (uint16_t)(file_addr + size - 2)), "load address");
+    for (int i = 2; ok && (i < size); i++) {
+        ok = check(state.mem[(uint16_t)(file_addr + i - 2)] == file_byte(fi, i), "loaded content");
+    }
+    // LOAD"0:FILE0?",8 loads the first match to the BASIC start
+    res = load("0:FILE0?", false, false);
+    ok = ok && check((res.error == D64_LOAD_FILE_NOT_FOUND), "1-byte file has no load address");
+    res = load("FILE1*", false, false);
+    ok = ok && check((res.error == D64_LOAD_OK) && (res.start_addr == 0x0801), "load with wildcard");
+    ok = ok && check(state.mem[0x0801] == file_byte(10, 2), "wildcard content");
+    // VERIFY
+    ok = ok && check(!load("FILE10", false, true).verify_error, "verify");
+    state.mem[0x0900] ^= 0xFF;
+    ok = ok && check(load("FILE10", false, true).verify_error, "verify error");
+    // errors
+    ok = ok && check(load("NOPE", false, false).error == D64_LOAD_FILE_NOT_FOUND, "file not found");
+    ok = ok && check(load("", false, false).error == D64_LOAD_MISSING_FILE_NAME, "missing file name");
+    // the directory listing is a linked BASIC program
+    res = load("$", false, false);
+    ok = ok && check(res.error == D64_LOAD_OK, "load directory");
+    int num_lines = 0;
+    uint16_t line = 0x0801;
+    while (ok && (state.mem[line] | state.mem[line + 1])) {
+        const uint16_t next = (uint16_t)(state.mem[line] | (state.mem[line + 1] << 8)) - 0x0401 + 0x0801;
+        ok = check((next > line) && (next < res.end_addr), "directory line link");
+        line = next;
+        num_lines++;
+    }
+    ok = ok && check(num_lines == (NUM_FILES + 2), "directory lines");
+    ok = ok && check(0 == memcmp(&state.mem[0x0801 + 4], "\x12\"BENCHDISK", 11), "directory header");
+    return ok;
+}
+
+static void report(const char* name, uint64_t start, double num_items, const char* unit) {
+    double dur = stm_sec(stm_since(start));
+    printf("== %-24s %8.3f sec, %12.1f %s/sec\n", name, dur, num_items / dur, unit);
+}
+
+int main(int argc, char* argv[]) {
+    const int num_iterations = (argc > 1) ? atoi(argv[1]) : NUM_ITERATIONS;
+    stm_setup();
+    d64_init();
+    make_d64();
+    bool ok = check(d64_insert((chips_range_t){ .ptr = state.d64, .size = sizeof(state.d64) }), "insert d64");
+    ok = ok && verify_disk();
+    ok = ok && verify_load();
+    if (!ok) {
+        return 10;
+    }
+
+    // directory listing
+    char disk_name[17];
+    d64_disk_name(disk_name);
+    d64_dir_entry_t entries[144];
+    const int num_entries = d64_directory(entries, 144);
+    printf("0 \"%-16s\" BD 2A\n", disk_name);
+    for (int i = 0; i < num_entries; i++) {
+        printf("%-4d \"%s\" PRG\n", entries[i].num_blocks, entries[i].name);
+    }
+    uint64_t start = stm_now();
+    for (int i = 0; i < num_iterations * 100; i++) {
+        d64_directory(entries, 144);
+    }
+    report("directory:", start, num_iterations * 100.0, "listings");
+
+    // loading all files
+    double num_bytes = 0;
+    start = stm_now();
+    for (int i = 0; i < num_iterations; i++) {
+        for (int fi = 0; fi < num_entries; fi++) {
+            num_bytes += d64_read_file(&entries[fi], state.file, sizeof(state.file));
+        }
+    }
+    report("load files:", start, num_bytes / (1024.0 * 1024.0), "MB");
+
+    // the same through the virtual drive into 64 KB of memory
+    num_bytes = 0;
+    start = stm_now();
+    for (int i = 0; i < num_iterations; i++) {
+        for (int fi = 0; fi < num_entries; fi++) {
+            const d64_load_result_t res = d64_load(&(d64_load_t){
+                .name = entries[fi].raw_name,
+                .name_len = (int)strlen(entries[fi].name),
+                .addr = 0x0801,
+                .read_cb = mem_read,
+                .write_cb = mem_write,
+            });
+            num_bytes += (uint16_t)(res.end_addr - res.start_addr);
+        }
+    }
+    report("kernal load:", start, num_bytes / (1024.0 * 1024.0), "MB");
+
+    // writing a sector
+    uint8_t sector[D64_SECTOR_SIZE];
+    memcpy(sector, d64_read_sector(1, 0), D64_SECTOR_SIZE);
+    sector[2] ^= 0xFF;
+    ok = ok && check(d64_write_sector(1, 0, sector), "write sector");
+    ok = ok && check(0 == memcmp(d64_read_sector(1, 0), sector, D64_SECTOR_SIZE), "read written sector");
+    sector[2] ^= 0xFF;
+    ok = ok && check(d64_write_sector(1, 0, sector), "restore sector");
+
+    // inserting a G64 image decodes all GCR tracks into sectors
+    const size_t g64_size = make_g64();
+    start = stm_now();
+    for (int i = 0; i < num_iterations; i++) {
+        d64_insert((chips_range_t){ .ptr = state.g64, .size = g64_size });
+    }
+    report("g64 insert:", start, num_iterations * (double)NUM_TRACKS, "tracks");
+
+    // D64 -> GCR -> G64 -> decoded sectors must match the original image
+    ok = ok && check(d64_insert((chips_range_t){ .ptr = state.g64, .size = g64_size }), "insert g64");
+    ok = ok && check(d64_num_tracks() == NUM_TRACKS, "g64 number of tracks");
+    for (int track = 1; ok && (track <= NUM_TRACKS); track++) {
+        for (int s = 0; ok && (s < sectors_per_track(track)); s++) {
+            ok = check(0 == memcmp(d64_read_sector(track, s), sector_ptr(track, s), D64_SECTOR_SIZE), "g64 sector content");
+        }
+    }
+    ok = ok && verify_disk();
+
+    // a G64 with an empty track is accepted, the track has no sectors
+    static uint8_t empty_track_g64[30] = {
+        'G', 'C', 'R', '-', '1', '5', '4', '1', 0, 2, 0, 0,
+        28, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,
+        0, 0,
+    };
+    ok = ok && check(d64_insert((chips_range_t){ .ptr = empty_track_g64, .size = sizeof(empty_track_g64) }), "insert g64 with empty track");
+    const uint8_t* empty_sector = d64_read_sector(1, 0);
+    for (int i = 0; ok && (i < D64_SECTOR_SIZE); i++) {
+        ok = check(empty_sector[i] == 0, "g64 empty track content");
+    }
+    if (!ok) {
+        return 10;
+    }
+    printf("== ok\n");
+    return 0;
+}
@@ -0,0 +1,178 @@
+//------------------------------------------------------------------------------
+//  dasm-bench.c
+//
+//  Disassembler throughput benchmark, compares disassembling the ZX Spectrum
+//  48K ROM and the C64 KERNAL ROM one instruction at a time through the
+//  z80dasm_op()/m6502dasm_op() callbacks with the batched dasm_disassemble()
+//  (with a cold and a warm line cache), and checks that all paths produce the
+//  same output. Optional first arg is the number of passes.
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#include "util/z80dasm.h"
+#include "util/m6502dasm.h"
+#include "dasm.h"
+#include "zx-roms.h"
+#include "c64-roms.h"
+
+#define NUM_PASSES (20)
+#define MAX_LINES (1<<16)
+
+typedef struct {
+    const char* name;
+    dasm_cputype_t cpu_type;
+    uint16_t base;
+    const uint8_t* rom;
+    int rom_size;
+} rom_t;
+
+static struct {
+    rom_t rom;
+    int num_lines;
+    dasm_line_t ref[MAX_LINES];
+    dasm_line_t lines[MAX_LINES];
+    // per-op callback state
+    uint16_t addr;
+    dasm_line_t* line;
+} state;
+
+static uint8_t read_cb(uint16_t addr, void* user_data) {
+    const rom_t* rom = (const rom_t*) user_data;
+    const uint16_t offset = addr - rom->base;
+    return (offset < rom->rom_size) ? rom->rom[offset] : 0;
+}
+
+static uint8_t in_cb(void* user_data) {
+    uint8_t val = read_cb(state.addr++, user_data);
+    if (state.line->num_bytes < DASM_LINE_MAX_BYTES) {
+        state.line->bytes[state.line->num_bytes++] = val;
+    }
+    return val;
+}
+
+static void out_cb(char c, void* user_data) {
+    (void)user_data;
+    if ((state.line->num_chars + 1) < DASM_LINE_MAX_CHARS) {
+        state.line->chars[state.line->num_chars++] = c;
+        state.line->chars[state.line->num_chars] = 0;
+    }
+}
+
+// disassemble the whole ROM one instruction at a time, returns number of lines
+static int dasm_per_op(dasm_line_t* lines) {
+    const uint32_t end_addr = state.rom.base + state.rom.rom_size;
+    int num_lines = 0;
+    state.addr = state.rom.base;
+    while ((state.addr >= state.rom.base) && (state.addr < end_addr) && (num_lines < MAX_LINES)) {
+        state.line = &lines[num_lines++];
+        memset(state.line, 0, sizeof(dasm_line_t));
+        state.line->addr = state.addr;
+        if (state.rom.cpu_type == DASM_CPUTYPE_Z80) {
+            z80dasm_op(state.addr, in_cb, out_cb, &state.rom);
+        }
+        else {
+            m6502dasm_op(state.addr, in_cb, out_cb, &state.rom);
+        }
+    }
+    return num_lines;
+}
+
+static void dasm_batch(dasm_line_t* lines) {
+    dasm_disassemble(&(dasm_request_t){
+        .cpu_type = state.rom.cpu_type,
+        .addr = state.rom.base,
+        .num_lines = state.num_lines,
+        .out_lines = lines,
+        .read_cb = read_cb,
+        .user_data = &state.rom,
+    });
+}
+
+static bool verify(void) {
+    for (int i = 0; i < state.num_lines; i++) {
+        const dasm_line_t* l0 = &state.ref[i];
+        const dasm_line_t* l1 = &state.lines[i];
+        if ((l0->addr != l1->addr) ||
+            (l0->num_bytes != l1->num_bytes) ||
+            (0 != memcmp(l0->bytes, l1->bytes, l0->num_bytes)) ||
+            (0 != strcmp(l0->chars, l1->chars)))
+        {
+            printf("!! MISMATCH at %04X: '%s' vs '%s'\n", l0->addr, l0->chars, l1->chars);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void report(const char* name, uint64_t start, int num_passes) {
+    double dur = stm_sec(stm_since(start));
+    printf("== %-20s %8.3f sec, %8.2f M lines/sec\n",
+        name, dur, ((double)state.num_lines * num_passes / dur) / 1000000.0);
+}
+
+static bool run(rom_t rom, int num_passes) {
+    state.rom = rom;
+    state.num_lines = dasm_per_op(state.ref);
+    printf("%s: %d lines\n", rom.name, state.num_lines);
+
+    uint64_t start = stm_now();
+    for (int i = 0; i < num_passes; i++) {
+        dasm_per_op(state.lines);
+    }
+    report("per-op callbacks:", start, num_passes);
+
+    start = stm_now();
+    for (int i = 0; i < num_passes; i++) {
+        dasm_flush_cache();
+        dasm_batch(state.lines);
+    }
+    report("batch (cold):", start, num_passes);
+    if (!verify()) {
+        return false;
+    }
+
+    dasm_flush_cache();
+    dasm_batch(state.lines);
+    const dasm_stats_t s0 = dasm_stats();
+    start = stm_now();
+    for (int i = 0; i < num_passes; i++) {
+        dasm_batch(state.lines);
+    }
+    report("batch (warm):", start, num_passes);
+    if (!verify()) {
+        return false;
+    }
+    const dasm_stats_t s1 = dasm_stats();
+    printf("   table hits: %llu, cache hits: %llu, misses: %llu\n",
+        (unsigned long long)(s1.table_hits - s0.table_hits),
+        (unsigned long long)(s1.cache_hits - s0.cache_hits),
+        (unsigned long long)(s1.misses - s0.misses));
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const int num_passes = (argc > 1) ? atoi(argv[1]) : NUM_PASSES;
+    stm_setup();
+    dasm_init();
+    bool ok = run((rom_t){
+        .name = "ZX Spectrum 48K ROM",
+        .cpu_type = DASM_CPUTYPE_Z80,
+        .base = 0x0000,
+        .rom = dump_amstrad_zx48k_bin,
+        .rom_size = sizeof(dump_amstrad_zx48k_bin),
+    }, num_passes);
+    ok &= run((rom_t){
+        .name = "C64 KERNAL ROM",
+        .cpu_type = DASM_CPUTYPE_M6502,
+        .base = 0xE000,
+        .rom = dump_c64_kernalv3_bin,
+        .rom_size = sizeof(dump_c64_kernalv3_bin),
+    }, num_passes);
+    if (!ok) {
+        return 10;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+//  framedelta-test.c
+//  Test the palette-indexed frame delta encoding.
+//------------------------------------------------------------------------------
+#include "framedelta.h"
+#include "utest.h"
+#include <string.h>
+
+#define T(b) ASSERT_TRUE(b)
+
+#define WIDTH (320)
+#define HEIGHT (16)
+
+static uint8_t prev[WIDTH * HEIGHT];
+static uint8_t cur[WIDTH * HEIGHT];
+static uint8_t out[WIDTH * HEIGHT];
+static uint8_t enc[FRAMEDELTA_MAX_SIZE(WIDTH, HEIGHT)];
+
+static uint32_t rnd_state = 0x12345678;
+static uint8_t rnd(void) {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return (uint8_t)rnd_state;
+}
+
+UTEST(framedelta, keyframe) {
+    // runs, literals and mixed content
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        const int y = i / WIDTH;
+        cur[i] = (y < 4) ? 6 : ((y < 8) ? rnd() : (uint8_t)((i / 5) & 15));
+    }
+    const size_t size = framedelta_encode(0, cur, WIDTH, HEIGHT, enc, sizeof(enc));
+    T(size > 0);
+    // the runs compress well
+    T(size < (2 + HEIGHT * 4 + 8 * WIDTH));
+    memset(out, 0xFF, sizeof(out));
+    T(framedelta_decode(enc, size, out, WIDTH, HEIGHT));
+    T(0 == memcmp(out, cur, sizeof(cur)));
+}
+
+UTEST(framedelta, changed_rows) {
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        prev[i] = cur[i] = (uint8_t)(i & 15);
+    }
+    // unchanged frame
+    size_t size = framedelta_encode(prev, cur, WIDTH, HEIGHT, enc, sizeof(enc));
+    T(size == 2);
+    T(enc[0] == 0 && enc[1] == 0);
+    // two changed rows
+    cur[3 * WIDTH + 100] = 0x20;
+    cur[9 * WIDTH] = 0x21;
+    size = framedelta_encode(prev, cur, WIDTH, HEIGHT, enc, sizeof(enc));
+    T(enc[0] == 2);
+    T(enc[2] == 3);
+    memcpy(out, prev, sizeof(out));
+    T(framedelta_decode(enc, size, out, WIDTH, HEIGHT));
+    T(0 == memcmp(out, cur, sizeof(cur)));
+}
+
+UTEST(framedelta, worst_case) {
+    // patterns which defeat the run-length encoding must still fit
+    const uint8_t patterns[3][6] = {
+        { 0, 1, 2, 3, 4, 5 },
+        { 0, 0, 1, 1, 2, 2 },
+        { 0, 0, 0, 1, 2, 3 },
+    };
+    for (int p = 0; p < 3; p++) {
+        for (int i = 0; i < WIDTH * HEIGHT; i++) {
+            cur[i] = patterns[p][i % 6];
+        }
+        const size_t size = framedelta_encode(0, cur, WIDTH, HEIGHT, enc, sizeof(enc));
+        T((size > 0) && (size <= sizeof(enc)));
+        T(framedelta_decode(enc, size, out, WIDTH, HEIGHT));
+        T(0 == memcmp(out, cur, sizeof(cur)));
+    }
+    // a too small output buffer
+    T(0 == framedelta_encode(0, cur, WIDTH, HEIGHT, enc, sizeof(enc) - 1));
+}
+
+UTEST(framedelta, malformed) {
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        cur[i] = rnd() & 3;
+    }
+    const size_t size = framedelta_encode(0, cur, WIDTH, HEIGHT, enc, sizeof(enc));
+    T(!framedelta_decode(enc, 1, out, WIDTH, HEIGHT));
+    T(!framedelta_decode(enc, size - 1, out, WIDTH, HEIGHT));
+    // row index out of range
+    enc[2] = HEIGHT;
+    T(!framedelta_decode(enc, size, out, WIDTH, HEIGHT));
+}
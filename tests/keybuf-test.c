@@ -0,0 +1,151 @@
+//------------------------------------------------------------------------------
+//  keybuf-test.c
+//  Test the keyboard playback buffer and its conditional wait commands.
+//------------------------------------------------------------------------------
+#include "keybuf.h"
+#include "utest.h"
+#include <string.h>
+
+#define T(b) ASSERT_TRUE(b)
+
+#define FRAME_US (16667)
+
+static struct {
+    bool pc_reached;
+    uint16_t pc_addr;
+    uint8_t mem[0x10000];
+    const char* screen;
+} sys;
+
+static bool pc_reached(uint16_t addr, void* user_data) {
+    (void)user_data;
+    sys.pc_addr = addr;
+    return sys.pc_reached;
+}
+
+static uint8_t mem_rd(uint16_t addr, void* user_data) {
+    (void)user_data;
+    return sys.mem[addr];
+}
+
+static bool screen_contains(const char* text, void* user_data) {
+    (void)user_data;
+    return 0 != strstr(sys.screen, text);
+}
+
+static void init(void) {
+    memset(&sys, 0, sizeof(sys));
+    sys.screen = "";
+    keybuf_init(&(keybuf_desc_t){
+        .key_delay_frames = 2,
+        .wait_timeout_frames = 200,
+        .sys = {
+            .pc_reached = pc_reached,
+            .mem_rd = mem_rd,
+            .screen_contains = screen_contains,
+        },
+    });
+}
+
+// call keybuf_get() until a key is returned, returns the number of calls
+static int frames_until_key(uint8_t* out_key, int max_frames) {
+    for (int i = 1; i <= max_frames; i++) {
+        const uint8_t c = keybuf_get(FRAME_US);
+        if (c != 0) {
+            *out_key = c;
+            return i;
+        }
+    }
+    *out_key = 0;
+    return max_frames + 1;
+}
+
+UTEST(keybuf, keys) {
+    init();
+    keybuf_put("AB\n${key:3}");
+    uint8_t c;
+    T(frames_until_key(&c, 10) == 1 && c == 'A');
+    T(frames_until_key(&c, 10) == 3 && c == 'B');
+    T(frames_until_key(&c, 10) == 3 && c == 0x0D);
+    T(frames_until_key(&c, 10) == 3 && c == 3);
+    T(frames_until_key(&c, 10) == 11 && c == 0);
+}
+
+UTEST(keybuf, waitpc) {
+    init();
+    keybuf_put("${waitpc:E5CD}X");
+    uint8_t c;
+    uint16_t addr = 0;
+    T(!keybuf_wait_pc(&addr));
+    T(frames_until_key(&c, 100) == 101);
+    T(keybuf_wait_pc(&addr) && (addr == 0xE5CD));
+    T(sys.pc_addr == 0xE5CD);
+    sys.pc_reached = true;
+    // condition met, then one key delay
+    T(frames_until_key(&c, 10) == 4 && c == 'X');
+    T(!keybuf_wait_pc(&addr));
+}
+
+UTEST(keybuf, waitpc_malformed) {
+    init();
+    // not hex, trailing garbage and out of range addresses are skipped
+    keybuf_put("${waitpc:XYZ}A${waitpc:E5CDQ}B${waitpc:12345}C");
+    uint8_t c;
+    uint16_t addr;
+    T(frames_until_key(&c, 10) == 4 && c == 'A');
+    T(!keybuf_wait_pc(&addr));
+    T(frames_until_key(&c, 10) == 6 && c == 'B');
+    T(!keybuf_wait_pc(&addr));
+    T(frames_until_key(&c, 10) == 6 && c == 'C');
+    T(!keybuf_wait_pc(&addr));
+}
+
+UTEST(keybuf, waitmem) {
+    init();
+    keybuf_put("${waitmem:00c6=0A}Y${waitmem:1234=}Z");
+    sys.mem[0x00C6] = 0x09;
+    uint8_t c;
+    T(frames_until_key(&c, 100) == 101);
+    sys.mem[0x00C6] = 0x0A;
+    T(frames_until_key(&c, 10) == 4 && c == 'Y');
+    // malformed commands are skipped
+    T(frames_until_key(&c, 10) == 6 && c == 'Z');
+}
+
+UTEST(keybuf, waitscreen) {
+    init();
+    keybuf_put("${waitscreen:READY.}RUN\n");
+    sys.screen = "LOADING";
+    uint8_t c;
+    T(frames_until_key(&c, 100) == 101);
+    sys.screen = "LOADING\nREADY.";
+    T(frames_until_key(&c, 10) == 4 && c == 'R');
+}
+
+UTEST(keybuf, no_callbacks) {
+    // without system callbacks the wait commands are skipped
+    keybuf_init(&(keybuf_desc_t){ .key_delay_frames = 2 });
+    keybuf_put("${waitpc:E5CD}${waitmem:C6=0}${waitscreen:READY.}X");
+    uint8_t c;
+    uint16_t addr;
+    T(frames_until_key(&c, 1) == 2);
+    T(!keybuf_wait_pc(&addr));
+    T(frames_until_key(&c, 20) < 20 && c == 'X');
+}
+
+UTEST(keybuf, wait_timeout) {
+    init();
+    keybuf_put("${waitscreen:READY.}X");
+    uint8_t c;
+    // the condition is never met, playback continues after the timeout
+    T(frames_until_key(&c, 150) == 151);
+    T(frames_until_key(&c, 100) == 54 && c == 'X');
+}
+
+UTEST(keybuf, long_screen_text) {
+    init();
+    keybuf_put("${waitscreen:A VERY LONG TEXT WHICH DOESN'T FIT INTO 8 BYTES}Q");
+    sys.screen = "A VERY LONG TEXT WHICH DOESN'T FIT INTO 8 BYTES";
+    uint8_t c;
+    T(frames_until_key(&c, 10) == 5 && c == 'Q');
+}
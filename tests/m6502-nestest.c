@@ -1,7 +1,8 @@
 //------------------------------------------------------------------------------
 //  m6502-nestest.c
 //
-//  Tests CPU state after documented instructions, no BCD mode.
+//  Tests CPU state and cycle count after documented instructions, no BCD mode.
+//  The CPU is run instruction by instruction via step().
 //------------------------------------------------------------------------------
 #define CHIPS_IMPL
 #include "chips/m6502.h"
@@ -35,6 +36,16 @@ uint64_t tick(uint64_t pins) {
     return pins;
 }
 
+/* run one complete instruction, return number of ticks */
+uint32_t step(uint64_t* pins) {
+    uint32_t ticks = 0;
+    do {
+        *pins = tick(*pins);
+        ticks++;
+    } while (0 == (*pins & M6502_SYNC));
+    return ticks;
+}
+
 int main() {
     test_begin("NES TEST (m6502)");
     test_no_verbose();
@@ -82,12 +93,14 @@ int main() {
         T(cpu.Y  == state->Y);
         T((cpu.P & ~(M6502_XF|M6502_BF)) == (state->P & ~(M6502_XF|M6502_BF)));
         T(cpu.S == state->S);
+        const uint32_t ticks = step(&pins);
+        /* the log's CYC column counts PPU dots (3 per CPU cycle) per 341-dot scanline */
+        if ((i + 1) < num_tests) {
+            T(((state->CYC + ticks * 3) % 341) == state_table[i + 1].CYC);
+        }
         if (test_failed()) {
-            printf("### NESTEST failed at pos %d, PC=0x%04X: %s\n", i, cpu.PC, state->desc);
+            printf("### NESTEST failed at pos %d, PC=0x%04X: %s\n", i, state->PC, state->desc);
         }
-        do {
-            pins = tick(pins);
-        } while (0 == (pins & M6502_SYNC));
     }
     return test_end();
 }
@@ -217,10 +217,12 @@ int main() {
     bool done = false;
     uint64_t start_time = stm_now();
     uint64_t ticks = 0;
+    uint64_t ops = 0;
     while (!done) {
         tick();
         ticks++;
         if (cpu_pins & M6502_SYNC) {
+            ops++;
             int trap_id = test_traps();
             if (0 != trap_id) {
                 if (!handle_trap(trap_id)) {
@@ -231,6 +233,7 @@ int main() {
     }
     double dur = stm_sec(stm_since(start_time));
     printf("\n%"PRIu64" cycles in %.3fsecs (%.2f MHz)\n", ticks, dur, (ticks/dur)/1000000.0);
+    printf("%"PRIu64" instructions (%.2f emulated MIPS, %.2f cycles per instruction)\n", ops, (ops/dur)/1000000.0, (double)ticks/(double)ops);
     putchar('\n');
     return 0;
 }
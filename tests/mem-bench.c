@@ -0,0 +1,71 @@
+//------------------------------------------------------------------------------
+//  mem-bench.c
+//
+//  Microbenchmark for C64-style bank switching, compares remapping the
+//  mem_t page table on every switch with switching between precomputed
+//  configurations. Installing a precomputed config copies the whole mem_t
+//  (all layers), selecting a mem_t pointer is only an upper bound: c64.h
+//  owns its mem_t and can't switch it by pointer. Optional first arg is
+//  the number of bank switches.
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#define CHIPS_IMPL
+#include "chips/mem.h"
+#include "c64-memmap.h"
+
+#define NUM_SWITCHES (10*1000*1000)
+
+static struct {
+    c64_banks_t banks;
+    mem_t mem;
+    mem_t configs[8];
+} state;
+
+static void report(const char* name, uint64_t start, int num_switches, uint32_t checksum) {
+    double dur = stm_sec(stm_since(start));
+    printf("== %-24s %8.3f sec, %10.2f M switches/sec (checksum: %u)\n",
+        name, dur, (num_switches / dur) / 1000000.0, checksum);
+}
+
+int main(int argc, char* argv[]) {
+    const int num_switches = (argc > 1) ? atoi(argv[1]) : NUM_SWITCHES;
+    stm_setup();
+    for (int i = 0; i < (int)sizeof(state.banks.ram); i++) {
+        state.banks.ram[i] = (uint8_t) i;
+    }
+    mem_init(&state.mem);
+    for (uint8_t port = 0; port < 8; port++) {
+        mem_init(&state.configs[port]);
+        c64_remap(&state.configs[port], &state.banks, port);
+    }
+    // alternate between the BASIC/KERNAL and all-RAM configs, and read a byte
+    // from the switched area after each switch so the work isn't optimized away
+    const uint8_t ports[4] = { 7, 4, 6, 5 };
+    uint32_t checksum = 0;
+    uint64_t start = stm_now();
+    for (int i = 0; i < num_switches; i++) {
+        c64_remap(&state.mem, &state.banks, ports[i & 3]);
+        checksum += mem_rd(&state.mem, 0xA000 + (i & 0x1FFF));
+    }
+    report("remap:", start, num_switches, checksum);
+
+    checksum = 0;
+    start = stm_now();
+    for (int i = 0; i < num_switches; i++) {
+        state.mem = state.configs[ports[i & 3]];
+        checksum += mem_rd(&state.mem, 0xA000 + (i & 0x1FFF));
+    }
+    report("copy mem_t:", start, num_switches, checksum);
+
+    checksum = 0;
+    start = stm_now();
+    for (int i = 0; i < num_switches; i++) {
+        mem_t* mem = &state.configs[ports[i & 3]];
+        checksum += mem_rd(mem, 0xA000 + (i & 0x1FFF));
+    }
+    report("select mem_t pointer:", start, num_switches, checksum);
+    return 0;
+}
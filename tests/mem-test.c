@@ -4,6 +4,7 @@
 //------------------------------------------------------------------------------
 #define CHIPS_IMPL
 #include "chips/mem.h"
+#include "c64-memmap.h"
 #include "utest.h"
 
 #define T(b) ASSERT_TRUE(b)
@@ -67,3 +68,71 @@ UTEST(mem, mem) {
 }
 
 
+/* what the CPU sees in the switchable areas, from the C64 memory map */
+typedef enum { AREA_RAM, AREA_BASIC, AREA_CHARS, AREA_KERNAL, AREA_IO } c64_area_t;
+static const struct {
+    c64_area_t a000, d000, e000;
+} c64_memory_map[8] = {
+    { AREA_RAM,   AREA_RAM,   AREA_RAM },     /* 0: all RAM */
+    { AREA_RAM,   AREA_CHARS, AREA_RAM },     /* 1: LORAM */
+    { AREA_RAM,   AREA_CHARS, AREA_KERNAL },  /* 2: HIRAM */
+    { AREA_BASIC, AREA_CHARS, AREA_KERNAL },  /* 3: LORAM|HIRAM */
+    { AREA_RAM,   AREA_RAM,   AREA_RAM },     /* 4: CHAREN, all RAM */
+    { AREA_RAM,   AREA_IO,    AREA_RAM },     /* 5: CHAREN|LORAM */
+    { AREA_RAM,   AREA_IO,    AREA_KERNAL },  /* 6: CHAREN|HIRAM */
+    { AREA_BASIC, AREA_IO,    AREA_KERNAL },  /* 7: CHAREN|LORAM|HIRAM, power-on default */
+};
+
+static const uint8_t* c64_area_ptr(c64_banks_t* b, c64_area_t area, uint16_t addr) {
+    switch (area) {
+        case AREA_BASIC:    return &b->basic[addr - 0xA000];
+        case AREA_CHARS:    return &b->chars[addr - 0xD000];
+        case AREA_KERNAL:   return &b->kernal[addr - 0xE000];
+        /* I/O isn't emulated by c64_remap(), it reads RAM */
+        default:            return &b->ram[addr];
+    }
+}
+
+UTEST(mem, c64_precomputed_configs) {
+    static c64_banks_t banks;
+    static mem_t configs[8];
+    for (int i = 0; i < (int)sizeof(banks.ram); i++) {
+        banks.ram[i] = (uint8_t) i;
+    }
+    memset(banks.basic, 0xBA, sizeof(banks.basic));
+    memset(banks.chars, 0xC4, sizeof(banks.chars));
+    memset(banks.kernal, 0xEE, sizeof(banks.kernal));
+
+    /* precompute all processor port configurations once */
+    for (uint8_t port = 0; port < 8; port++) {
+        mem_init(&configs[port]);
+        c64_remap(&configs[port], &banks, port);
+    }
+
+    /* each config must read from the areas of the C64 memory map */
+    for (uint8_t port = 0; port < 8; port++) {
+        mem_t* mem = &configs[port];
+        for (uint32_t addr = 0; addr < 0x10000; addr += 0x80) {
+            c64_area_t area = AREA_RAM;
+            if ((addr >= 0xA000) && (addr < 0xC000)) {
+                area = c64_memory_map[port].a000;
+            }
+            else if ((addr >= 0xD000) && (addr < 0xE000)) {
+                area = c64_memory_map[port].d000;
+            }
+            else if (addr >= 0xE000) {
+                area = c64_memory_map[port].e000;
+            }
+            const uint8_t* ptr = c64_area_ptr(&banks, area, (uint16_t)addr);
+            T(mem_readptr(mem, (uint16_t)addr) == ptr);
+            T(mem_rd(mem, (uint16_t)addr) == *ptr);
+        }
+        /* writes always go to RAM, also behind ROM */
+        mem_wr(mem, 0xA123, port);
+        T(banks.ram[0xA123] == port);
+        mem_wr(mem, 0xD123, port);
+        T(banks.ram[0xD123] == port);
+        mem_wr(mem, 0xE123, port);
+        T(banks.ram[0xE123] == port);
+    }
+}
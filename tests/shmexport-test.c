@@ -0,0 +1,133 @@
+//------------------------------------------------------------------------------
+//  shmexport-test.c
+//  Test the shared-memory frame and audio rings.
+//------------------------------------------------------------------------------
+#include "shmexport.h"
+#include "utest.h"
+#include <string.h>
+
+#define T(b) ASSERT_TRUE(b)
+
+// no shared memory on Windows and the web
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <stdio.h>
+#include <unistd.h>
+
+#define FB_WIDTH (16)
+#define FB_HEIGHT (8)
+
+static uint8_t fb[FB_WIDTH * FB_HEIGHT];
+static uint32_t palette[16];
+
+static chips_display_info_t display_info(uint8_t frame) {
+    for (int i = 0; i < FB_WIDTH * FB_HEIGHT; i++) {
+        fb[i] = (uint8_t)((i + frame) & 15);
+    }
+    for (int i = 0; i < 16; i++) {
+        palette[i] = 0xFF000000 | (uint32_t)(i * 0x111111);
+    }
+    return (chips_display_info_t){
+        .frame = {
+            .dim = { .width = FB_WIDTH, .height = FB_HEIGHT },
+            .buffer = { .ptr = fb, .size = sizeof(fb) },
+            .bytes_per_pixel = 1,
+        },
+        .screen = { .x = 2, .y = 1, .width = 8, .height = 4 },
+        .palette = { .ptr = palette, .size = sizeof(palette) },
+    };
+}
+
+// one shared-memory object per process, so that parallel test runs don't collide
+static const char* shm_name(void) {
+    static char name[64];
+    snprintf(name, sizeof(name), "/chips-shmexport-test-%d", (int)getpid());
+    return name;
+}
+
+static bool init(void) {
+    return shmexport_init(&(shmexport_desc_t){
+        .name = shm_name(),
+        .display_info = display_info(0),
+        .sample_rate = 44100,
+    });
+}
+
+UTEST(shmexport, frames) {
+    T(init());
+    T(shmexport_active());
+    const shmexport_header_t* hdr = shmexport_attach(shm_name());
+    T(hdr);
+    T(hdr->sample_rate == 44100);
+    T(shmexport_frame_seq(hdr) == 0);
+    T(shmexport_frame_begin(hdr, 1) == 0);
+
+    const chips_display_info_t info = display_info(3);
+    shmexport_frame(info);
+    T(shmexport_frame_seq(hdr) == 1);
+    const shmexport_frame_t* frame = shmexport_frame_begin(hdr, 1);
+    T(frame);
+    T(frame->width == 8);
+    T(frame->height == 4);
+    T(frame->bytes_per_pixel == 1);
+    T(frame->num_colors == 16);
+    T(0 == memcmp(frame->palette, palette, sizeof(palette)));
+    const uint8_t* pixels = shmexport_frame_pixels(frame);
+    for (int y = 0; y < 4; y++) {
+        T(0 == memcmp(&pixels[y * 8], &fb[(y + 1) * FB_WIDTH + 2], 8));
+    }
+    T(shmexport_frame_end(frame, 1));
+    T(shmexport_frame_begin(hdr, 2) == 0);
+
+    shmexport_detach(hdr);
+    shmexport_shutdown();
+    T(!shmexport_active());
+    T(shmexport_attach(shm_name()) == 0);
+}
+
+UTEST(shmexport, lapped) {
+    T(init());
+    const shmexport_header_t* hdr = shmexport_attach(shm_name());
+    T(hdr);
+    for (int i = 0; i < SHMEXPORT_NUM_FRAME_SLOTS; i++) {
+        shmexport_frame(display_info((uint8_t)i));
+    }
+    // start reading the oldest frame, and let the producer overwrite it
+    const shmexport_frame_t* frame = shmexport_frame_begin(hdr, 1);
+    T(frame);
+    shmexport_frame(display_info(0));
+    T(!shmexport_frame_end(frame, 1));
+    T(shmexport_frame_begin(hdr, 1) == 0);
+    frame = shmexport_frame_begin(hdr, SHMEXPORT_NUM_FRAME_SLOTS + 1);
+    T(frame);
+    T(shmexport_frame_end(frame, SHMEXPORT_NUM_FRAME_SLOTS + 1));
+    shmexport_detach(hdr);
+    shmexport_shutdown();
+}
+
+UTEST(shmexport, audio) {
+    static float samples[2500];
+    for (int i = 0; i < 2500; i++) {
+        samples[i] = (float)i;
+    }
+    T(init());
+    const shmexport_header_t* hdr = shmexport_attach(shm_name());
+    T(hdr);
+    shmexport_frame(display_info(0));
+    shmexport_audio(samples, 2500);
+    T(shmexport_audio_seq(hdr) == 3);
+    const uint32_t sizes[3] = { SHMEXPORT_MAX_AUDIO_SAMPLES, SHMEXPORT_MAX_AUDIO_SAMPLES, 2500 - 2 * SHMEXPORT_MAX_AUDIO_SAMPLES };
+    int offset = 0;
+    for (uint64_t seq = 1; seq <= 3; seq++) {
+        const shmexport_audio_t* audio = shmexport_audio_begin(hdr, seq);
+        T(audio);
+        T(audio->num_samples == sizes[seq - 1]);
+        T(audio->frame_seq == 1);
+        T(0 == memcmp(audio->samples, &samples[offset], audio->num_samples * sizeof(float)));
+        T(shmexport_audio_end(audio, seq));
+        offset += (int)audio->num_samples;
+    }
+    shmexport_detach(hdr);
+    shmexport_shutdown();
+}
+
+#endif
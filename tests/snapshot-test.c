@@ -0,0 +1,79 @@
+//------------------------------------------------------------------------------
+//  snapshot-test.c
+//  Test packing system snapshots without excluded ranges.
+//------------------------------------------------------------------------------
+#include "snapshot.h"
+#include "utest.h"
+#include <string.h>
+
+#define T(b) ASSERT_TRUE(b)
+
+typedef struct {
+    uint32_t regs[4];
+    uint8_t ram[256];
+    uint8_t rom[128];
+    uint8_t fb[512];
+    uint8_t color_ram[16];
+} test_sys_t;
+
+static const snapshot_range_t exclude[] = {
+    SNAPSHOT_RANGE(test_sys_t, fb),
+    SNAPSHOT_RANGE(test_sys_t, rom),
+};
+
+static void fill(test_sys_t* sys, uint8_t seed) {
+    uint8_t* ptr = (uint8_t*)sys;
+    for (size_t i = 0; i < sizeof(test_sys_t); i++) {
+        ptr[i] = (uint8_t)(i * 7 + seed);
+    }
+}
+
+UTEST(snapshot, layout) {
+    const snapshot_layout_t layout = snapshot_layout(sizeof(test_sys_t), exclude, 2);
+    // rom and fb are adjacent and merged into one range
+    T(layout.num_ranges == 1);
+    T(layout.ranges[0].offset == offsetof(test_sys_t, rom));
+    T(layout.ranges[0].size == (sizeof(((test_sys_t*)0)->rom) + sizeof(((test_sys_t*)0)->fb)));
+    T(layout.packed_size == (sizeof(test_sys_t) - 128 - 512));
+
+    // overlapping and separate ranges
+    const snapshot_range_t ranges[] = {
+        { 40, 10 }, { 0, 8 }, { 45, 20 }, { 100, 0 },
+    };
+    const snapshot_layout_t l2 = snapshot_layout(sizeof(test_sys_t), ranges, 4);
+    T(l2.num_ranges == 2);
+    T((l2.ranges[0].offset == 0) && (l2.ranges[0].size == 8));
+    T((l2.ranges[1].offset == 40) && (l2.ranges[1].size == 25));
+    T(l2.packed_size == (sizeof(test_sys_t) - 33));
+}
+
+UTEST(snapshot, pack_unpack) {
+    static test_sys_t running, saved, restored;
+    static uint8_t buf[sizeof(test_sys_t)];
+    const snapshot_layout_t layout = snapshot_layout(sizeof(test_sys_t), exclude, 2);
+    fill(&saved, 1);
+    T(snapshot_pack(&layout, &saved, buf, sizeof(buf)) == layout.packed_size);
+    T(snapshot_pack(&layout, &saved, buf, layout.packed_size - 1) == 0);
+
+    // the excluded state comes from the running instance
+    fill(&running, 2);
+    restored = running;
+    T(!snapshot_unpack(&layout, buf, layout.packed_size - 1, &restored));
+    T(snapshot_unpack(&layout, buf, layout.packed_size, &restored));
+    T(0 == memcmp(restored.regs, saved.regs, sizeof(saved.regs)));
+    T(0 == memcmp(restored.ram, saved.ram, sizeof(saved.ram)));
+    T(0 == memcmp(restored.color_ram, saved.color_ram, sizeof(saved.color_ram)));
+    T(0 == memcmp(restored.rom, running.rom, sizeof(running.rom)));
+    T(0 == memcmp(restored.fb, running.fb, sizeof(running.fb)));
+}
+
+UTEST(snapshot, no_exclude) {
+    static test_sys_t sys, restored;
+    static uint8_t buf[sizeof(test_sys_t)];
+    const snapshot_layout_t layout = snapshot_layout(sizeof(test_sys_t), 0, 0);
+    T(layout.packed_size == sizeof(test_sys_t));
+    fill(&sys, 3);
+    T(snapshot_pack(&layout, &sys, buf, sizeof(buf)) == sizeof(test_sys_t));
+    T(snapshot_unpack(&layout, buf, sizeof(buf), &restored));
+    T(0 == memcmp(&sys, &restored, sizeof(sys)));
+}
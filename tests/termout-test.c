@@ -0,0 +1,121 @@
+//------------------------------------------------------------------------------
+//  termout-test.c
+//  Test the non-blocking terminal output and frame skipping.
+//------------------------------------------------------------------------------
+#include "termout.h"
+#include "utest.h"
+#include <string.h>
+
+#define T(b) ASSERT_TRUE(b)
+
+// no non-blocking output on Windows and the web
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+// larger than any pipe buffer
+#define FRAME_SIZE (1<<20)
+
+static uint8_t frame[FRAME_SIZE];
+static uint8_t recv_buf[FRAME_SIZE];
+
+// read everything from the pipe, returns the number of bytes read
+static size_t drain(int fd, size_t offset) {
+    size_t total = 0;
+    ssize_t res;
+    while ((res = read(fd, &recv_buf[offset + total], sizeof(recv_buf) - offset - total)) > 0) {
+        total += (size_t)res;
+    }
+    return total;
+}
+
+UTEST(termout, backpressure) {
+    int fds[2];
+    T(0 == pipe(fds));
+    T(0 == fcntl(fds[0], F_SETFL, O_NONBLOCK));
+    for (int i = 0; i < FRAME_SIZE; i++) {
+        frame[i] = (uint8_t)(i * 7);
+    }
+    termout_init(&(termout_desc_t){ .fd = fds[1] });
+    T(termout_backlog() == 0);
+
+    // a frame larger than the pipe buffer doesn't block, the rest is pending
+    T(termout_begin_frame());
+    termout_write(frame, FRAME_SIZE);
+    termout_end_frame();
+    const size_t backlog = termout_backlog();
+    T((backlog > 0) && (backlog < FRAME_SIZE));
+
+    // the reader is lagging, so the next frame is skipped
+    T(!termout_begin_frame());
+    termout_stats_t stats = termout_stats();
+    T(stats.frames == 2);
+    T(stats.frames_written == 1);
+    T(stats.frames_dropped == 1);
+    T(stats.max_backlog == backlog);
+
+    // read until the output has caught up, termout_wait() pushes out pending bytes
+    size_t received = 0;
+    for (int i = 0; (i < 1000) && (received < FRAME_SIZE); i++) {
+        received += drain(fds[0], received);
+        termout_wait(1000);
+        termout_frame_time();
+    }
+    T(received == FRAME_SIZE);
+    T(0 == memcmp(recv_buf, frame, FRAME_SIZE));
+    T(termout_backlog() == 0);
+    T(termout_begin_frame());
+    termout_printf("\033[%d;%dH", 12, 34);
+    termout_end_frame();
+    T(drain(fds[0], 0) == 8);
+    T(0 == memcmp(recv_buf, "\033[12;34H", 8));
+    stats = termout_stats();
+    T(stats.bytes_written == (FRAME_SIZE + 8));
+    termout_shutdown();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+UTEST(termout, measure_only) {
+    int fds[2];
+    T(0 == pipe(fds));
+    T(0 == fcntl(fds[0], F_SETFL, O_NONBLOCK));
+    T(0 == fcntl(fds[1], F_SETFL, O_NONBLOCK));
+    termout_init(&(termout_desc_t){ .fd = fds[1], .measure_only = true });
+    T(termout_begin_frame());
+    termout_end_frame();
+    // fill the pipe, frames are skipped while it doesn't accept more output
+    while (write(fds[1], frame, FRAME_SIZE) > 0);
+    T(!termout_begin_frame());
+    // once the reader has caught up, frames are rendered again
+    drain(fds[0], 0);
+    nanosleep(&(struct timespec){ .tv_nsec = 1000000 }, 0);
+    T(termout_begin_frame());
+    termout_end_frame();
+    const termout_stats_t stats = termout_stats();
+    T(stats.frames == 3);
+    T(stats.frames_written == 2);
+    T(stats.frames_dropped == 1);
+    termout_shutdown();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+UTEST(termout, frame_time) {
+    termout_init(&(termout_desc_t){ .measure_only = true, .max_frame_time_us = 20000 });
+    // termout_wait() sleeps until the frame is due
+    termout_wait(5000);
+    uint32_t frame_time_us = termout_frame_time();
+    T((frame_time_us >= 5000) && (frame_time_us <= 20000));
+    // long frames are clamped
+    nanosleep(&(struct timespec){ .tv_nsec = 30000000 }, 0);
+    frame_time_us = termout_frame_time();
+    T(frame_time_us == 20000);
+    const termout_stats_t stats = termout_stats();
+    T(stats.wall_time_us >= 35000);
+    T(stats.emu_time_us < stats.wall_time_us);
+    termout_shutdown();
+}
+
+#endif
@@ -696,14 +696,205 @@ static UTEST_INLINE FILE *utest_fopen(const char *filename, const char *mode) {
 #endif
 }
 
+/*
+   parallel test execution forks one worker process per job, which keeps the
+   global state of the tests isolated between the workers, but not external
+   resources: tests which create files or shared-memory objects must use
+   per-process names (e.g. with getpid()), concurrent test runs share them too
+*/
+#if !defined(_MSC_VER) && !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <sys/types.h>
+#include <sys/wait.h>
+#define UTEST_USE_FORK
+#endif
+
+#define UTEST_MAX_JOBS 256
+
+/* the result of one test, passed from the worker processes to the parent */
+struct utest_result_s {
+  size_t index;
+  int result;
+  int64_t ns;
+};
+
+static int utest_compare_results_by_ns(const void *a, const void *b) {
+  const struct utest_result_s *ra = UTEST_PTR_CAST(const struct utest_result_s *, a);
+  const struct utest_result_s *rb = UTEST_PTR_CAST(const struct utest_result_s *, b);
+  return (ra->ns < rb->ns) ? 1 : ((ra->ns > rb->ns) ? -1 : 0);
+}
+
+/*
+   run every step-th test of the run list, starting at first, and store the
+   results in the results array (which is parallel to the run list), if
+   results_file is set, the results are also written to that file as they
+   come in
+*/
+static void utest_run_tests(const size_t *run_list, size_t run_length,
+                            size_t first, size_t step,
+                            struct utest_result_s *results,
+                            FILE *results_file, const char *const *colours) {
+  size_t i;
+  for (i = first; i < run_length; i += step) {
+    const size_t index = run_list[i];
+    int result = 0;
+    int64_t ns = 0;
+
+    printf("%s[ RUN      ]%s %s\n", colours[1], colours[0],
+           utest_state.tests[index].name);
+    if (results_file) {
+      fflush(stdout);
+    }
+
+    if (utest_state.output) {
+      fprintf(utest_state.output, "<testcase name=\"%s\">",
+              utest_state.tests[index].name);
+    }
+
+    ns = utest_ns();
+    utest_state.tests[index].func(&result, utest_state.tests[index].index);
+    ns = utest_ns() - ns;
+
+    if (utest_state.output) {
+      fprintf(utest_state.output, "</testcase>\n");
+    }
+
+    if (0 != result) {
+      printf("%s[  FAILED  ]%s %s (%" UTEST_PRId64 "ns)\n", colours[2],
+             colours[0], utest_state.tests[index].name, ns);
+    } else {
+      printf("%s[       OK ]%s %s (%" UTEST_PRId64 "ns)\n", colours[1],
+             colours[0], utest_state.tests[index].name, ns);
+    }
+
+    results[i].index = index;
+    results[i].result = result;
+    results[i].ns = ns;
+    if (results_file) {
+      /* flush after each test, so that a crashing test doesn't lose the
+         results and output of the tests before it */
+      fwrite(&results[i], sizeof(results[i]), 1, results_file);
+      fflush(results_file);
+      fflush(stdout);
+    }
+  }
+}
+
+#if defined(UTEST_USE_FORK)
+/*
+   run the run list on jobs worker processes, each worker runs every jobs-th
+   test, the output of a worker is printed in one piece once the worker is
+   done, tests which didn't report a result (because their worker crashed)
+   count as failed
+*/
+static void utest_run_workers(const size_t *run_list, size_t run_length,
+                              size_t jobs, struct utest_result_s *results,
+                              const char *const *colours) {
+  pid_t pids[UTEST_MAX_JOBS];
+  FILE *logs[UTEST_MAX_JOBS];
+  FILE *result_files[UTEST_MAX_JOBS];
+  size_t job;
+  size_t i;
+
+  /* anything buffered would otherwise be written by every worker */
+  fflush(stdout);
+  if (utest_state.output) {
+    fflush(utest_state.output);
+  }
+
+  for (job = 0; job < jobs; job++) {
+    pids[job] = -1;
+    logs[job] = tmpfile();
+    result_files[job] = tmpfile();
+    if (logs[job] && result_files[job]) {
+      pids[job] = fork();
+    }
+    if (0 == pids[job]) {
+      /* the worker: redirect the output, the parent writes the xunit file */
+      dup2(fileno(logs[job]), STDOUT_FILENO);
+      utest_state.output = 0;
+      utest_run_tests(run_list, run_length, job, jobs, results,
+                      result_files[job], colours);
+      fflush(stdout);
+      _exit(0);
+    }
+  }
+
+  for (job = 0; job < jobs; job++) {
+    int status = 0;
+    char buf[4096];
+    size_t num_bytes;
+    struct utest_result_s result;
+
+    if (pids[job] < 0) {
+      /* the worker couldn't be started, run its tests in this process */
+      utest_run_tests(run_list, run_length, job, jobs, results, 0, colours);
+    } else {
+      waitpid(pids[job], &status, 0);
+      fflush(stdout);
+      rewind(logs[job]);
+      while (0 < (num_bytes = fread(buf, 1, sizeof(buf), logs[job]))) {
+        fwrite(buf, 1, num_bytes, stdout);
+      }
+      rewind(result_files[job]);
+      while (1 == fread(&result, sizeof(result), 1, result_files[job])) {
+        for (i = job; i < run_length; i += jobs) {
+          if (run_list[i] == result.index) {
+            results[i] = result;
+          }
+        }
+      }
+      if (WIFSIGNALED(status)) {
+        printf("%s[  FAILED  ]%s worker %u was terminated by signal %d\n",
+               colours[2], colours[0], UTEST_CAST(unsigned, job),
+               WTERMSIG(status));
+      } else if (WIFEXITED(status) && (0 != WEXITSTATUS(status))) {
+        printf("%s[  FAILED  ]%s worker %u exited with status %d\n",
+               colours[2], colours[0], UTEST_CAST(unsigned, job),
+               WEXITSTATUS(status));
+      }
+      for (i = job; i < run_length; i += jobs) {
+        if (results[i].ns < 0) {
+          results[i].result = 1;
+          printf("%s[  FAILED  ]%s %s (didn't finish)\n", colours[2],
+                 colours[0], utest_state.tests[run_list[i]].name);
+        }
+      }
+    }
+    if (logs[job]) {
+      fclose(logs[job]);
+    }
+    if (result_files[job]) {
+      fclose(result_files[job]);
+    }
+  }
+
+  if (utest_state.output) {
+    for (i = 0; i < run_length; i++) {
+      fprintf(utest_state.output, "<testcase name=\"%s\">%s</testcase>\n",
+              utest_state.tests[run_list[i]].name,
+              results[i].result ? "<failure/>" : "");
+    }
+  }
+}
+#endif
+
 UTEST_WEAK int utest_main(int argc, const char *const argv[]);
 UTEST_WEAK int utest_main(int argc, const char *const argv[]) {
   uint64_t failed = 0;
   size_t index = 0;
-  size_t *failed_testcases = 0;
-  size_t failed_testcases_length = 0;
+  size_t *run_list = 0;
+  size_t run_length = 0;
+  struct utest_result_s *results = 0;
   const char *filter = 0;
   uint64_t ran_tests = 0;
+  size_t shard_index = 0;
+  size_t shard_count = 1;
+  size_t jobs = 1;
+  size_t slowest = 10;
+  size_t num_finished = 0;
+  size_t num_listed = 0;
+  size_t num_matching = 0;
+  int64_t wall_ns = 0;
 
   enum colours { RESET, GREEN, RED };
 
@@ -719,6 +910,9 @@ UTEST_WEAK int utest_main(int argc, const char *const argv[]) {
     const char help_str[] = "--help";
     const char filter_str[] = "--filter=";
     const char output_str[] = "--output=";
+    const char shard_str[] = "--shard=";
+    const char jobs_str[] = "--jobs=";
+    const char slowest_str[] = "--slowest=";
 
     if (0 == utest_strncmp(argv[index], help_str, strlen(help_str))) {
       printf("utest.h - the single file unit testing solution for C/C++!\n"
@@ -727,7 +921,14 @@ UTEST_WEAK int utest_main(int argc, const char *const argv[]) {
              "  --filter=<filter> Filter the test cases to run (EG. MyTest*.a "
              "would run MyTestCase.a but not MyTestCase.b).\n"
              "  --output=<output> Output an xunit XML file to the file "
-             "specified in <output>.\n");
+             "specified in <output>.\n"
+             "  --shard=<i>/<n>   Only run every n-th of the test cases, "
+             "starting at the i-th (EG. --shard=0/4 to --shard=3/4 on four "
+             "machines).\n"
+             "  --jobs=<n>        Run the test cases in <n> worker processes "
+             "(0: one per CPU, default: 1).\n"
+             "  --slowest=<n>     List the <n> slowest test cases at the end "
+             "(default: 10).\n");
       goto cleanup;
     } else if (0 ==
                utest_strncmp(argv[index], filter_str, strlen(filter_str))) {
@@ -736,17 +937,66 @@ UTEST_WEAK int utest_main(int argc, const char *const argv[]) {
     } else if (0 ==
                utest_strncmp(argv[index], output_str, strlen(output_str))) {
       utest_state.output = utest_fopen(argv[index] + strlen(output_str), "w+");
+    } else if (0 ==
+               utest_strncmp(argv[index], shard_str, strlen(shard_str))) {
+      const char *shard = argv[index] + strlen(shard_str);
+      const char *slash = strchr(shard, '/');
+      shard_index = UTEST_CAST(size_t, strtoul(shard, 0, 10));
+      shard_count = slash ? UTEST_CAST(size_t, strtoul(slash + 1, 0, 10)) : 0;
+      if ((0 == shard_count) || (shard_index >= shard_count)) {
+        printf("Invalid shard '%s', expected <i>/<n> with i < n.\n", shard);
+        failed = 1;
+        goto cleanup;
+      }
+    } else if (0 == utest_strncmp(argv[index], jobs_str, strlen(jobs_str))) {
+      jobs = UTEST_CAST(size_t, strtoul(argv[index] + strlen(jobs_str), 0, 10));
+#if defined(UTEST_USE_FORK) && defined(_SC_NPROCESSORS_ONLN)
+      if (0 == jobs) {
+        const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = (num_cpus > 0) ? UTEST_CAST(size_t, num_cpus) : 1;
+      }
+#endif
+    } else if (0 ==
+               utest_strncmp(argv[index], slowest_str, strlen(slowest_str))) {
+      slowest = UTEST_CAST(
+          size_t, strtoul(argv[index] + strlen(slowest_str), 0, 10));
     }
   }
 
+  /* the tests to run, after the filter and shard were applied */
+  run_list = UTEST_PTR_CAST(
+      size_t *, malloc(sizeof(size_t) * (utest_state.tests_length + 1)));
+  results = UTEST_PTR_CAST(
+      struct utest_result_s *,
+      malloc(sizeof(struct utest_result_s) * (utest_state.tests_length + 1)));
   for (index = 0; index < utest_state.tests_length; index++) {
     if (utest_should_filter_test(filter, utest_state.tests[index].name)) {
       continue;
     }
 
+    if ((num_matching++ % shard_count) != shard_index) {
+      continue;
+    }
+
+    results[run_length].index = index;
+    results[run_length].result = 0;
+    results[run_length].ns = -1;
+    run_list[run_length++] = index;
     ran_tests++;
   }
 
+#if defined(UTEST_USE_FORK)
+  if (jobs > run_length) {
+    jobs = run_length;
+  }
+  if (jobs > UTEST_MAX_JOBS) {
+    jobs = UTEST_MAX_JOBS;
+  }
+#else
+  /* no worker processes on this platform */
+  jobs = 1;
+#endif
+
   printf("%s[==========]%s Running %" UTEST_PRIu64 " test cases.\n",
          colours[GREEN], colours[RESET], UTEST_CAST(uint64_t, ran_tests));
 
@@ -760,56 +1010,56 @@ UTEST_WEAK int utest_main(int argc, const char *const argv[]) {
             UTEST_CAST(uint64_t, ran_tests));
   }
 
-  for (index = 0; index < utest_state.tests_length; index++) {
-    int result = 0;
-    int64_t ns = 0;
-
-    if (utest_should_filter_test(filter, utest_state.tests[index].name)) {
-      continue;
-    }
-
-    printf("%s[ RUN      ]%s %s\n", colours[GREEN], colours[RESET],
-           utest_state.tests[index].name);
-
-    if (utest_state.output) {
-      fprintf(utest_state.output, "<testcase name=\"%s\">",
-              utest_state.tests[index].name);
-    }
-
-    ns = utest_ns();
-    utest_state.tests[index].func(&result, utest_state.tests[index].index);
-    ns = utest_ns() - ns;
-
-    if (utest_state.output) {
-      fprintf(utest_state.output, "</testcase>\n");
-    }
+  wall_ns = utest_ns();
+#if defined(UTEST_USE_FORK)
+  if (jobs > 1) {
+    utest_run_workers(run_list, run_length, jobs, results, colours);
+  } else
+#endif
+  {
+    utest_run_tests(run_list, run_length, 0, 1, results, 0, colours);
+  }
+  wall_ns = utest_ns() - wall_ns;
 
-    if (0 != result) {
-      const size_t failed_testcase_index = failed_testcases_length++;
-      failed_testcases = UTEST_PTR_CAST(
-          size_t *, realloc(UTEST_PTR_CAST(void *, failed_testcases),
-                            sizeof(size_t) * failed_testcases_length));
-      failed_testcases[failed_testcase_index] = index;
+  for (index = 0; index < run_length; index++) {
+    if (0 != results[index].result) {
       failed++;
-      printf("%s[  FAILED  ]%s %s (%" UTEST_PRId64 "ns)\n", colours[RED],
-             colours[RESET], utest_state.tests[index].name, ns);
-    } else {
-      printf("%s[       OK ]%s %s (%" UTEST_PRId64 "ns)\n", colours[GREEN],
-             colours[RESET], utest_state.tests[index].name, ns);
     }
   }
 
   printf("%s[==========]%s %" UTEST_PRIu64 " test cases ran.\n", colours[GREEN],
          colours[RESET], ran_tests);
+  printf("%s[==========]%s %" UTEST_PRId64 "ms wall clock time (jobs: %u).\n",
+         colours[GREEN], colours[RESET], wall_ns / 1000000,
+         UTEST_CAST(unsigned, jobs));
   printf("%s[  PASSED  ]%s %" UTEST_PRIu64 " tests.\n", colours[GREEN],
          colours[RESET], ran_tests - failed);
 
   if (0 != failed) {
     printf("%s[  FAILED  ]%s %" UTEST_PRIu64 " tests, listed below:\n",
            colours[RED], colours[RESET], failed);
-    for (index = 0; index < failed_testcases_length; index++) {
-      printf("%s[  FAILED  ]%s %s\n", colours[RED], colours[RESET],
-             utest_state.tests[failed_testcases[index]].name);
+    for (index = 0; index < run_length; index++) {
+      if (0 != results[index].result) {
+        printf("%s[  FAILED  ]%s %s\n", colours[RED], colours[RESET],
+               utest_state.tests[run_list[index]].name);
+      }
+    }
+  }
+
+  /* tests which didn't finish have no timing and are sorted last */
+  qsort(results, run_length, sizeof(struct utest_result_s),
+        utest_compare_results_by_ns);
+  while ((num_finished < run_length) && (results[num_finished].ns >= 0)) {
+    num_finished++;
+  }
+  num_listed = (slowest < num_finished) ? slowest : num_finished;
+  if (0 != num_listed) {
+    printf("%s[ SLOWEST  ]%s %u slowest tests, listed below:\n",
+           colours[GREEN], colours[RESET], UTEST_CAST(unsigned, num_listed));
+    for (index = 0; index < num_listed; index++) {
+      printf("%s[ SLOWEST  ]%s %s (%.3fms)\n", colours[GREEN],
+             colours[RESET], utest_state.tests[results[index].index].name,
+             UTEST_CAST(double, results[index].ns) / 1000000.0);
     }
   }
 
@@ -822,7 +1072,8 @@ cleanup:
     free(UTEST_PTR_CAST(void *, utest_state.tests[index].name));
   }
 
-  free(UTEST_PTR_CAST(void *, failed_testcases));
+  free(UTEST_PTR_CAST(void *, run_list));
+  free(UTEST_PTR_CAST(void *, results));
   free(UTEST_PTR_CAST(void *, utest_state.tests));
 
   if (utest_state.output) {
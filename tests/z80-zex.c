@@ -3,6 +3,11 @@
 //
 //  Runs Frank Cringle's zexdoc and zexall test through the Z80 emu. Provide
 //  a minimal CP/M environment to make these work.
+//
+//  By default the CP/M system call checks only happen at instruction
+//  boundaries (the CPU itself is still ticked cycle by cycle in step()).
+//  Run with 'z80-zex cycle' to check after every tick instead, this is
+//  useful to validate the instruction-stepped loop.
 //------------------------------------------------------------------------------
 #define CHIPS_IMPL
 #include "chips/z80.h"
@@ -42,6 +47,17 @@ static uint64_t tick(uint64_t pins) {
     return pins;
 }
 
+// run one complete instruction, return number of ticks, after the
+// instruction the opcode fetch of the next instruction is in progress
+static uint32_t step(uint64_t* pins) {
+    uint32_t ticks = 0;
+    do {
+        *pins = tick(*pins);
+        ticks++;
+    } while (!z80_opdone(&state.cpu));
+    return ticks;
+}
+
 // emulate character and string output CP/M system calls
 static bool cpm_bdos(void) {
     bool retval = true;
@@ -67,9 +83,10 @@ static bool cpm_bdos(void) {
     return retval;
 }
 
-static bool run_test(const char* name, uint8_t* prog, size_t prog_num_bytes) {
+static bool run_test(const char* name, uint8_t* prog, size_t prog_num_bytes, bool cycle_stepped) {
     bool running = true;
     uint64_t ticks = 0;
+    uint64_t ops = 0;
 
     memset(state.output, 0, sizeof(state.output));
     memset(state.mem, 0, sizeof(state.mem));
@@ -77,19 +94,49 @@ static bool run_test(const char* name, uint8_t* prog, size_t prog_num_bytes) {
     uint64_t pins = z80_init(&state.cpu);
     state.cpu.sp = 0xF000;
     z80_prefetch(&state.cpu, 0x0100);
+    // z80_prefetch() starts with the overlapped opcode fetch of a NOP,
+    // the first 'op done' after it doesn't complete a real instruction
+    bool prefetched = true;
     uint64_t start_time = stm_now();
-    while (running) {
-        pins = tick(pins);
-        ticks++;
-        // check for BDOS call
-        if (state.cpu.pc == 5) {
-            running = cpm_bdos();
-        } else if (state.cpu.pc == 0) {
-            running = false;
+    if (cycle_stepped) {
+        while (running) {
+            pins = tick(pins);
+            ticks++;
+            if (z80_opdone(&state.cpu)) {
+                if (!prefetched) {
+                    ops++;
+                }
+                prefetched = false;
+            }
+            // check for BDOS call
+            if (state.cpu.pc == 5) {
+                running = cpm_bdos();
+            } else if (state.cpu.pc == 0) {
+                running = false;
+            }
+        }
+    } else {
+        while (running) {
+            ticks += step(&pins);
+            if (!prefetched) {
+                ops++;
+            }
+            prefetched = false;
+            // at the instruction boundary, the opcode fetch address is on the
+            // address bus, redirect the fetch after an emulated BDOS call
+            const uint16_t fetch_addr = Z80_GET_ADDR(pins);
+            if (fetch_addr == 5) {
+                running = cpm_bdos();
+                pins = z80_prefetch(&state.cpu, state.cpu.pc);
+                prefetched = true;
+            } else if (fetch_addr == 0) {
+                running = false;
+            }
         }
     }
     double dur = stm_sec(stm_since(start_time));
     printf("\n%s: %"PRIu64" cycles in %.3fsecs (%.2f MHz)\n", name, ticks, dur, (ticks/dur)/1000000.0);
+    printf("%s: %"PRIu64" instructions (%.2f emulated MIPS, %.2f cycles per instruction)\n", name, ops, (ops/dur)/1000000.0, (double)ticks/(double)ops);
 
     /* check if an error occurred */
     if (state.out_pos > 0) {
@@ -103,9 +150,11 @@ static bool run_test(const char* name, uint8_t* prog, size_t prog_num_bytes) {
     return true;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     stm_setup();
-    if (!run_test("ZEXALL", dump_zexall_com, sizeof(dump_zexall_com))) {
+    const bool cycle_stepped = (argc > 1) && (0 == strcmp(argv[1], "cycle"));
+    printf("running %s-stepped\n", cycle_stepped ? "cycle" : "instruction");
+    if (!run_test("ZEXALL", dump_zexall_com, sizeof(dump_zexall_com), cycle_stepped)) {
         return 10;
     }
     return 0;
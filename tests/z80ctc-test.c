@@ -119,6 +119,78 @@ UTEST(z80ctc, counter) {
     }
 }
 
+/* the down-counter value after every tick and the exact zero-count
+   tick with the 256 prescaler (the timer test above checks prescaler 16)
+*/
+UTEST(z80ctc, timer_prescaler_256) {
+    z80ctc_t ctc;
+    z80ctc_init(&ctc);
+    uint64_t pins = 0;
+
+    /* mode timer, prescaler 256, trigger-auto, const follows */
+    const uint8_t ctrl = Z80CTC_CTRL_MODE_TIMER|Z80CTC_CTRL_PRESCALER_256|
+        Z80CTC_CTRL_TRIGGER_AUTO|Z80CTC_CTRL_CONST_FOLLOWS|Z80CTC_CTRL_CONTROL;
+    pins = _z80ctc_write(&ctc, pins, 0, ctrl);
+    pins = _z80ctc_write(&ctc, pins, 0, 4);
+    for (int r = 0; r < 3; r++) {
+        for (int i = 1; i <= 1024; i++) {
+            pins = z80ctc_tick(&ctc, pins);
+            if (i < 1024) {
+                T(0 == (pins & Z80CTC_ZCTO0));
+                T((4 - (i / 256)) == ctc.chn[0].down_counter);
+            }
+            else {
+                T(pins & Z80CTC_ZCTO0);
+                T(4 == ctc.chn[0].down_counter);
+            }
+        }
+    }
+}
+
+UTEST(z80ctc, timer_multiple_channels) {
+    z80ctc_t ctc;
+    z80ctc_init(&ctc);
+    uint64_t pins = 0;
+
+    /* 3 timers with different periods running at the same time, each
+       must hit zero-count exactly at multiples of its own period
+    */
+    const uint8_t ctrl = Z80CTC_CTRL_MODE_TIMER|Z80CTC_CTRL_PRESCALER_16|
+        Z80CTC_CTRL_TRIGGER_AUTO|Z80CTC_CTRL_CONST_FOLLOWS|Z80CTC_CTRL_CONTROL;
+    const uint8_t constants[3] = { 3, 5, 7 };
+    const uint64_t zcto_pins[3] = { Z80CTC_ZCTO0, Z80CTC_ZCTO1, Z80CTC_ZCTO2 };
+    for (int chn = 0; chn < 3; chn++) {
+        pins = _z80ctc_write(&ctc, pins, chn, ctrl);
+        pins = _z80ctc_write(&ctc, pins, chn, constants[chn]);
+    }
+    int num_zcto[3] = { 0 };
+    for (int i = 1; i <= 5000; i++) {
+        pins = z80ctc_tick(&ctc, pins);
+        for (int chn = 0; chn < 3; chn++) {
+            const bool expected = 0 == (i % (16 * constants[chn]));
+            T(expected == (0 != (pins & zcto_pins[chn])));
+            if (pins & zcto_pins[chn]) {
+                num_zcto[chn]++;
+            }
+        }
+    }
+    T(num_zcto[0] == (5000 / 48));
+    T(num_zcto[1] == (5000 / 80));
+    T(num_zcto[2] == (5000 / 112));
+}
+
+UTEST(z80ctc, idle_channels) {
+    z80ctc_t ctc;
+    z80ctc_init(&ctc);
+    uint64_t pins = 0;
+
+    /* channels which haven't been configured never reach zero-count */
+    for (int i = 0; i < 70000; i++) {
+        pins = z80ctc_tick(&ctc, pins);
+        T(0 == (pins & (Z80CTC_ZCTO0|Z80CTC_ZCTO1|Z80CTC_ZCTO2)));
+    }
+}
+
 /* a complete, integrated interrupt handling test */
 static z80_t cpu;
 static z80ctc_t ctc;
@@ -0,0 +1,195 @@
+//------------------------------------------------------------------------------
+//  zxtape-test.c
+//  Test ZX Spectrum TAP/TZX parsing and the LD-BYTES fast loader.
+//------------------------------------------------------------------------------
+#include "zxtape.h"
+#include "utest.h"
+#include <string.h>
+
+#define T(b) ASSERT_TRUE(b)
+
+static uint8_t mem[1<<16];
+static uint8_t tape[1024];
+static size_t tape_size;
+
+static uint8_t mem_read(uint16_t addr, void* user_data) {
+    (void)user_data;
+    return mem[addr];
+}
+
+static void mem_write(uint16_t addr, uint8_t data, void* user_data) {
+    (void)user_data;
+    mem[addr] = data;
+}
+
+static void put(uint8_t val) {
+    tape[tape_size++] = val;
+}
+
+// append a block with flag byte and checksum, with a 16-bit length prefix (TAP and TZX 0x10)
+static void put_block(uint8_t flag, const uint8_t* data, uint16_t len) {
+    const uint16_t blk_len = len + 2;
+    put(blk_len & 0xFF); put(blk_len >> 8);
+    uint8_t parity = flag;
+    put(flag);
+    for (uint16_t i = 0; i < len; i++) {
+        put(data[i]);
+        parity ^= data[i];
+    }
+    put(parity);
+}
+
+static const uint8_t header[17] = { 3, 'T','E','S','T',' ',' ',' ',' ',' ',' ', 4, 0, 0x00, 0x80, 0x00, 0x80 };
+static const uint8_t code[4] = { 0x11, 0x22, 0x33, 0x44 };
+
+static void make_tap(void) {
+    tape_size = 0;
+    put_block(0x00, header, sizeof(header));
+    put_block(0xFF, code, sizeof(code));
+}
+
+static zxtape_ld_bytes_result_t ld_bytes(uint8_t flag, bool verify, uint16_t addr, uint16_t len) {
+    return zxtape_ld_bytes(&(zxtape_ld_bytes_t){
+        .flag = flag,
+        .verify = verify,
+        .addr = addr,
+        .len = len,
+        .read_cb = mem_read,
+        .write_cb = mem_write,
+    });
+}
+
+UTEST(zxtape, load_tap) {
+    zxtape_init();
+    make_tap();
+    memset(mem, 0, sizeof(mem));
+    T(!zxtape_is_tzx((chips_range_t){ .ptr=tape, .size=tape_size }));
+    T(zxtape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+    T(zxtape_inserted());
+    zxtape_status_t status = zxtape_status();
+    T(status.format == ZXTAPE_FORMAT_TAP);
+    T(status.num_blocks == 2);
+    T(status.num_data_blocks == 2);
+    T(zxtape_has_data());
+
+    // header
+    zxtape_ld_bytes_result_t res = ld_bytes(0x00, false, 0x5C00, 17);
+    T(res.success);
+    T(res.parity == 0);
+    T(res.addr == 0x5C00 + 17);
+    T(res.len == 0);
+    T(0 == memcmp(&mem[0x5C00], header, sizeof(header)));
+
+    // data
+    res = ld_bytes(0xFF, false, 0x8000, 4);
+    T(res.success);
+    T(res.addr == 0x8004);
+    T(0 == memcmp(&mem[0x8000], code, sizeof(code)));
+    T(!zxtape_has_data());
+
+    // end of tape
+    res = ld_bytes(0xFF, false, 0x8000, 4);
+    T(!res.success);
+    T(res.addr == 0x8000);
+    T(res.len == 4);
+}
+
+UTEST(zxtape, flag_mismatch) {
+    zxtape_init();
+    make_tap();
+    memset(mem, 0, sizeof(mem));
+    T(zxtape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+    // looking for a data block skips the header block
+    zxtape_ld_bytes_result_t res = ld_bytes(0xFF, false, 0x8000, 4);
+    T(!res.success);
+    T(mem[0x8000] == 0);
+    res = ld_bytes(0xFF, false, 0x8000, 4);
+    T(res.success);
+    T(mem[0x8000] == 0x11);
+}
+
+UTEST(zxtape, verify) {
+    zxtape_init();
+    make_tap();
+    memset(mem, 0, sizeof(mem));
+    memcpy(&mem[0x8000], code, sizeof(code));
+    T(zxtape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+    ld_bytes(0x00, false, 0x5C00, 17);
+    T(ld_bytes(0xFF, true, 0x8000, 4).success);
+    zxtape_rewind();
+    mem[0x8002] = 0;
+    ld_bytes(0x00, false, 0x5C00, 17);
+    T(!ld_bytes(0xFF, true, 0x8000, 4).success);
+}
+
+UTEST(zxtape, short_block) {
+    zxtape_init();
+    make_tap();
+    T(zxtape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+    ld_bytes(0x00, false, 0x5C00, 17);
+    // like the ROM, the checksum byte is loaded as data
+    zxtape_ld_bytes_result_t res = ld_bytes(0xFF, false, 0x8000, 8);
+    T(!res.success);
+    T(res.len == 3);
+}
+
+UTEST(zxtape, bad_checksum) {
+    zxtape_init();
+    make_tap();
+    tape[tape_size - 1] ^= 0x55;
+    T(zxtape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+    T(ld_bytes(0x00, false, 0x5C00, 17).success);
+    zxtape_ld_bytes_result_t res = ld_bytes(0xFF, false, 0x8000, 4);
+    T(!res.success);
+    T(res.parity == 0x55);
+}
+
+UTEST(zxtape, bad_tap) {
+    zxtape_init();
+    make_tap();
+    T(!zxtape_insert((chips_range_t){ .ptr=tape, .size=tape_size - 1 }));
+    T(!zxtape_inserted());
+}
+
+UTEST(zxtape, load_tzx) {
+    zxtape_init();
+    tape_size = 0;
+    const char* sig = "ZXTape!\x1A";
+    for (int i = 0; i < 8; i++) {
+        put((uint8_t)sig[i]);
+    }
+    put(1); put(20);
+    // text description
+    put(0x30); put(4); put('t'); put('e'); put('s'); put('t');
+    // standard speed header block with 1000ms pause
+    put(0x10); put(0xE8); put(0x03);
+    put_block(0x00, header, sizeof(header));
+    // pure tone
+    put(0x12); put(0x78); put(0x08); put(0x97); put(0x0C);
+    // pure data block
+    put(0x14); put(0x57); put(0x03); put(0xAE); put(0x06); put(8); put(0); put(0); put(6); put(0); put(0);
+    uint8_t parity = 0xFF;
+    put(0xFF);
+    for (int i = 0; i < 4; i++) {
+        put(code[i]);
+        parity ^= code[i];
+    }
+    put(parity);
+    // stop the tape
+    put(0x20); put(0); put(0);
+    T(zxtape_is_tzx((chips_range_t){ .ptr=tape, .size=tape_size }));
+    T(zxtape_insert((chips_range_t){ .ptr=tape, .size=tape_size }));
+    zxtape_status_t status = zxtape_status();
+    T(status.format == ZXTAPE_FORMAT_TZX);
+    T(status.num_blocks == 5);
+    T(status.num_data_blocks == 2);
+    memset(mem, 0, sizeof(mem));
+    T(ld_bytes(0x00, false, 0x5C00, 17).success);
+    T(0 == memcmp(&mem[0x5C00], header, sizeof(header)));
+    T(ld_bytes(0xFF, false, 0x8000, 4).success);
+    T(0 == memcmp(&mem[0x8000], code, sizeof(code)));
+    T(!zxtape_has_data());
+
+    // truncated TZX images are rejected
+    T(!zxtape_insert((chips_range_t){ .ptr=tape, .size=tape_size - 4 }));
+}